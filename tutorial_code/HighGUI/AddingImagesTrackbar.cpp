@@ -7,12 +7,24 @@
 /**
  * 图像线性混合
  * 简单的线性混合公式( dst = alpha*src1 + beta*src2 )
+ * 两幅原图不变，只有 alpha 随滑动条变化：预先算好 src1 - src2（16 位有符号），
+ * 每次回调只做 dst = src2 + alpha*(src1 - src2) 一次乘加
+ * 第二个滑动条选择其他混合方式（addWeighted、定点数 Q15/Q8 四舍五入/截断），并打印耗时；
+ * 与浮点结果的最大偏差只在混合方式改变时计算一次（--check 时每次都算），不占用拖动 alpha 的时间
+ * --output 指定输出时不创建窗口，alpha 从 0 到 1 逐档混合，结果依次写到输出
  */
 
 //头文件
 #include "opencv2/imgcodecs.hpp"        //文件输入输出相关
 #include "opencv2/highgui.hpp"          //GUI相关
 #include <stdio.h>
+#include <iostream>
+
+#include "../common/fixed_blend.hpp" //定点数线性混合
+#include "../common/frame_sink.hpp"  //无窗口模式的结果输出
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp"       //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
 
 //命名空间
 using namespace cv;
@@ -23,12 +35,20 @@ const int alpha_slider_max = 100;
 int alpha_slider;
 double alpha;
 double beta;
+const int blend_mode_max = 5;
+int blend_mode = 0;     //0 预先求差，1 addWeighted，2 Q15 四舍五入，3 Q15 截断，4 Q8 四舍五入，5 Q8 截断
+samples::DifferenceBlend difference;    //预先算好的 src1 - src2
+bool headless = false;                  //无窗口模式
+bool check_every = false;               //每次回调都计算与浮点结果的偏差
+int checked_mode = -1;                  //上一次计算偏差时的混合方式
+Ptr<samples::FrameSink> sink;           //无窗口模式的输出
 
 /** Matrices to store images */
 //储存图像的全局Mat变量
 Mat src1;
 Mat src2;
 Mat dst;
+Mat float_dst;  //浮点结果，用来计算定点数结果的偏差，只在需要时计算
 
 //![on_trackbar]
 /**
@@ -45,9 +65,54 @@ static void on_trackbar( int, void* )
    beta = ( 1.0 - alpha );
 
     //线性混合，gamma参数取0.0
-   addWeighted( src1, alpha, src2, beta, 0.0, dst);
-
-   imshow( "Linear Blend", dst );
+   static const char* mode_names[] = { "difference", "addWeighted", "Q15 round", "Q15 truncate", "Q8 round", "Q8 truncate" };
+   const char* used = mode_names[blend_mode];  //实际使用的方式：权重过大时 Q8 改用 Q15，再大就用 addWeighted
+   samples::AllocationStage stage( "blend" );
+   double t = (double)getTickCount();
+   {
+     SAMPLES_TRACE_SCOPE( "blend" );
+     if( blend_mode == 0 )
+       difference.apply( alpha, dst );     //dst = src2 + alpha*(src1 - src2)
+     else if( blend_mode == 1 )
+       addWeighted( src1, alpha, src2, beta, 0.0, dst);
+     else
+     {
+       //定点数混合：权重量化成整数，16 位整数乘加
+       samples::BlendPrecision precision = blend_mode <= 3 ? samples::BLEND_Q15 : samples::BLEND_Q8;
+       samples::BlendRounding rounding = blend_mode % 2 ? samples::BLEND_TRUNCATE : samples::BLEND_ROUND_NEAREST;
+       samples::FixedBlend blend( alpha, beta, 0.0, precision, rounding );
+       if( blend.valid() && src1.depth() == CV_8U )
+       {
+         blend.apply( src1, src2, dst );
+         used = mode_names[(blend.precision() == samples::BLEND_Q15 ? 2 : 4) + (rounding == samples::BLEND_TRUNCATE)];
+       }
+       else
+       {
+         addWeighted( src1, alpha, src2, beta, 0.0, dst );
+         used = mode_names[1];
+       }
+     }
+   }
+   t = 1000*((double)getTickCount() - t)/getTickFrequency();
+
+   //整幅的浮点混合和 norm 比混合本身还慢，默认只在混合方式改变时算一次偏差
+   if( check_every || blend_mode != checked_mode )
+   {
+     stage.enter( "reference" );
+     addWeighted( src1, alpha, src2, beta, 0.0, float_dst );
+     printf( "alpha %.2f %-12s %.3f ms, max deviation from addWeighted %g\n", alpha, used, t,
+             norm( dst, float_dst, NORM_INF ) );
+     checked_mode = blend_mode;
+   }
+   else
+     printf( "alpha %.2f %-12s %.3f ms\n", alpha, used, t );
+
+   SAMPLES_TRACE_SCOPE( "display" );
+   stage.enter( "display" );
+   if( headless )
+     sink->write( dst );
+   else
+     imshow( "Linear Blend", dst );
 }
 //![on_trackbar]
 
@@ -55,22 +120,48 @@ static void on_trackbar( int, void* )
  * @function main
  * @brief Main function
  */
-int main( void )
+int main( int argc, char** argv )
 {
+   CommandLineParser parser( argc, argv,
+     "{mode   | 0 | blend mode, 0: difference 1: addWeighted 2: Q15 3: Q15 trunc 4: Q8 5: Q8 trunc}"
+     "{output |   | sweep alpha into null, an image pattern with %, shm:name or a video file instead of showing it}"
+     "{check  |   | compare with the float addWeighted at every alpha, not only when the mode changes}" );
+   blend_mode = std::min( std::max( parser.get<int>( "mode" ), 0 ), blend_mode_max );
+   check_every = parser.has( "check" );
+
+   //统计 Mat 的分配，按阶段汇总，退出时打印
+   samples::AllocationTracker::install();
+   samples::AllocationStage stage( "load" );
+
    //![load]
    /// Read images ( both have to be of the same size and type )
    //加载图像
-   src1 = imread("../data/LinuxLogo.jpg");
-   src2 = imread("../data/WindowsLogo.jpg");
+   src1 = samples::imreadCached("../data/LinuxLogo.jpg");
+   src2 = samples::imreadCached("../data/WindowsLogo.jpg");
    //![load]
 
    //检查图像是否加载成功
    if( src1.empty() ) { printf("Error loading src1 \n"); return -1; }
    if( src2.empty() ) { printf("Error loading src2 \n"); return -1; }
 
+   //原图不再变化，差只算一次
+   difference.setSources( src1, src2 );
+
    /// Initialize values
    alpha_slider = 0;    //初始化滑动条的值
 
+   /// Headless: every slider position through the output
+   /// 无窗口模式：遍历滑动条的每一档，不创建窗口
+   if( parser.has( "output" ) )
+   {
+     headless = true;
+     sink = samples::FrameSink::create( parser.get<String>( "output" ) );
+     for( alpha_slider = 0; alpha_slider <= alpha_slider_max; alpha_slider++ )
+       on_trackbar( alpha_slider, 0 );
+     sink->stats().print( std::cout, "output", "write" );
+     return 0;
+   }
+
    //![window]
    //创建窗口，WINDOW_AUTOSIZE类型
    namedWindow("Linear Blend", WINDOW_AUTOSIZE); // Create Window
@@ -80,6 +171,8 @@ int main( void )
    char TrackbarName[50];
    sprintf( TrackbarName, "Alpha x %d", alpha_slider_max );         //格式化滑动条名称
    createTrackbar( TrackbarName, "Linear Blend", &alpha_slider, alpha_slider_max, on_trackbar );    //创建滑动条
+   createTrackbar( "Mode:\n 0: difference 1: addWeighted\n 2: Q15 3: Q15 trunc 4: Q8 5: Q8 trunc", "Linear Blend",
+                   &blend_mode, blend_mode_max, on_trackbar );    //混合方式
    //![create_trackbar]
 
    /// Show some stuff
@@ -95,5 +188,7 @@ int main( void )
  * 线性混合公式 ( dst = alpha*src1 + beta*src2 ) 或者 ( dst = alpha*src1 + beta*src2 + gamma )
  * 滑动条回掉函数原型 void function_name(int, void*)
  * 创建滑动条createTrackbar()
+ * 8 位图像的混合可以用定点数权重和整数 SIMD，截断比四舍五入少一次加法，但结果平均偏小 0.5
+ * 只有 alpha 变化时，alpha*src1 + (1-alpha)*src2 = src2 + alpha*(src1-src2)，预先求差后每个值只需一次乘加
  * 格式化字符串sprintf(), opencv3转为sprintf_s();安全版本sprintf_s()
  */
\ No newline at end of file
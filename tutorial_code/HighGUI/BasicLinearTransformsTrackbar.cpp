@@ -16,12 +16,24 @@
  * 2、初始化参数和创建窗口
  * 3、创建滑动条
  * 4、调用显示
+ * --progressive 时滑动条回调先处理缩小的图像，停止拖动后工作线程再计算全分辨率结果，
+ * 结果窗口用 WINDOW_NORMAL 创建，缩小的预览由窗口缩放显示
+ * --output 指定输出时不创建窗口和滑动条，遍历所有对比度和亮度，结果写到输出
 */
 
 //头文件
 #include "opencv2/imgcodecs.hpp"        //图像文件读取和写入相关
 #include "opencv2/highgui.hpp"          //GUI相关
 
+#include "../common/point_ops.hpp"     //点运算查找表
+#include "../common/progressive_preview.hpp" //渐进式预览
+#include "../common/frame_sink.hpp" //无窗口模式的结果输出
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp" //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
+#include <iostream>
+
 //命名空间
 using namespace cv;
 
@@ -35,6 +47,10 @@ int beta;  /**< Simple brightness control*///控制亮度的参数， 称偏置
 /** Matrices to store images */
 // 储存图像变量
 Mat image;
+Mat new_image; /**< Output reused across trackbar events */ //输出图像，滑动条事件之间复用，只分配一次
+Ptr<samples::ProgressivePreview> preview; /**< Progressive mode, empty when disabled */ //渐进模式，未启用时为空
+bool headless = false; /**< No windows, results go to sink */ //无窗口模式
+Ptr<samples::FrameSink> sink; /**< Output of the headless mode */ //无窗口模式的输出
 
 /**
  * @function on_trackbar
@@ -43,15 +59,33 @@ Mat image;
 //滑动条回掉函数， 偏置和增益参数变化是调用
 static void on_trackbar( int, void* )
 {
-    Mat new_image = Mat::zeros( image.size(), image.type() );
-
-    for( int y = 0; y < image.rows; y++ )
-        for( int x = 0; x < image.cols; x++ )
-            for( int c = 0; c < 3; c++ )
-                //线性变换公式 dst = alpha*src + beta
-                new_image.at<Vec3b>(y,x)[c] = saturate_cast<uchar>( alpha*( image.at<Vec3b>(y,x)[c] ) + beta );
-
-    imshow("New Image", new_image);
+    SAMPLES_TRACE_SCOPE( "on_trackbar" );
+    samples::AllocationStage stage( "linear transform" );
+    /// The transform only depends on the pixel value: compile it into a 256-entry table
+    /// 线性变换公式 dst = alpha*src + beta，只与像素值有关，先算成 256 项的表，再一次遍历整幅图查表
+    if( preview )
+    {
+        //渐进模式：参数按值捕获，预览和工作线程上的全分辨率计算都用同一个变换
+        const double a = alpha, b = beta;
+        preview->request( [a, b]( const Mat& in, Mat& out, double )
+        {
+            samples::PointOps ops;
+            ops.linear( a, b );
+            ops.apply( in, out );
+        }, new_image );
+    }
+    else
+    {
+        samples::PointOps ops;
+        ops.linear( alpha, beta );
+        ops.apply( image, new_image );
+    }
+
+    stage.enter( "display" );
+    if( headless )
+        sink->write( new_image );
+    else
+        imshow("New Image", new_image);
 }
 
 
@@ -63,23 +97,49 @@ static void on_trackbar( int, void* )
 int main( int argc, char** argv )
 {
    /// Read image given by user
-   String imageName("../data/lena.jpg"); // by default，图像默认途径
-   if (argc > 1)
-   {    
-    //用户输入的图像路径
-      imageName = argv[1];
+   //用户输入的图像路径，否则使用默认路径
+   CommandLineParser parser( argc, argv,
+      "{@input      | ../data/lena.jpg | input image}"
+      "{progressive | false | show a downscaled preview while dragging and refine to full resolution on a worker thread}"
+      "{output      |       | sweep all contrasts and brightnesses into null, an image pattern with %, shm:name or a video file instead of showing them}" );
+   String imageName = parser.get<String>( "@input" );
+
+   //统计 Mat 的分配，按阶段汇总，退出时打印
+   samples::AllocationTracker::install();
+   samples::AllocationStage stage( "load" );
+
+   image = samples::imreadCached( imageName );
+   headless = parser.has( "output" );
+   if( parser.get<bool>( "progressive" ) && !headless )
+   {
+      preview = makePtr<samples::ProgressivePreview>();
+      preview->setSource( image );
    }
-   image = imread( imageName );
 
    /// Initialize values
    //初始化两个参数
    alpha = 1;
    beta = 0;
 
+   /// Headless: every contrast and brightness through the output
+   /// 无窗口模式：不创建窗口和滑动条，遍历所有对比度和亮度，结果写到输出
+   if( headless )
+   {
+      sink = samples::FrameSink::create( parser.get<String>( "output" ) );
+      for( alpha = 0; alpha <= alpha_max; alpha++ )
+         for( beta = 0; beta <= beta_max; beta++ )
+            on_trackbar( 0, 0 );
+      sink->stats().print( std::cout, "output", "write" );
+      return 0;
+   }
+
    /// Create Windows
    /// 创建窗口
    namedWindow("Original Image", 1);
-   namedWindow("New Image", 1);
+   //渐进模式的预览是缩小的图像，用 WINDOW_NORMAL 窗口由窗口系统缩放到原图大小显示
+   namedWindow("New Image", preview ? WINDOW_NORMAL : WINDOW_AUTOSIZE);
+   if( preview )
+      resizeWindow("New Image", image.cols, image.rows);
 
    /// Create Trackbars
    /// 创建滑动条
@@ -92,7 +152,12 @@ int main( int argc, char** argv )
    imshow("New Image", image);
 
    /// Wait until user press some key
-   waitKey();
+   /// 等待按键；渐进模式下同时取回全分辨率结果显示
+   while( waitKey( preview ? 20 : 0 ) < 0 )
+   {
+      if( preview && preview->poll( new_image ) )
+         imshow("New Image", new_image);
+   }
    return 0;
 }
 
@@ -101,4 +166,7 @@ int main( int argc, char** argv )
  * 线性变换公式 dst = alpha*src + beta
  * alpha增益参数，控制图像的对比度
  * beta偏置参数， 控制图像的亮度
+ * 8位图像的点运算只有256种输入，先计算查找表再查表，避免逐像素的 at<> 访问和浮点运算
+ * 输出图像作为全局变量复用，滑动条每次变化不再重新分配
+ * 渐进式预览：拖动时先显示缩小图像的结果，停止后工作线程计算全分辨率结果，GUI 线程不等待
 */
\ No newline at end of file
@@ -0,0 +1,182 @@
+/**
+ * @file FusedPipeline.cpp
+ * @brief cvtColor -> GaussianBlur -> threshold/inRange -> erode/dilate -> blend, fused tile by tile and compared with step-by-step calls
+ * @author OpenCV team
+ */
+
+/**
+ * 分块融合的处理流程
+ * 把各示例分别演示的运算串成一个流程，声明为 TileGraph 运算图，
+ * 分别逐个整幅执行（每一步写出整幅的中间结果）和分块融合执行，比较耗时，并检查两者结果是否逐位一致。
+ */
+
+/**
+ * 程序流程
+ * 1、加载图像和背景图像，放大到 7680x4320
+ * 2、建立两个运算图：
+ *    inRange：BGR -> HSV -> GaussianBlur -> inRange -> erode -> dilate -> 按掩码混合原图与背景
+ *    threshold：BGR -> 灰度 -> GaussianBlur -> threshold -> erode -> dilate -> 转回 BGR -> 与原图 addWeighted
+ * 3、对每个运算图逐个整幅执行、分块融合执行，取平均耗时
+ * 4、norm(NORM_INF) 检查结果是否一致
+ * 5、显示融合执行的结果，有不一致的运算图时返回 1
+ */
+
+//头文件
+#include <iostream>
+#include <string>
+#include <vector>
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/highgui.hpp"
+
+#include "../common/tile_graph.hpp" //分块融合的运算图
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp" //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
+//命名空间
+using namespace std;
+using namespace cv;
+using samples::TileGraph;
+
+/**
+ * @function main
+ */
+int main( int argc, char** argv )
+{
+    CommandLineParser parser( argc, argv,
+        "{@input     | ../data/lena.jpg      | input image}"
+        "{background | ../data/baboon.jpg    | image blended in where the inRange mask is set}"
+        "{width      | 7680 | width the images are resized to}"
+        "{height     | 4320 | height the images are resized to}"
+        "{tile       | 0    | tile side in pixels, 0 derives it from the L2 budget}"
+        "{l2         | 256  | per-core L2 budget in KB}"
+        "{runs       | 5    | runs averaged per measurement}" );
+
+    //统计 Mat 的分配，按阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+    samples::AllocationStage stage( "setup" );
+
+    /// Load the images and bring them to 8K
+    /// 加载图像并放大到 8K
+    Mat img = samples::imreadCached( parser.get<String>( "@input" ), IMREAD_COLOR );
+    Mat bgImg = samples::imreadCached( parser.get<String>( "background" ), IMREAD_COLOR );
+    if( img.empty() || bgImg.empty() )
+    {
+        cout << "Could not open or find the image!\n" << endl;
+        cout << "Usage: " << argv[0] << " <Input image> [--background=<image>]" << endl;
+        return -1;
+    }
+    const Size size( parser.get<int>( "width" ), parser.get<int>( "height" ) );
+    Mat src, background;
+    resize( img, src, size, 0, 0, INTER_LINEAR );
+    resize( bgImg, background, size, 0, 0, INTER_LINEAR );
+
+    const int runs = std::max( parser.get<int>( "runs" ), 1 );
+    const int tile = parser.get<int>( "tile" );
+    Mat element = getStructuringElement( MORPH_RECT, Size( 5, 5 ) );
+
+    //![graph]
+    /// inRange: the skin-coloured region of the image is replaced by the background
+    /// inRange 流程：HSV 中落在范围内的区域去噪后换成背景
+    struct Case { string name; TileGraph graph; vector<Mat> inputs; };
+    vector<Case> cases( 2 );
+    {
+        TileGraph& g = cases[0].graph;
+        int frame = g.input(), bg = g.input();
+        int hsv = g.cvtColor( frame, COLOR_BGR2HSV );
+        int smooth = g.gaussianBlur( hsv, Size( 5, 5 ), 0 );
+        int mask = g.inRange( smooth, Scalar( 0, 40, 60 ), Scalar( 25, 200, 255 ) );
+        int opened = g.dilate( g.erode( mask, element ), element );
+        g.blend( frame, bg, opened );
+        cases[0].name = "inRange";
+        cases[0].inputs.push_back( src );
+        cases[0].inputs.push_back( background );
+    }
+
+    /// threshold: the bright regions are highlighted on top of the image
+    /// threshold 流程：灰度阈值去噪后叠加到原图上
+    {
+        TileGraph& g = cases[1].graph;
+        int frame = g.input();
+        int gray = g.cvtColor( frame, COLOR_BGR2GRAY );
+        int smooth = g.gaussianBlur( gray, Size( 9, 9 ), 0 );
+        int mask = g.threshold( smooth, 128, 255, THRESH_BINARY );
+        int closed = g.erode( g.dilate( mask, element ), element );
+        g.addWeighted( frame, 0.6, g.cvtColor( closed, COLOR_GRAY2BGR ), 0.4, 0 );
+        cases[1].name = "threshold";
+        cases[1].inputs.push_back( src );
+    }
+    //![graph]
+
+    cout << "Image " << src.cols << "x" << src.rows << ", " << getNumThreads() << " threads" << endl;
+
+    bool all_ok = true;
+    Mat unfused, fused;
+    for( size_t c = 0; c < cases.size(); c++ )
+    {
+        TileGraph& g = cases[c].graph;
+        const vector<Mat>& inputs = cases[c].inputs;
+        g.setCacheBytes( (size_t)parser.get<int>( "l2" )*1024 );
+        if( tile > 0 )
+            g.setTileSize( Size( tile, tile ) );
+        cout << cases[c].name << " graph:" << endl;
+        g.print( cout );
+
+        stage.enter( "unfused" );
+        //![unfused]
+        /// Step by step: every operation on the whole image, with full-size intermediates
+        /// 逐个整幅执行，每一步写出整幅的中间结果
+        double t = (double)getTickCount();
+        for( int i = 0; i < runs; i++ )
+        {
+            SAMPLES_TRACE_SCOPE( "unfused" );
+            g.runUnfused( inputs, unfused );
+        }
+        double tUnfused = 1000*((double)getTickCount() - t)/getTickFrequency()/runs;
+        //![unfused]
+
+        stage.enter( "fused" );
+        //![fused]
+        /// Fused: the whole graph per tile, intermediates in per-thread tile buffers
+        /// 分块融合执行，中间结果只在每个线程的块缓冲区中
+        t = (double)getTickCount();
+        for( int i = 0; i < runs; i++ )
+        {
+            SAMPLES_TRACE_SCOPE( "fused" );
+            g.run( inputs, fused );
+        }
+        double tFused = 1000*((double)getTickCount() - t)/getTickFrequency()/runs;
+        //![fused]
+
+        vector<int> types;
+        for( size_t i = 0; i < inputs.size(); i++ )
+            types.push_back( inputs[i].type() );
+        vector<Rect> tiles = g.tiles( src.size(), types );
+        double diff = norm( unfused, fused, NORM_INF );
+        all_ok = all_ok && diff == 0;
+        cout << cases[c].name << ": unfused " << tUnfused << " ms, fused " << tFused << " ms ("
+             << tiles.size() << " tiles of " << tiles[0].width << "x" << tiles[0].height << ", "
+             << g.overcompute( src.size(), types ) << "x pixels computed), "
+             << (diff == 0 ? "bit-identical" : "max diff " + to_string( diff )) << endl;
+    }
+    cout << (all_ok ? "fused results bit-identical to the step-by-step calls" : "Results differ") << endl;
+
+    /// Show the last fused result, scaled down
+    stage.enter( "display" );
+    Mat show;
+    resize( fused, show, Size(), 0.125, 0.125, INTER_AREA );
+    imshow( "Fused Pipeline", show );
+    waitKey(0);
+    return all_ok ? 0 : 1;
+}
+
+/**
+ * 要点总结
+ * 逐个调用时每一步都读写整幅图像，分块融合后中间结果只在缓存大小的缓冲区里，只有输入和输出经过内存
+ * 每个节点需要计算的区域从输出往回推：下游区域加上 halo 的并集，与图像求交
+ * 滤波以 BORDER_ISOLATED 调用块缓冲区，图像边缘的外推与整幅执行相同，结果逐位一致
+ * 相邻块的 halo 要重复计算，块越小、halo 越大，重复越多；块的大小按 L2 缓存估算
+ * 需要整幅统计量的运算（Otsu 阈值）不能分块
+ */
@@ -0,0 +1,306 @@
+/**
+ * @file GaussianScaleSpace.cpp
+ * @brief Cascaded Gaussian scale-space: every level is blurred from the previous level
+ * @author OpenCV team
+ */
+
+/**
+ * 高斯尺度空间
+ * Smoothing.cpp 里的 GaussianBlur 循环每次都从 src 重新模糊，sigma 越大核越长。
+ * 两次高斯模糊的 sigma 按平方和叠加： G(s1) * G(s2) = G(sqrt(s1^2 + s2^2))，
+ * 所以第 i 层只需在第 i-1 层上施加增量 sigma：
+ *     sigma_inc = sqrt(sigma_i^2 - sigma_{i-1}^2)
+ * 增量 sigma 远小于绝对 sigma，对应的核也短得多。
+ */
+
+/**
+ * 程序流程
+ * 1、加载图像
+ * 2、按 Smoothing.cpp 中核大小 3,5,...,29 对应的 sigma 建立级联尺度空间，并与逐个从 src 模糊对比耗时和误差
+ * 3、建立带 octave 降采样的尺度空间（SIFT 方式），打印各层信息
+ * 4、依次显示各层
+ */
+
+//头文件
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/highgui.hpp"
+
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp" //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
+//命名空间
+using namespace std;
+using namespace cv;
+
+/// Global Variables
+int DELAY_LEVEL = 300;  //每层显示的延时
+char window_name[] = "Gaussian Scale Space";
+
+/**
+ * @brief Kernel size GaussianBlur picks for Size(0,0) and the given sigma
+ * 与 GaussianBlur 在 ksize 为 Size(0,0) 时的自动取值一致
+ */
+static int gaussianKernelSize( double sigma, int depth )
+{
+    return cvRound( sigma*(depth == CV_8U ? 3 : 4)*2 + 1 ) | 1;
+}
+
+/**
+ * @brief Sigma GaussianBlur derives from an odd kernel size when sigma is 0
+ * ksize -> sigma，与 getGaussianKernel 的公式一致
+ */
+static double gaussianSigmaFromKernel( int ksize )
+{
+    return 0.3*((ksize - 1)*0.5 - 1) + 0.8;
+}
+
+/**
+ * @class GaussianScaleSpace
+ * @brief Gaussian pyramid of increasing sigma where each level is produced from its predecessor.
+ *
+ * All levels of all octaves live in one contiguous, 64-byte aligned arena; levels are Mat headers
+ * pointing into it. Sigmas are given per octave, relative to that octave's pixel grid.
+ * 所有层共享一块连续内存，level() 返回的 Mat 只是指向其中的头。
+ */
+class GaussianScaleSpace
+{
+public:
+    GaussianScaleSpace() : cascadedTaps_(0), independentTaps_(0) {}
+
+    /**
+     * @param src        input image, any channel count
+     * @param sigmas     strictly increasing sigmas of the levels of one octave
+     * @param octaves    number of octaves, 1 means no downsampling
+     * @param inputSigma blur already present in src
+     * @param depth      depth of the levels, CV_32F keeps the cascade free of rounding drift
+     */
+    void build( const Mat& src, const vector<double>& sigmas, int octaves = 1,
+                double inputSigma = 0.5, int depth = CV_32F )
+    {
+        CV_Assert( !src.empty() && !sigmas.empty() && octaves >= 1 );
+        for( size_t i = 1; i < sigmas.size(); i++ )
+            CV_Assert( sigmas[i] > sigmas[i-1] );
+
+        sigmas_ = sigmas;
+        levelsPerOctave_ = (int)sigmas.size();
+        allocate( src.size(), CV_MAKETYPE(depth, src.channels()), octaves );
+
+        cascadedTaps_ = independentTaps_ = 0;
+        const double srcPixels = (double)src.total();
+        double prevSigma = inputSigma;   // 当前 octave 网格下，上一层已有的 sigma
+
+        for( int o = 0; o < octaves_; o++ )
+        {
+            double pixels = (double)level(o, 0).total();
+            for( int i = 0; i < levelsPerOctave_; i++ )
+            {
+                SAMPLES_TRACE_SCOPE( "cascade level" );
+                Mat& dst = level(o, i);
+                const Mat& prev = i > 0 ? level(o, i-1) : (o > 0 ? downsampled_ : src);
+                double inc = incrementalSigma( prevSigma, sigmas_[i] );
+
+                // 第一层需要转换深度，其它层直接在前一层上模糊
+                if( prev.type() != dst.type() )
+                    prev.convertTo( dst, dst.type() );
+                else if( inc <= 0 )
+                    prev.copyTo( dst );
+                if( inc > 0 )
+                {
+                    GaussianBlur( prev.type() == dst.type() ? prev : dst, dst, Size(), inc, inc, BORDER_REFLECT_101 );
+                    cascadedTaps_ += 2.0*gaussianKernelSize( inc, depth )*pixels;
+                }
+                prevSigma = sigmas_[i];
+
+                // 逐个从 src 模糊时，在原分辨率下需要的绝对 sigma
+                double absSigma = incrementalSigma( inputSigma, sigmas_[i]*(1 << o) );
+                independentTaps_ += 2.0*gaussianKernelSize( absSigma, depth )*srcPixels;
+            }
+
+            if( o + 1 < octaves_ )
+            {
+                // 选 sigma 最接近 2*sigma0 的层降采样，降采样后 sigma 减半
+                int base = levelsPerOctave_ - 1;
+                for( int i = 0; i < levelsPerOctave_; i++ )
+                    if( sigmas_[i] <= 2*sigmas_[0] + 1e-6 )
+                        base = i;
+                resize( level(o, base), downsampled_, level(o+1, 0).size(), 0, 0, INTER_NEAREST );
+                prevSigma = sigmas_[base]*0.5;
+            }
+        }
+    }
+
+    Mat& level( int octave, int i ) { return levels_[octave*levelsPerOctave_ + i]; }
+    const Mat& level( int octave, int i ) const { return levels_[octave*levelsPerOctave_ + i]; }
+    double sigma( int i ) const { return sigmas_[i]; }
+    int octaves() const { return octaves_; }
+    int levelsPerOctave() const { return levelsPerOctave_; }
+    size_t arenaBytes() const { return arena_.total(); }
+
+    /// Separable filter taps (multiply-adds) spent by the cascade and by independent blurs from src
+    double cascadedTaps() const { return cascadedTaps_; }
+    double independentTaps() const { return independentTaps_; }
+
+private:
+    static double incrementalSigma( double from, double to )
+    {
+        double d = to*to - from*from;
+        return d > 1e-6 ? std::sqrt(d) : 0;
+    }
+
+    void allocate( Size size, int type, int octaves )
+    {
+        const int align = 64;
+        vector<Size> sizes;
+        for( int o = 0; o < octaves; o++, size = Size(size.width/2, size.height/2) )
+        {
+            if( o > 0 && std::min(size.width, size.height) < 8 )
+                break;  //太小就不再降采样
+            sizes.push_back( size );
+        }
+        octaves_ = (int)sizes.size();
+
+        // 每层起始地址按 64 字节对齐，行之间连续
+        size_t esz = CV_ELEM_SIZE(type), total = 0;
+        vector<size_t> offsets;
+        for( int o = 0; o < octaves_; o++ )
+            for( int i = 0; i < levelsPerOctave_; i++ )
+            {
+                offsets.push_back( total );
+                total += alignSize( sizes[o].area()*esz, align );
+            }
+
+        if( arena_.total() < total + align )
+            arena_.create( 1, (int)(total + align), CV_8U );
+        uchar* base = alignPtr( arena_.ptr(), align );
+
+        levels_.clear();
+        for( int o = 0, k = 0; o < octaves_; o++ )
+            for( int i = 0; i < levelsPerOctave_; i++, k++ )
+                levels_.push_back( Mat( sizes[o], type, base + offsets[k] ) );
+    }
+
+    Mat arena_;
+    vector<Mat> levels_;
+    vector<double> sigmas_;
+    Mat downsampled_;
+    int octaves_;
+    int levelsPerOctave_;
+    double cascadedTaps_;
+    double independentTaps_;
+};
+
+/**
+ * @function main
+ */
+int main( int argc, char ** argv )
+{
+    //统计 Mat 的分配，按阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+    samples::AllocationStage stage( "setup" );
+
+    /// Load the source image
+    const char* filename = argc >=2 ? argv[1] : "../data/lena.jpg";
+
+    Mat src = samples::imreadCached( filename, IMREAD_COLOR );
+    if(src.empty()){
+        printf(" Error opening image\n");
+        printf(" Usage: ./GaussianScaleSpace [image_name -- default ../data/lena.jpg] \n");
+        return -1;
+    }
+
+    //![cascade]
+    /// Same sigmas as the GaussianBlur loop of Smoothing.cpp for kernel sizes 3, 5, ..., 29
+    /// Smoothing.cpp 中 GaussianBlur 循环对应的 sigma；核大小 1 不模糊，其 sigma 0.5 等于输入图像的 sigma，不单独成层
+    vector<double> sigmas;
+    for( int i = 3; i < 31; i = i + 2 )
+        sigmas.push_back( gaussianSigmaFromKernel( i ) );
+
+    const double inputSigma = 0.5;
+    GaussianScaleSpace space;
+
+    const int times = 10;
+    stage.enter( "cascade" );
+    double t = (double)getTickCount();
+    for( int n = 0; n < times; n++ )
+        space.build( src, sigmas, 1, inputSigma );
+    double tCascade = 1000*((double)getTickCount() - t)/getTickFrequency()/times;
+    //![cascade]
+
+    /// Independent blurs from src, as Smoothing.cpp does
+    /// 对比：每层都从 src 开始模糊
+    stage.enter( "independent" );
+    Mat src32f, independent;
+    double maxDiff = 0;
+    t = (double)getTickCount();
+    for( int n = 0; n < times; n++ )
+    {
+        src.convertTo( src32f, CV_32F );
+        for( size_t i = 0; i < sigmas.size(); i++ )
+        {
+            double s = std::sqrt( sigmas[i]*sigmas[i] - inputSigma*inputSigma );
+            {
+                SAMPLES_TRACE_SCOPE( "independent level" );
+                GaussianBlur( src32f, independent, Size(), s, s, BORDER_REFLECT_101 );
+            }
+            if( n == 0 )
+                maxDiff = std::max( maxDiff, norm( independent, space.level(0, (int)i), NORM_INF ) );
+        }
+    }
+    double tIndependent = 1000*((double)getTickCount() - t)/getTickFrequency()/times;
+
+    cout << "Levels: " << sigmas.size() << ", arena: " << space.arenaBytes()/1024 << " KB" << endl
+         << "Cascaded build:     " << tCascade << " ms, " << space.cascadedTaps()/1e6 << " Mtaps" << endl
+         << "Independent blurs:  " << tIndependent << " ms, " << space.independentTaps()/1e6 << " Mtaps" << endl
+         << "Max abs difference: " << maxDiff << endl;
+
+    /// Octave scale space (SIFT style): sigma0 = 1.6, 3 intervals per octave, 4 octaves
+    /// 带降采样的尺度空间
+    vector<double> octaveSigmas;
+    const int intervals = 3;
+    for( int i = 0; i < intervals + 3; i++ )
+        octaveSigmas.push_back( 1.6*std::pow( 2.0, (double)i/intervals ) );
+
+    stage.enter( "octave pyramid" );
+    GaussianScaleSpace pyramid;
+    t = (double)getTickCount();
+    pyramid.build( src, octaveSigmas, 4, inputSigma );
+    t = 1000*((double)getTickCount() - t)/getTickFrequency();
+    cout << "Octave pyramid: " << pyramid.octaves() << " x " << pyramid.levelsPerOctave()
+         << " levels in " << t << " ms, " << pyramid.cascadedTaps()/1e6 << " Mtaps (independent: "
+         << pyramid.independentTaps()/1e6 << " Mtaps)" << endl;
+
+    /// Show the levels
+    stage.enter( "display" );
+    /// 依次显示各层
+    namedWindow( window_name, WINDOW_AUTOSIZE );
+    Mat show;
+    for( int i = 0; i < space.levelsPerOctave(); i++ )
+    {
+        space.level(0, i).convertTo( show, CV_8U );
+        imshow( window_name, show );
+        if( waitKey( DELAY_LEVEL ) >= 0 ) { return 0; }
+    }
+    for( int o = 0; o < pyramid.octaves(); o++ )
+    {
+        pyramid.level(o, 0).convertTo( show, CV_8U );
+        imshow( window_name, show );
+        if( waitKey( DELAY_LEVEL*3 ) >= 0 ) { return 0; }
+    }
+
+    return 0;
+}
+
+/**
+ * 要点总结
+ * 高斯模糊可以级联：sigma 按平方和叠加，sigma_inc = sqrt(sigma_i^2 - sigma_{i-1}^2)
+ * GaussianBlur 传入 Size() 时由 sigma 自动计算核大小，核大小随 sigma 线性增长
+ * 级联时用 CV_32F 存放各层，避免 8 位舍入误差逐层累积
+ * 降采样后 sigma 相对新网格减半
+ * 用 Mat(size, type, data) 构造指向同一块连续内存的各层
+ */
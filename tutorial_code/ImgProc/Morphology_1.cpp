@@ -15,12 +15,30 @@
  * 2、创建窗口，移动窗口
  * 3、创建滑动条分别控制形态学操作的结构元素类型和形态学操作核的大小（程度）
  * 4、调用默认显示
+ * 结构元素分解成若干矩形的并，每个矩形用 van Herk/Gil-Werman 算法，耗时与核大小无关，
+ * 分解结果按 (形状, 大小, 锚点) 缓存，结果与 erode/dilate 相同
+ * --binary=T 时先把图像按 T 阈值化，在每像素 1 位的掩码上做腐蚀、膨胀（按位与、或）
+ * --gradient 时再显示形态学梯度（膨胀 - 腐蚀），腐蚀、膨胀在同一次遍历中完成，腐蚀结果同时作为腐蚀窗口的显示，
+ * 二值模式下在位压缩掩码上腐蚀、膨胀后再相减；--progressive 不能与 --binary、--gradient 同时使用
+ * --progressive 时滑动条回调先在缩小的图像上用按比例缩小的核计算预览，
+ * 停止拖动后工作线程按行带计算全分辨率结果（每个行带多读核半径行），在等待按键的循环里取回显示，
+ * 窗口用 WINDOW_NORMAL 创建，缩小的预览由窗口缩放显示
+ * --output 指定输出时不创建窗口，遍历所有结构元素和大小，腐蚀、膨胀结果依次写到输出
 */
 //头文件
 #include "opencv2/imgproc.hpp"  //图像处理相关
 #include "opencv2/highgui.hpp"  //GUI相关
 #include <iostream>
 
+#include "../common/morphology_plan.hpp" //结构元素分解成矩形并缓存
+#include "../common/packed_morphology.hpp" //位压缩掩码上的二值形态学
+#include "../common/joint_morphology.hpp" //腐蚀、膨胀一次完成
+#include "../common/progressive_preview.hpp" //渐进式预览
+#include "../common/frame_sink.hpp" //无窗口模式的结果输出
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp" //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
 //命名空间
 using namespace cv;
 using namespace std;
@@ -28,6 +46,14 @@ using namespace std;
 /// Global variables
 /// 全局变量
 Mat src, erosion_dst, dilation_dst; //原图、腐蚀效果图、膨胀效果图
+bool binary = false;                //二值模式
+samples::PackedMask packed_src, packed_dst; //二值模式下的输入和结果掩码
+bool gradient = false;              //显示形态学梯度
+Mat gradient_dst;                   //梯度效果图
+bool progressive = false;           //渐进模式
+Ptr<samples::ProgressivePreview> erosion_preview, dilation_preview; //渐进模式的预览和后台计算
+bool headless = false;              //无窗口模式
+Ptr<samples::FrameSink> sink;       //无窗口模式的输出
 
 int erosion_elem = 0;//腐蚀结构元素
 int erosion_size = 0;//腐蚀程度大小
@@ -39,6 +65,7 @@ int const max_kernel_size = 21;//最大卷积核
 /** Function Headers */
 void Erosion( int, void* ); //腐蚀
 void Dilation( int, void* );//膨胀
+static void display( const char* window, const Mat& img ); //显示，或在无窗口模式下写到输出
 
 /**
  * @function main
@@ -48,8 +75,18 @@ int main( int argc, char** argv )
 {
   /// Load an image
   /// 加载图像
-  CommandLineParser parser( argc, argv, "{@input | ../data/chicky_512.png | input image}" );
-  src = imread( parser.get<String>( "@input" ), IMREAD_COLOR );
+  CommandLineParser parser( argc, argv,
+    "{@input | ../data/chicky_512.png | input image}"
+    "{binary | -1 | threshold in [0,255] turning the input into a binary mask processed 1 bit per pixel, -1 keeps the image}"
+    "{gradient | false | also show the morphological gradient of the erosion element, erosion and dilation in one pass, then their difference}"
+    "{progressive | false | show a downscaled preview while dragging and refine to full resolution on a worker thread}"
+    "{output | | sweep all elements and sizes into null, an image pattern with %, shm:name or a video file instead of showing them}" );
+
+  //统计 Mat 的分配，按阶段汇总，退出时打印
+  samples::AllocationTracker::install();
+  samples::AllocationStage stage( "load" );
+
+  src = samples::imreadCached( parser.get<String>( "@input" ), IMREAD_COLOR );
   if( src.empty() )
   {
     cout << "Could not open or find the image!\n" << endl;
@@ -57,11 +94,70 @@ int main( int argc, char** argv )
     return -1;
   }
 
+  /// Binary mode: threshold once and keep the mask packed
+  /// 二值模式：阈值化一次，之后都在位压缩掩码上计算
+  int binary_threshold = parser.get<int>( "binary" );
+  if( binary_threshold >= 0 )
+  {
+    Mat gray;
+    cvtColor( src, gray, COLOR_BGR2GRAY );
+    samples::thresholdPacked( gray, packed_src, binary_threshold );
+    packed_src.toMat( src );
+    binary = true;
+  }
+  gradient = parser.get<bool>( "gradient" );
+
+  /// Progressive mode for the grayscale/color path only; binary and gradient are computed synchronously
+  /// 渐进模式只用于普通的腐蚀、膨胀，与二值模式、梯度同时指定时报错退出
+  headless = parser.has( "output" );
+  if( parser.get<bool>( "progressive" ) && (binary || gradient) )
+  {
+    cout << "--progressive cannot be combined with --binary or --gradient" << endl;
+    return -1;
+  }
+  if( parser.get<bool>( "progressive" ) && !headless )
+  {
+    progressive = true;
+    erosion_preview = makePtr<samples::ProgressivePreview>();
+    dilation_preview = makePtr<samples::ProgressivePreview>();
+    erosion_preview->setSource( src );
+    dilation_preview->setSource( src );
+  }
+
+  /// Headless: every element and size, erosion then dilation, through the output
+  /// 无窗口模式：遍历所有结构元素和大小，不创建窗口和滑动条
+  if( headless )
+  {
+    sink = samples::FrameSink::create( parser.get<String>( "output" ) );
+    for( int elem = 0; elem <= max_elem; elem++ )
+      for( int size = 0; size <= max_kernel_size; size++ )
+      {
+        erosion_elem = dilation_elem = elem;
+        erosion_size = dilation_size = size;
+        Erosion( 0, 0 );
+        Dilation( 0, 0 );
+      }
+    sink->stats().print( cout, "output", "write" );
+    return 0;
+  }
+
   /// Create windows
   /// 创建窗口
-  namedWindow( "Erosion Demo", WINDOW_AUTOSIZE );
-  namedWindow( "Dilation Demo", WINDOW_AUTOSIZE );
+  //渐进模式的预览是缩小的图像，用 WINDOW_NORMAL 窗口由窗口系统缩放到原图大小显示
+  const int flags = progressive ? WINDOW_NORMAL : WINDOW_AUTOSIZE;
+  namedWindow( "Erosion Demo", flags );
+  namedWindow( "Dilation Demo", flags );
+  if( progressive )
+  {
+    resizeWindow( "Erosion Demo", src.cols, src.rows );
+    resizeWindow( "Dilation Demo", src.cols, src.rows );
+  }
   moveWindow( "Dilation Demo", src.cols, 0 ); //移动Dilation Demo窗口的位置
+  if( gradient )
+  {
+    namedWindow( "Gradient Demo", WINDOW_AUTOSIZE );
+    moveWindow( "Gradient Demo", 2*src.cols, 0 );
+  }
 
   /// Create Erosion Trackbar
   /// 创建控制腐蚀的滑动条
@@ -87,7 +183,15 @@ int main( int argc, char** argv )
   Erosion( 0, 0 );
   Dilation( 0, 0 );
 
-  waitKey(0);
+  /// Wait for a key; in progressive mode also pick up the full-resolution results
+  /// 等待按键；渐进模式下同时取回全分辨率结果显示
+  while( waitKey( progressive ? 20 : 0 ) < 0 )
+  {
+    if( progressive && erosion_preview->poll( erosion_dst ) )
+      imshow( "Erosion Demo", erosion_dst );
+    if( progressive && dilation_preview->poll( dilation_dst ) )
+      imshow( "Dilation Demo", dilation_dst );
+  }
   return 0;
 }
 
@@ -99,6 +203,8 @@ int main( int argc, char** argv )
 //腐蚀
 void Erosion( int, void* )
 {
+  SAMPLES_TRACE_SCOPE( "Erosion" );
+  samples::AllocationStage stage( "erosion" );
   //根据erosion_elem取值选择腐蚀操作结构元素方式
   int erosion_type = 0;
   if( erosion_elem == 0 ){ erosion_type = MORPH_RECT; }
@@ -106,16 +212,47 @@ void Erosion( int, void* )
   else if( erosion_elem == 2) { erosion_type = MORPH_ELLIPSE; }
 
   //![kernel]
-  //获取操作结构元素
-  Mat element = getStructuringElement( erosion_type,
+  //获取操作结构元素的分解方案，第一次使用时调用 getStructuringElement 并缓存，plan.element() 即结构元素
+  const samples::MorphologyPlan& plan = samples::MorphologyPlan::get( erosion_type,
                        Size( 2*erosion_size + 1, 2*erosion_size+1 ),
                        Point( erosion_size, erosion_size ) );
   //![kernel]
 
   /// Apply the erosion operation
-  ///进行腐蚀操作
-  erode( src, erosion_dst, element );
-  imshow( "Erosion Demo", erosion_dst );
+  ///进行腐蚀操作，与 erode( src, erosion_dst, plan.element() ) 结果相同
+  if( gradient )
+  {
+    //梯度 = 膨胀 - 腐蚀：腐蚀、膨胀一次完成，腐蚀结果直接用于显示，膨胀结果原地减去腐蚀
+    if( binary )
+    {
+      samples::erodePacked( packed_src, packed_dst, plan );
+      packed_dst.toMat( erosion_dst );
+      samples::dilatePacked( packed_src, packed_dst, plan );
+      packed_dst.toMat( gradient_dst );
+    }
+    else
+      samples::erodeDilate( src, erosion_dst, gradient_dst, plan );
+    subtract( gradient_dst, erosion_dst, gradient_dst );
+    display( "Gradient Demo", gradient_dst );
+  }
+  else if( binary )
+  {
+    samples::erodePacked( packed_src, packed_dst, plan );
+    packed_dst.toMat( erosion_dst );
+  }
+  else if( progressive )
+  {
+    //预览用按比例缩小的核，全分辨率的行带每侧多读核半径行
+    const int shape = erosion_type, radius = erosion_size;
+    erosion_preview->request( [shape, radius]( const Mat& in, Mat& out, double scale )
+    {
+      int r = cvRound( radius*scale );
+      samples::MorphologyPlan::get( shape, Size( 2*r + 1, 2*r + 1 ), Point( r, r ) ).erode( in, out );
+    }, erosion_dst, radius );
+  }
+  else
+    plan.erode( src, erosion_dst );
+  display( "Erosion Demo", erosion_dst );
 }
 //![erosion]
 
@@ -125,28 +262,63 @@ void Erosion( int, void* )
  */
 void Dilation( int, void* )
 {
+  SAMPLES_TRACE_SCOPE( "Dilation" );
+  samples::AllocationStage stage( "dilation" );
   //根据dilation_elem取值选择膨胀结构元素的操作方式
   int dilation_type = 0;
   if( dilation_elem == 0 ){ dilation_type = MORPH_RECT; }
   else if( dilation_elem == 1 ){ dilation_type = MORPH_CROSS; }
   else if( dilation_elem == 2) { dilation_type = MORPH_ELLIPSE; }
 
-  //获取操作的结构元素
-  Mat element = getStructuringElement( dilation_type,
+  //获取操作的结构元素的分解方案（缓存）
+  const samples::MorphologyPlan& plan = samples::MorphologyPlan::get( dilation_type,
                        Size( 2*dilation_size + 1, 2*dilation_size+1 ),
                        Point( dilation_size, dilation_size ) );
 
   /// Apply the dilation operation
-  ///进行膨胀操作
-  dilate( src, dilation_dst, element );
-  imshow( "Dilation Demo", dilation_dst );
+  ///进行膨胀操作，与 dilate( src, dilation_dst, plan.element() ) 结果相同
+  if( binary )
+  {
+    samples::dilatePacked( packed_src, packed_dst, plan );
+    packed_dst.toMat( dilation_dst );
+  }
+  else if( progressive )
+  {
+    const int shape = dilation_type, radius = dilation_size;
+    dilation_preview->request( [shape, radius]( const Mat& in, Mat& out, double scale )
+    {
+      int r = cvRound( radius*scale );
+      samples::MorphologyPlan::get( shape, Size( 2*r + 1, 2*r + 1 ), Point( r, r ) ).dilate( in, out );
+    }, dilation_dst, radius );
+  }
+  else
+    plan.dilate( src, dilation_dst );
+  display( "Dilation Demo", dilation_dst );
 }
 //![dilation]
 
+/**
+ * @function display
+ */
+static void display( const char* window, const Mat& img )
+{
+  SAMPLES_TRACE_SCOPE( "display" );
+  samples::AllocationStage stage( "display" );
+  if( headless )
+    sink->write( img );
+  else
+    imshow( window, img );
+}
+
 /**
  * 要点总结：
  * moveWindow()移动窗口
  * getStructuringElement()获取结构元素
  * erode()腐蚀操作
  * dilate()膨胀操作
+ * 矩形结构元素可分解为水平、垂直两条线段，每条线段用块内前缀/后缀最值在常数时间内求出
+ * 十字、椭圆可以写成若干矩形的并，腐蚀结果取各矩形腐蚀结果的最小值，膨胀取最大值
+ * 二值图的腐蚀、膨胀是按位与、或，位压缩后 64 个像素一次运算
+ * 同一结构元素的腐蚀和膨胀可以共用一次遍历，形态学梯度 = 膨胀 - 腐蚀
+ * 渐进式预览：拖动时在缩小图像上预览，停止后工作线程分行带计算全分辨率结果，行带之间检查并取消过时的计算
 */
\ No newline at end of file
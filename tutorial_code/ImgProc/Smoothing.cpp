@@ -4,6 +4,9 @@
  * author OpenCV team
  */
 /// 图像滤波的简单示例
+/// --output 指定输出（null、含 % 的图像序列、shm:名字、视频文件）时不创建窗口，
+/// 依次把每个滤波结果写到输出，最后打印吞吐量，可在无界面环境下批量运行
+/// 退出时按滤波器打印 Mat 分配的次数、字节数和存活峰值
 
 ///头文件 
 #include <iostream>
@@ -11,6 +14,11 @@
 #include "opencv2/imgcodecs.hpp"
 #include "opencv2/highgui.hpp"
 
+#include "../common/frame_sink.hpp" //结果输出
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp"       //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
 //命名空间
 using namespace std;
 using namespace cv;
@@ -23,6 +31,8 @@ int MAX_KERNEL_LENGTH = 31;//最大
 
 Mat src; Mat dst;
 char window_name[] = "Smoothing Demo";
+bool headless = false;              //无窗口模式
+Ptr<samples::FrameSink> sink;       //无窗口模式下的输出
 
 /// Function headers
 int display_caption( const char* caption );//显示原图
@@ -36,13 +46,24 @@ int display_dst( int delay );//显示效果图
 ///主函数
 int main( int argc, char ** argv )
 {
-    namedWindow( window_name, WINDOW_AUTOSIZE );
+    CommandLineParser parser( argc, argv,
+        "{@input | ../data/lena.jpg | input image}"
+        "{output |  | write the results to null, an image pattern with %, shm:name or a video file instead of showing them}" );
+    headless = parser.has( "output" );
+    if( headless )
+        sink = samples::FrameSink::create( parser.get<String>( "output" ) );
+    else
+        namedWindow( window_name, WINDOW_AUTOSIZE );
+
+    //统计 Mat 的分配，按滤波器分阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+    samples::AllocationStage stage( "load" );
 
     /// Load the source image
     /// 加载原图
-    const char* filename = argc >=2 ? argv[1] : "../data/lena.jpg";
+    const String filename = parser.get<String>( "@input" );
 
-    src = imread( filename, IMREAD_COLOR );
+    src = samples::imreadCached( filename, IMREAD_COLOR );
     if(src.empty()){
         printf(" Error opening image\n");
         printf(" Usage: ./Smoothing [image_name -- default ../data/lena.jpg] \n");
@@ -59,46 +80,62 @@ int main( int argc, char ** argv )
     /// Applying Homogeneous blur
     if( display_caption( "Homogeneous Blur" ) != 0 ) { return 0; }
 
+    stage.enter( "blur" );
     //![blur]
     /// 调用blur均值滤波函数
     for ( int i = 1; i < MAX_KERNEL_LENGTH; i = i + 2 )
-    { blur( src, dst, Size( i, i ), Point(-1,-1) );
-        if( display_dst( DELAY_BLUR ) != 0 ) { return 0; } }
+    {
+        { SAMPLES_TRACE_SCOPE( "blur" ); blur( src, dst, Size( i, i ), Point(-1,-1) ); }
+        if( display_dst( DELAY_BLUR ) != 0 ) { return 0; }
+    }
     //![blur]
 
     /// Applying Gaussian blur
     if( display_caption( "Gaussian Blur" ) != 0 ) { return 0; }
 
+    stage.enter( "GaussianBlur" );
     //![gaussianblur]
     ///调用高斯滤波
     for ( int i = 1; i < MAX_KERNEL_LENGTH; i = i + 2 )
-    { GaussianBlur( src, dst, Size( i, i ), 0, 0 );
-        if( display_dst( DELAY_BLUR ) != 0 ) { return 0; } }
+    {
+        { SAMPLES_TRACE_SCOPE( "GaussianBlur" ); GaussianBlur( src, dst, Size( i, i ), 0, 0 ); }
+        if( display_dst( DELAY_BLUR ) != 0 ) { return 0; }
+    }
     //![gaussianblur]
 
     /// Applying Median blur
     if( display_caption( "Median Blur" ) != 0 ) { return 0; }
 
+    stage.enter( "medianBlur" );
     //![medianblur]
     ///中值滤波
     for ( int i = 1; i < MAX_KERNEL_LENGTH; i = i + 2 )
-    { medianBlur ( src, dst, i );
-        if( display_dst( DELAY_BLUR ) != 0 ) { return 0; } }
+    {
+        { SAMPLES_TRACE_SCOPE( "medianBlur" ); medianBlur ( src, dst, i ); }
+        if( display_dst( DELAY_BLUR ) != 0 ) { return 0; }
+    }
     //![medianblur]
 
     /// Applying Bilateral Filter
     if( display_caption( "Bilateral Blur" ) != 0 ) { return 0; }
 
+    stage.enter( "bilateralFilter" );
     //![bilateralfilter]
     ///双边滤波
     for ( int i = 1; i < MAX_KERNEL_LENGTH; i = i + 2 )
-    { bilateralFilter ( src, dst, i, i*2, i/2 );
-        if( display_dst( DELAY_BLUR ) != 0 ) { return 0; } }
+    {
+        { SAMPLES_TRACE_SCOPE( "bilateralFilter" ); bilateralFilter ( src, dst, i, i*2, i/2 ); }
+        if( display_dst( DELAY_BLUR ) != 0 ) { return 0; }
+    }
     //![bilateralfilter]
 
     /// Done
     display_caption( "Done!" );
 
+    //无窗口模式：打印写出的帧数和吞吐量
+    if( headless )
+        sink->stats().print( cout, "output", "write" );
+
     return 0;
 }
 
@@ -107,6 +144,9 @@ int main( int argc, char ** argv )
  */
 int display_caption( const char* caption )
 {
+    //标题只给看窗口的人，无窗口模式跳过
+    if( headless ) { return 0; }
+
     dst = Mat::zeros( src.size(), src.type() );
     putText( dst, caption,
              Point( src.cols/4, src.rows/2),
@@ -120,6 +160,10 @@ int display_caption( const char* caption )
  */
 int display_dst( int delay )
 {
+    SAMPLES_TRACE_SCOPE( "display" );
+    //无窗口模式：写到输出，不等待
+    if( headless ) { return sink->write( dst ) ? 0 : -1; }
+
     imshow( window_name, dst );
     int c = waitKey ( delay );
     if( c >= 0 ) { return -1; }
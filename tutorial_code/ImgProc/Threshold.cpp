@@ -14,12 +14,28 @@
 #include "opencv2/imgcodecs.hpp"    //图像读取和写入相关
 #include "opencv2/highgui.hpp"      //GUI相关
 
+#include "../common/incremental_threshold.hpp" //增量阈值
+#include "../common/latency_histogram.hpp" //分阶段延迟直方图
+#include "../common/progressive_preview.hpp" //渐进式预览
+#include "../common/frame_sink.hpp" //无窗口模式的结果输出
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp" //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
+#include <iostream>
+
 /**
  * 程序流程:
  * 1、加载图像，命令行输入图像路径或者默认
  * 2、初始化变量，创建窗口
  * 3、创建滑动条
  * 4、调用显示
+ * 5、等待按键时每隔 --report 秒打印这段时间内的延迟分位数
+ * 6、退出时打印各阶段（转换、建索引、阈值、显示）的延迟分位数，可选导出到文件，以及各阶段 Mat 分配的汇总
+ * --progressive 时滑动条回调只在缩小的图像上阈值化并立即显示，
+ * 滑动条停止后由工作线程计算全分辨率结果，在等待按键的循环里取回显示，
+ * 窗口用 WINDOW_NORMAL 创建，缩小的预览由窗口缩放显示
+ * --output 指定输出时不创建窗口和滑动条，遍历所有类型和阈值，结果写到输出（批处理、吞吐量测量）
 */
 
 
@@ -38,6 +54,20 @@ int const max_BINARY_value = 255;   //二值化图像的最大值
 Mat src, src_gray, dst;
 const char* window_name = "Threshold Demo";
 
+// 按灰度排序的像素索引，滑动条移动时只改写跨过阈值的像素
+samples::IncrementalThreshold thresholder;
+
+// 渐进模式：预览和后台全分辨率计算，未启用时为空
+Ptr<samples::ProgressivePreview> preview;
+
+// 无窗口模式的输出
+bool headless = false;
+Ptr<samples::FrameSink> sink;
+
+// 各阶段的延迟直方图
+enum Stage { CONVERT, INDEX, THRESHOLD, DISPLAY };
+samples::LatencyRecorder latency( { "convert", "index", "threshold", "display" } );
+
 //滑动条
 const char* trackbar_type = "Type: \n 0: Binary \n 1: Binary Inverted \n 2: Truncate \n 3: To Zero \n 4: To Zero Inverted";
 const char* trackbar_value = "Value";
@@ -53,50 +83,115 @@ void Threshold_Demo( int, void* );
 int main( int argc, char** argv )
 {
   //! [load]
-  // 加载图像
-  String imageName("../data/stuff.jpg"); // by default， 默认路径
-  if (argc > 1)
-  {
-      imageName = argv[1];//或者命令行参数输入图像路径
-  }
+  // 加载图像，命令行参数输入图像路径，否则使用默认路径
+  CommandLineParser parser( argc, argv,
+    "{@input      | ../data/stuff.jpg | input image}"
+    "{@latency    |       | optional file the latency histograms are exported to}"
+    "{report      | 5     | print latency percentiles every this many seconds, 0 only at exit}"
+    "{progressive | false | show a downscaled preview while dragging and refine to full resolution on a worker thread}"
+    "{output      |       | sweep all types and values into null, an image pattern with %, shm:name or a video file instead of showing them}" );
+  String imageName = parser.get<String>( "@input" );
+  headless = parser.has( "output" );
+
+  //统计 Mat 的分配，按阶段汇总，退出时打印
+  samples::AllocationTracker::install();
+  samples::AllocationStage stage( "load" );
 
   //加载图像
-  src = imread( imageName, IMREAD_COLOR ); // Load an image
+  src = samples::imreadCached( imageName, IMREAD_COLOR ); // Load an image
 
   if( src.empty() )
     { return -1; }
 
-  //图像转为灰度图
-  cvtColor( src, src_gray, COLOR_BGR2GRAY ); // Convert the image to Gray
+  {
+    samples::LatencyRecorder::Scope scope( latency, CONVERT );
+    SAMPLES_TRACE_SCOPE( "convert" );
+    samples::AllocationStage convert( "convert" );
+    //图像转为灰度图
+    cvtColor( src, src_gray, COLOR_BGR2GRAY ); // Convert the image to Gray
+  }
+
+  {
+    samples::LatencyRecorder::Scope scope( latency, INDEX );
+    SAMPLES_TRACE_SCOPE( "index" );
+    samples::AllocationStage index( "index" );
+    //建立一次灰度索引，渐进模式改为准备预览用的缩小图像
+    if( parser.get<bool>( "progressive" ) && !headless )
+    {
+      preview = makePtr<samples::ProgressivePreview>();
+      preview->setSource( src_gray );
+    }
+    else
+      thresholder.build( src_gray );
+  }
   //! [load]
+  stage.enter( "display" );
 
-  //! [window]
-  //创建窗口
-  namedWindow( window_name, WINDOW_AUTOSIZE ); // Create a window to display results
-  //! [window]
+  /// Headless: sweep every type and value through the output instead of waiting for the trackbars
+  /// 无窗口模式：不创建窗口和滑动条，遍历所有类型和阈值，结果写到输出
+  if( headless )
+  {
+    sink = samples::FrameSink::create( parser.get<String>( "output" ) );
+    for( threshold_type = 0; threshold_type <= max_type; threshold_type++ )
+      for( threshold_value = 0; threshold_value <= max_value; threshold_value++ )
+        Threshold_Demo( 0, 0 );
+    sink->stats().print( std::cout, "output", "write" );
+  }
+  else
+  {
+    //! [window]
+    //创建窗口，渐进模式的预览是缩小的图像，用 WINDOW_NORMAL 窗口由窗口系统缩放到原图大小显示
+    namedWindow( window_name, preview ? WINDOW_NORMAL : WINDOW_AUTOSIZE ); // Create a window to display results
+    if( preview )
+      resizeWindow( window_name, src.cols, src.rows );
+    //! [window]
 
-  //! [trackbar]
-  // 创建滑动条
-  createTrackbar( trackbar_type,
-                  window_name, &threshold_type,
-                  max_type, Threshold_Demo ); // Create Trackbar to choose type of Threshold
+    //! [trackbar]
+    // 创建滑动条
+    createTrackbar( trackbar_type,
+                    window_name, &threshold_type,
+                    max_type, Threshold_Demo ); // Create Trackbar to choose type of Threshold
 
-  createTrackbar( trackbar_value,
-                  window_name, &threshold_value,
-                  max_value, Threshold_Demo ); // Create Trackbar to choose Threshold value
-  //! [trackbar]
+    createTrackbar( trackbar_value,
+                    window_name, &threshold_value,
+                    max_value, Threshold_Demo ); // Create Trackbar to choose Threshold value
+    //! [trackbar]
 
-  //调用显示
-  Threshold_Demo( 0, 0 ); // Call the function to initialize
+    //调用显示
+    Threshold_Demo( 0, 0 ); // Call the function to initialize
 
-  /// Wait until user finishes program
-  /// 等待按下 esc 键退出
-  for(;;)
-    {
-      char c = (char)waitKey( 20 );
-      if( c == 27 )
-    { break; }
-    }
+    /// Wait until user finishes program
+    /// 等待按下 esc 键退出，每隔 --report 秒打印一次延迟分位数
+    const double report_seconds = parser.get<double>( "report" );
+    int64 last_report = getTickCount();
+    for(;;)
+      {
+        char c = (char)waitKey( 20 );
+        if( c == 27 )
+      { break; }
+
+        if( report_seconds > 0 && getTickCount() - last_report > report_seconds*getTickFrequency() )
+      {
+        std::cout << "Latency over the last " << report_seconds << " s:" << std::endl;
+        latency.report( std::cout ); //只统计这段时间内的事件
+        last_report = getTickCount();
+      }
+
+        //全分辨率结果就绪时替换预览
+        if( preview && preview->poll( dst ) )
+      {
+        samples::LatencyRecorder::Scope scope( latency, DISPLAY );
+        SAMPLES_TRACE_SCOPE( "display" );
+        imshow( window_name, dst );
+      }
+      }
+  }
+
+  /// Latency percentiles of every stage; the second positional argument names an optional CSV export
+  /// 打印延迟分位数，第二个命令行参数可指定导出文件
+  latency.print( std::cout, latency.snapshot() );
+  if( !parser.get<String>( "@latency" ).empty() )
+    { latency.exportTo( parser.get<String>( "@latency" ) ); }
 
 }
 
@@ -122,14 +217,45 @@ void Threshold_Demo( int, void* )
    * 4、反0阈值，与0阈值相反
   */
 
-  //调用阈值分割函数
-  threshold( src_gray, dst, threshold_value, max_BINARY_value,threshold_type );
+  samples::AllocationStage stage( "threshold" );
+
+  //调用阈值分割函数，结果与 threshold( src_gray, dst, threshold_value, max_BINARY_value, threshold_type ) 相同
+  //只有阈值变化时增量更新，类型变化时整幅重算
+  //渐进模式：立即阈值化缩小的图像，全分辨率结果稍后由 main 中的循环显示
+  //参数按值捕获，工作线程不读取滑动条变量
+  if( preview )
+  {
+    samples::LatencyRecorder::Scope scope( latency, THRESHOLD );
+    SAMPLES_TRACE_SCOPE( "threshold" );
+    const double thresh = threshold_value;
+    const int type = threshold_type;
+    preview->request( [thresh, type]( const Mat& in, Mat& out, double )
+    {
+      threshold( in, out, thresh, max_BINARY_value, type );
+    }, dst );
+  }
+  else
+  {
+    samples::LatencyRecorder::Scope scope( latency, THRESHOLD );
+    SAMPLES_TRACE_SCOPE( "threshold" );
+    dst = thresholder.apply( threshold_value, max_BINARY_value, threshold_type );
+  }
 
-  imshow( window_name, dst );
+  samples::LatencyRecorder::Scope scope( latency, DISPLAY );
+  SAMPLES_TRACE_SCOPE( "display" );
+  stage.enter( "display" );
+  if( headless )
+    sink->write( dst );
+  else
+    imshow( window_name, dst );
 }
 //![Threshold_Demo]
 
 /**
  * 要点总结
  * 阈值操作的类型，二进制、反二进制、阈值截断、0阈值、反0阈值
+ * 阈值从 t1 变为 t2 时，只有灰度在 (t1, t2] 之间的像素结果改变，可以增量更新
+ * 用直方图记录每个阶段的延迟，看 p99 和最大值而不只是平均值
+ * 拖动时先显示缩小图像的结果，停止后再在工作线程上计算全分辨率结果，过时的计算被取消，GUI 线程不等待
+ * 结果写到可替换的输出（丢弃、图像序列、视频、共享内存），无窗口也能运行，测量不含显示时间
 */
@@ -0,0 +1,112 @@
+/**
+ * @file Threshold_Fused.cpp
+ * @brief Fused BGR->gray + threshold kernel compared with cvtColor() followed by threshold()
+ * @author OpenCV team
+ */
+
+/**
+ * 融合的颜色转换与阈值
+ * 对五种阈值类型，比较 cvtColor + threshold 两步与一次融合的耗时，并逐位比较结果。
+ * 两步版本每像素读 3 字节、写 1 字节灰度、再读 1 字节、写 1 字节；融合版本读 3 字节、写 1 字节。
+ */
+
+//头文件
+#include <iostream>
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/highgui.hpp"
+
+#include "../common/fused_color_threshold.hpp"
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp" //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
+//命名空间
+using namespace std;
+using namespace cv;
+
+/**
+ * @function main
+ */
+int main( int argc, char** argv )
+{
+    CommandLineParser parser( argc, argv,
+        "{@input | ../data/stuff.jpg | input image}"
+        "{width  | 7680 | width the image is resized to}"
+        "{height | 4320 | height the image is resized to}"
+        "{runs   | 20   | runs averaged per measurement}" );
+
+    //统计 Mat 的分配，按阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+    samples::AllocationStage stage( "setup" );
+
+    Mat img = samples::imreadCached( parser.get<String>( "@input" ), IMREAD_COLOR );
+    if( img.empty() )
+    {
+        cout << "Usage: " << argv[0] << " <Input image>" << endl;
+        return -1;
+    }
+    Mat src;
+    resize( img, src, Size( parser.get<int>( "width" ), parser.get<int>( "height" ) ), 0, 0, INTER_LINEAR );
+    const int runs = std::max( parser.get<int>( "runs" ), 1 );
+
+    const char* names[] = { "Binary", "Binary Inverted", "Truncate", "To Zero", "To Zero Inverted" };
+    Mat src_gray, dst, fused;
+    for( int type = THRESH_BINARY; type <= THRESH_TOZERO_INV; type++ )
+    {
+        /// Bit-exactness over every threshold value
+        /// 所有阈值下逐位比较
+        stage.enter( "check" );
+        bool identical = true;
+        for( int value = -1; value <= 256 && identical; value++ )
+        {
+            cvtColor( src, src_gray, COLOR_BGR2GRAY );
+            threshold( src_gray, dst, value, 255, type );
+            samples::cvtColorThreshold( src, fused, value, 255, type );
+            identical = norm( dst, fused, NORM_INF ) == 0;
+            if( !identical )
+                cout << "  mismatch at threshold " << value << endl;
+        }
+
+        stage.enter( "cvtColor+threshold" );
+        //![two_step]
+        double t = (double)getTickCount();
+        for( int i = 0; i < runs; i++ )
+        {
+            { SAMPLES_TRACE_SCOPE( "cvtColor" ); cvtColor( src, src_gray, COLOR_BGR2GRAY ); }
+            { SAMPLES_TRACE_SCOPE( "threshold" ); threshold( src_gray, dst, 128, 255, type ); }
+        }
+        double tTwoStep = 1000*((double)getTickCount() - t)/getTickFrequency()/runs;
+        //![two_step]
+
+        stage.enter( "cvtColorThreshold" );
+        //![fused]
+        t = (double)getTickCount();
+        for( int i = 0; i < runs; i++ )
+        {
+            SAMPLES_TRACE_SCOPE( "cvtColorThreshold" );
+            samples::cvtColorThreshold( src, fused, 128, 255, type );
+        }
+        double tFused = 1000*((double)getTickCount() - t)/getTickFrequency()/runs;
+        //![fused]
+
+        cout << names[type] << ": cvtColor+threshold " << tTwoStep << " ms, fused " << tFused
+             << " ms, " << (identical ? "bit-identical" : "NOT identical") << endl;
+    }
+
+    stage.enter( "display" );
+    Mat show;
+    resize( fused, show, Size(), 0.125, 0.125, INTER_AREA );
+    imshow( "Fused Threshold", show );
+    waitKey(0);
+    return 0;
+}
+
+/**
+ * 要点总结
+ * BGR2GRAY 的 8 位定点公式 (1868*B + 9617*G + 4899*R + 8192) >> 14
+ * v_load_deinterleave 读取交错的 BGR，v_dotprod 计算两两乘加
+ * 五种阈值都可以用比较掩码加 v_and / v_min 表示
+ * 融合后不再写出和读回中间灰度图
+ */
@@ -0,0 +1,139 @@
+/**
+ * @file Threshold_Incremental.cpp
+ * @brief Benchmark of incremental re-thresholding against full threshold() calls
+ * @author OpenCV team
+ */
+
+/**
+ * 增量阈值的基准测试
+ * 模拟 Threshold.cpp 中的滑动条：阈值每次移动 1，比较整幅 threshold() 与增量更新的耗时；
+ * 再比较 0..255 全部阈值的批量扫描。每一步都检查结果与 threshold() 完全一致。
+ */
+
+//头文件
+#include <iostream>
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+
+#include "../common/incremental_threshold.hpp"
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp" //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
+//命名空间
+using namespace std;
+using namespace cv;
+
+/**
+ * @function main
+ */
+int main( int argc, char** argv )
+{
+    CommandLineParser parser( argc, argv,
+        "{@input | ../data/stuff.jpg | input image}"
+        "{mp     | 100 | megapixels the gray image is resized to, 0 keeps the original size}" );
+
+    //统计 Mat 的分配，按阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+    samples::AllocationStage stage( "setup" );
+
+    //! [load]
+    Mat src = samples::imreadCached( parser.get<String>( "@input" ), IMREAD_COLOR );
+    if( src.empty() )
+    {
+        cout << "Usage: " << argv[0] << " <Input image> [--mp=100]" << endl;
+        return -1;
+    }
+    Mat src_gray;
+    cvtColor( src, src_gray, COLOR_BGR2GRAY );
+
+    // 放大到指定的像素数
+    double mp = parser.get<double>( "mp" );
+    if( mp > 0 )
+    {
+        double scale = std::sqrt( mp*1e6/src_gray.total() );
+        resize( src_gray, src_gray, Size(), scale, scale, INTER_LINEAR );
+    }
+    //! [load]
+
+    const double maxval = 255;
+    samples::IncrementalThreshold thresholder;
+
+    stage.enter( "build index" );
+    double t = (double)getTickCount();
+    {
+        SAMPLES_TRACE_SCOPE( "build index" );
+        thresholder.build( src_gray );
+    }
+    t = 1000*((double)getTickCount() - t)/getTickFrequency();
+    cout << "Image " << src_gray.cols << "x" << src_gray.rows << ", index built in " << t << " ms" << endl;
+
+    const char* names[] = { "Binary", "Binary Inverted", "Truncate", "To Zero", "To Zero Inverted" };
+    Mat reference;
+    for( int type = THRESH_BINARY; type <= THRESH_TOZERO_INV; type++ )
+    {
+        /// Slider drag: 100 -> 140 one step at a time
+        /// 模拟拖动滑动条，每次移动 1
+        stage.enter( "drag" );
+        double tFull = 0, tInc = 0;
+        size_t updated = 0;
+        bool identical = true;
+        thresholder.apply( 100, maxval, type );
+        for( int value = 101; value <= 140; value++ )
+        {
+            t = (double)getTickCount();
+            {
+                SAMPLES_TRACE_SCOPE( "threshold" );
+                threshold( src_gray, reference, value, maxval, type );
+            }
+            tFull += (double)getTickCount() - t;
+
+            t = (double)getTickCount();
+            const Mat& dst = thresholder.apply( value, maxval, type );
+            tInc += (double)getTickCount() - t;
+
+            updated += thresholder.lastUpdated();
+            identical = identical && norm( reference, dst, NORM_INF ) == 0;
+        }
+        tFull = 1000*tFull/getTickFrequency()/40;
+        tInc = 1000*tInc/getTickFrequency()/40;
+
+        /// Batch sweep over all 256 thresholds
+        /// 批量扫描 0..255
+        stage.enter( "sweep" );
+        t = (double)getTickCount();
+        for( int value = 0; value < 256; value++ )
+        {
+            SAMPLES_TRACE_SCOPE( "threshold sweep" );
+            threshold( src_gray, reference, value, maxval, type );
+        }
+        double tSweepFull = 1000*((double)getTickCount() - t)/getTickFrequency();
+
+        // 换一次类型，保证扫描从整幅计算开始；这一次整幅计算不计时，计时部分只有扫描自己的一次整幅计算加增量
+        thresholder.apply( 0, maxval, (type + 1) % 5 );
+        t = (double)getTickCount();
+        {
+            SAMPLES_TRACE_SCOPE( "incremental sweep" );
+            thresholder.sweep( maxval, type, []( int, const Mat& ) {} );
+        }
+        double tSweepInc = 1000*((double)getTickCount() - t)/getTickFrequency();
+
+        thresholder.apply( 255, maxval, type );
+        threshold( src_gray, reference, 255, maxval, type );
+        identical = identical && norm( reference, thresholder.result(), NORM_INF ) == 0;
+
+        cout << names[type] << ": step " << tFull << " ms full / " << tInc << " ms incremental ("
+             << 100.0*updated/40/src_gray.total() << "% pixels per step), sweep "
+             << tSweepFull << " ms / " << tSweepInc << " ms, "
+             << (identical ? "identical" : "MISMATCH") << endl;
+    }
+    return 0;
+}
+
+/**
+ * 要点总结
+ * 计数排序：直方图 -> 前缀和 -> 按灰度分桶写入位置
+ * 阈值变化时只改写灰度跨过阈值的像素，THRESH_TRUNC 需要改写所有高于阈值的像素
+ * 批量扫描 256 个阈值只需要一次整幅计算加上所有增量
+ */
@@ -0,0 +1,163 @@
+/**
+ * @file Threshold_MultiRange.cpp
+ * @brief Single-pass multi-class color segmentation compared with one inRange call per class
+ * @author OpenCV team
+ */
+
+/**
+ * 多类颜色分割的基准测试
+ * 对 N 个颜色范围（BGR 或 HSV），比较：
+ *  - 参考做法：(cvtColor 到 HSV) + 每类一次 inRange，再按类别顺序合成标签图
+ *  - MultiRangeClassifier：一次扫描直接得到标签图，HSV 在行缓冲中转换
+ * 并检查两种做法得到的标签图完全一致。
+ */
+
+//头文件
+#include <iostream>
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/highgui.hpp"
+
+#include "../common/color_classifier.hpp"
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/timing.hpp" //基准测试计时
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
+//命名空间
+using namespace std;
+using namespace cv;
+using samples::timeMs;
+using samples::MultiRangeClassifier;
+
+/// n random boxes; HSV boxes split the hue axis into n bands, BGR boxes are random cubes
+/// 随机生成 n 个颜色范围：HSV 按色调分成 n 段，BGR 为随机立方体
+static void makeBoxes( int n, bool hsv, RNG& rng, vector<Scalar>& low, vector<Scalar>& high )
+{
+    low.clear(); high.clear();
+    for( int k = 0; k < n; k++ )
+    {
+        if( hsv )
+        {
+            low.push_back( Scalar( 180*k/n, rng.uniform( 30, 90 ), rng.uniform( 30, 90 ) ) );
+            high.push_back( Scalar( 180*(k + 1)/n - 1, 255, 255 ) );
+        }
+        else
+        {
+            Scalar l( rng.uniform( 0, 200 ), rng.uniform( 0, 200 ), rng.uniform( 0, 200 ) );
+            low.push_back( l );
+            high.push_back( l + Scalar( rng.uniform( 20, 100 ), rng.uniform( 20, 100 ), rng.uniform( 20, 100 ) ) );
+        }
+    }
+}
+
+/// Reference label map: one inRange per class, earlier classes win
+/// 参考实现：逐类 inRange，逆序 setTo 使前面的类别优先
+static void referenceLabels( const Mat& src, const vector<Scalar>& low, const vector<Scalar>& high,
+                             Mat& labels, Mat& mask )
+{
+    labels.create( src.size(), CV_8UC1 );
+    labels.setTo( 0 );
+    for( int k = (int)low.size() - 1; k >= 0; k-- )
+    {
+        inRange( src, low[k], high[k], mask );
+        labels.setTo( k + 1, mask );
+    }
+}
+
+/// Runs one configuration and prints timings and the agreement check
+static void benchmark( const Mat& src, int n, bool hsv, int runs, RNG& rng, Mat& labels )
+{
+    vector<Scalar> low, high;
+    makeBoxes( n, hsv, rng, low, high );
+
+    MultiRangeClassifier classifier( hsv ? MultiRangeClassifier::HSV : MultiRangeClassifier::BGR );
+    for( int k = 0; k < n; k++ )
+        classifier.addClass( low[k], high[k] );
+
+    Mat converted, mask, reference;
+    double tInRange = timeMs( "n x inRange", runs, [&]{
+        if( hsv )
+            cvtColor( src, converted, COLOR_BGR2HSV );
+        const Mat& in = hsv ? converted : src;
+        for( int k = 0; k < n; k++ )
+            inRange( in, low[k], high[k], mask );
+    } );
+    double tReference = timeMs( "reference labels", runs, [&]{
+        if( hsv )
+            cvtColor( src, converted, COLOR_BGR2HSV );
+        referenceLabels( hsv ? converted : src, low, high, reference, mask );
+    } );
+    double tSingle = timeMs( "classify", runs, [&]{ classifier.classify( src, labels ); } );
+
+    bool same = norm( labels, reference, NORM_INF ) == 0;
+    cout << n << " classes " << (hsv ? "HSV" : "BGR") << (same ? "" : "  [MISMATCH]") << endl
+         << "  " << n << " x inRange:     " << tInRange << " ms" << endl
+         << "  + label map:      " << tReference << " ms" << endl
+         << "  single pass:      " << tSingle << " ms (x" << tReference/tSingle << ")" << endl;
+}
+
+/**
+ * @function main
+ */
+int main( int argc, char** argv )
+{
+    CommandLineParser parser( argc, argv,
+        "{@input | ../data/stuff.jpg | input image}"
+        "{width  | 3840 | width the image is resized to}"
+        "{height | 2160 | height the image is resized to}"
+        "{runs   | 10   | runs averaged per measurement}"
+        "{show   | false | display the label map of the last configuration}" );
+
+    //统计 Mat 的分配，按阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+    samples::AllocationStage stage( "setup" );
+
+    Mat img = samples::imreadCached( parser.get<String>( "@input" ), IMREAD_COLOR );
+    if( img.empty() )
+    {
+        cout << "Usage: " << argv[0] << " <Input image>" << endl;
+        return -1;
+    }
+    Mat src;
+    resize( img, src, Size( parser.get<int>( "width" ), parser.get<int>( "height" ) ), 0, 0, INTER_LINEAR );
+    const int runs = std::max( parser.get<int>( "runs" ), 1 );
+
+    //! [benchmark]
+    RNG rng( 0x1234 );
+    Mat labels;
+    const int counts[] = { 1, 4, 8, 16 };
+    for( int hsv = 0; hsv < 2; hsv++ )
+        for( size_t i = 0; i < sizeof(counts)/sizeof(counts[0]); i++ )
+            benchmark( src, counts[i], hsv != 0, runs, rng, labels );
+    //! [benchmark]
+
+    stage.enter( "display" );
+    //! [show]
+    /// Label k is drawn with the k-th color of a fixed palette
+    /// 按标签上色显示
+    if( parser.get<bool>( "show" ) )
+    {
+        Mat lut( 1, 256, CV_8UC3, Scalar::all( 0 ) );
+        RNG palette( 7 );
+        for( int k = 1; k < 256; k++ )
+            lut.at<Vec3b>( k ) = Vec3b( (uchar)palette.uniform( 64, 256 ), (uchar)palette.uniform( 64, 256 ),
+                                        (uchar)palette.uniform( 64, 256 ) );
+        Mat labels3, colored;
+        cvtColor( labels, labels3, COLOR_GRAY2BGR );
+        LUT( labels3, lut, colored );
+        namedWindow( "Labels", WINDOW_NORMAL );
+        imshow( "Labels", colored );
+        waitKey( 0 );
+    }
+    //! [show]
+    return 0;
+}
+
+/**
+ * 要点总结
+ * N 次 inRange 要把整帧读 N 遍，单次扫描只读一遍
+ * 每个像素对所有类别做比较，逆序 v_select 让第一个匹配的类别留下
+ * HSV 在 L1 中的行缓冲里转换，不生成整幅 HSV 图像
+ * 标签图一个字节就能区分 255 个类别
+ */
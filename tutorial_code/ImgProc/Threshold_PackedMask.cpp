@@ -0,0 +1,122 @@
+/**
+ * @file Threshold_PackedMask.cpp
+ * @brief 1-bit packed masks from threshold/inRange compared with CV_8U masks
+ * @author OpenCV team
+ */
+
+/**
+ * 位压缩掩码的基准测试
+ * 分别用 threshold、inRange 生成 CV_8U 掩码和 PackedMask，比较：
+ * 生成耗时、内存大小、面积（countNonZero / popcount）、外接矩形（boundingRect）和游程编码大小，
+ * 并检查两种掩码内容一致。
+ * Threshold_inRange.cpp 的 --packed 在处理线程中直接写出 PackedMask；Threshold.cpp 演示五种阈值类型，
+ * 其中只有二值、反二值的结果是掩码，且已用增量阈值更新 CV_8U 结果，所以不改用 PackedMask。
+ */
+
+//头文件
+#include <iostream>
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+
+#include "../common/packed_mask.hpp"
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/timing.hpp" //基准测试计时
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
+//命名空间
+using namespace std;
+using namespace cv;
+using samples::timeMs;
+using samples::PackedMask;
+
+/// Prints the byte-mask and packed-mask measurements side by side
+static void report( const char* name, const Mat& bytes, const PackedMask& packed,
+                    double tBytes, double tPacked, int runs )
+{
+    size_t areaBytes = 0, areaPacked = 0;
+    Rect boxBytes, boxPacked;
+    double tAreaBytes = timeMs( "countNonZero", runs, [&]{ areaBytes = (size_t)countNonZero( bytes ); } );
+    double tAreaPacked = timeMs( "PackedMask area", runs, [&]{ areaPacked = packed.area(); } );
+    double tBoxBytes = timeMs( "boundingRect", runs, [&]{ boxBytes = boundingRect( bytes ); } );
+    double tBoxPacked = timeMs( "PackedMask boundingRect", runs, [&]{ boxPacked = packed.boundingRect(); } );
+
+    vector<unsigned> rle;
+    double tRle = timeMs( "encodeRLE", runs, [&]{ rle = packed.encodeRLE(); } );
+
+    Mat unpacked;
+    packed.toMat( unpacked );
+    bool same = norm( unpacked, bytes, NORM_INF ) == 0 && areaBytes == areaPacked && boxBytes == boxPacked;
+
+    cout << name << (same ? "" : "  [MISMATCH]") << endl
+         << "  create:  " << tBytes << " ms (8U) / " << tPacked << " ms (packed)" << endl
+         << "  memory:  " << bytes.total()/1024 << " KB / " << packed.bytes()/1024 << " KB, RLE "
+         << rle.size()*sizeof(unsigned)/1024 << " KB (" << rle.size() << " runs, " << tRle << " ms)" << endl
+         << "  area:    " << tAreaBytes << " ms / " << tAreaPacked << " ms (" << areaPacked << " px)" << endl
+         << "  bbox:    " << tBoxBytes << " ms / " << tBoxPacked << " ms " << boxPacked << endl;
+}
+
+/**
+ * @function main
+ */
+int main( int argc, char** argv )
+{
+    CommandLineParser parser( argc, argv,
+        "{@input | ../data/stuff.jpg | input image}"
+        "{width  | 7680 | width the image is resized to}"
+        "{height | 4320 | height the image is resized to}"
+        "{runs   | 10   | runs averaged per measurement}" );
+
+    //统计 Mat 的分配，按阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+    samples::AllocationStage stage( "setup" );
+
+    Mat img = samples::imreadCached( parser.get<String>( "@input" ), IMREAD_COLOR );
+    if( img.empty() )
+    {
+        cout << "Usage: " << argv[0] << " <Input image>" << endl;
+        return -1;
+    }
+    Mat src, src_gray;
+    resize( img, src, Size( parser.get<int>( "width" ), parser.get<int>( "height" ) ), 0, 0, INTER_LINEAR );
+    cvtColor( src, src_gray, COLOR_BGR2GRAY );
+    const int runs = std::max( parser.get<int>( "runs" ), 1 );
+
+    Mat mask;
+    PackedMask packed;
+
+    //! [threshold]
+    /// threshold: byte mask with maxval 255 vs packed mask
+    double tBytes = timeMs( "threshold", runs, [&]{ threshold( src_gray, mask, 128, 255, THRESH_BINARY ); } );
+    double tPacked = timeMs( "thresholdPacked", runs, [&]{ samples::thresholdPacked( src_gray, packed, 128, THRESH_BINARY ); } );
+    report( "threshold 128", mask, packed, tBytes, tPacked, runs );
+    //! [threshold]
+
+    //! [inRange]
+    /// inRange with the default box of Threshold_inRange.cpp
+    Scalar low( 30, 30, 30 ), high( 100, 100, 100 );
+    tBytes = timeMs( "inRange", runs, [&]{ inRange( src, low, high, mask ); } );
+    tPacked = timeMs( "inRangePacked", runs, [&]{ samples::inRangePacked( src, low, high, packed ); } );
+    report( "inRange (30,30,30)-(100,100,100)", mask, packed, tBytes, tPacked, runs );
+    //! [inRange]
+
+    //! [rle]
+    /// Round trip through the run-length encoding
+    /// 游程编码往返检查
+    PackedMask decoded;
+    decoded.decodeRLE( packed.size(), packed.encodeRLE() );
+    Mat a, b;
+    packed.toMat( a );
+    decoded.toMat( b );
+    cout << "RLE round trip: " << (norm( a, b, NORM_INF ) == 0 ? "ok" : "FAILED") << endl;
+    //! [rle]
+    return 0;
+}
+
+/**
+ * 要点总结
+ * 二值掩码每像素只需要 1 位，64 个像素存进一个 uint64
+ * v_signmask 把比较结果的每个通道压成一位
+ * popcount 统计面积，最低/最高置位位置求外接矩形
+ * 游程编码交替记录 0 和 1 的长度
+ */
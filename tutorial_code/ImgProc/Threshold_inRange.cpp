@@ -1,11 +1,38 @@
 //彩色图像的阈值操作，inRange()，在目标检测上面的应用
 
+/**
+ * 程序流程
+ * 采集、处理、显示分成三个阶段，由两个单生产者/单消费者无锁环形缓冲连接：
+ *   采集线程 cap >> frame  ->  [captured]  ->  处理线程 inRange  ->  [processed]  ->  主线程 imshow
+ * 环形缓冲的帧预先分配、用 swap 传递，不复制图像；缓冲满时可以丢弃最旧的帧(drop)或等待(block)。
+ * 滑动条的阈值通过一个无锁快照(std::atomic)发布给处理线程，处理线程不直接读 low_r 等全局变量。
+ * 帧来源可以是摄像头、视频文件、图像序列或确定性的合成画面，便于在没有摄像头的机器上复现测试。
+ * 每帧的采集、阈值、显示耗时以及从采集完成到显示的端到端延迟记录在直方图中，定期打印 p50/p99/max。
+ * 跟踪模式(--track)下只在上一次检测结果周围扩大后的区域内做 inRange，每隔 rescan 帧或目标丢失时扫描整帧。
+ * 三个线程的 Mat 分配分别记到采集、阈值、显示阶段，退出时打印；稳定运行后环形缓冲的帧应当不再分配。
+ * --output 指定输出时不创建窗口和滑动条，检测结果写到输出，来源结束（或 --frames 帧）后退出。
+ * --packed 时处理线程用 inRangePacked 直接写出每像素 1 位的掩码，经环形缓冲交给显示线程后才展开成 CV_8U，不能与 --track 同时使用。
+ */
+
 //头文件
 #include "opencv2/imgproc.hpp" //图像处理相关
 #include "opencv2/highgui.hpp" //GUI相关
+#include "opencv2/videoio.hpp" //视频读取相关
 
+#include <atomic>
+#include <cstring>
 #include <iostream>
 #include <stdlib.h>
+#include <thread>
+
+#include "../common/frame_source.hpp" //帧来源：摄像头、视频回放、图像序列、合成画面
+#include "../common/frame_sink.hpp" //无窗口模式的结果输出
+#include "../common/latency_histogram.hpp" //分阶段延迟直方图
+#include "../common/packed_mask.hpp" //位压缩掩码
+#include "../common/roi_tracker.hpp" //只处理目标附近的区域
+#include "../common/spsc_ring.hpp" //无锁环形缓冲
+#include "../common/trace.hpp" //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
 
 //命名空间
 using namespace std;
@@ -25,56 +52,274 @@ void on_high_b_thresh_trackbar(int, void *);
 int low_r=30, low_g=30, low_b=30;
 int high_r=100, high_g=100, high_b=100;
 
+/// Thresholds as seen by the processing thread, BGR order; 8 bytes so std::atomic stays lock-free
+/// 处理线程使用的阈值快照，B、G、R 顺序；8 字节，std::atomic 无锁
+struct RangeSnapshot { uchar low[4]; uchar high[4]; };
+std::atomic<RangeSnapshot> range_snapshot;
+
+/// A captured frame and the tick it became available, handed from the capture to the processing stage
+/// 采集线程交给处理线程的帧，带采集完成的时刻
+struct Captured { Mat frame; int64 tick; };
+static void swap( Captured& a, Captured& b )
+{
+    cv::swap( a.frame, b.frame );
+    std::swap( a.tick, b.tick );
+}
+
+/// A frame and its detection result, handed from the processing to the display stage
+/// 处理线程交给显示线程的结果
+struct Result { Mat frame, frame_threshold; samples::PackedMask packed; Rect roi; int64 tick; };
+static void swap( Result& a, Result& b )
+{
+    cv::swap( a.frame, b.frame );
+    cv::swap( a.frame_threshold, b.frame_threshold );
+    std::swap( a.packed, b.packed );
+    std::swap( a.roi, b.roi );
+    std::swap( a.tick, b.tick );
+}
+
+/// Latency stages; each is recorded by a single thread
+/// 延迟统计的各个阶段
+enum Stage { CAPTURE, THRESHOLD, DISPLAY, END_TO_END };
+
+/** @function publish_range */
+//滑动条变化后发布新的阈值快照
+static void publish_range()
+{
+    RangeSnapshot s = { { (uchar)low_b, (uchar)low_g, (uchar)low_r, 0 },
+                        { (uchar)high_b, (uchar)high_g, (uchar)high_r, 0 } };
+    range_snapshot.store( s );
+}
+
 /** @function main */
 //主函数
-int main()
+int main( int argc, char** argv )
 {
-    //! [mat]
-    //图像变量声明
-    Mat frame, frame_threshold;
-    //! [mat]
+    CommandLineParser parser( argc, argv,
+        "{source   | 0     | camera:N or N, a video file, an image pattern (%04d or *), synthetic:WxH}"
+        "{realtime | true  | pace file and synthetic sources at their frame rate, false reads as fast as possible}"
+        "{fps      | 0     | frame rate override for pacing, 0 uses the source's own}"
+        "{frames   | 0     | stop after this many frames, 0 for no limit}"
+        "{loop     | false | rewind video files and image sequences at their end}"
+        "{policy   | drop  | what to do when a stage falls behind: drop (oldest frame) or block}"
+        "{slots    | 3     | frames preallocated in each ring}"
+        "{track    | false | threshold only an expanded box around the last detection}"
+        "{packed   | false | write the mask 1 bit per pixel and unpack it only for display, not with track}"
+        "{rescan   | 30    | with track, scan the full frame at least every this many frames}"
+        "{margin   | 0.5   | with track, the box grows by this fraction of its size on each side}"
+        "{report   | 5     | print latency percentiles every this many seconds, 0 only at exit}"
+        "{latency  |       | write the latency histograms to this CSV file at exit}"
+        "{output   |       | write the masks into null, an image pattern with %, shm:name or a video file instead of showing them}" );
+    const samples::RingPolicy policy = parser.get<String>( "policy" ) == "block"
+        ? samples::RING_BLOCK : samples::RING_DROP_OLDEST;
+    const size_t slots = (size_t)std::max( parser.get<int>( "slots" ), 1 );
+    const bool track = parser.get<bool>( "track" );
+    const bool packed = parser.get<bool>( "packed" );
+    if( packed && track )
+    {
+        cout << "--packed cannot be combined with --track" << endl;
+        return -1;
+    }
+    samples::RoiTracker tracker( parser.get<int>( "rescan" ), parser.get<double>( "margin" ) );
+    samples::LatencyRecorder latency( { "capture", "threshold", "display", "end-to-end" } );
+    const double report_seconds = parser.get<double>( "report" );
+    const bool headless = parser.has( "output" );
+
+    //统计 Mat 的分配，每个线程记到自己的阶段，退出时打印
+    samples::AllocationTracker::install();
+
     //! [cap]
-    //打开摄像头， 0默认电脑设备的摄像头
-    VideoCapture cap(0);
+    //打开帧来源， 0默认电脑设备的摄像头
+    Ptr<samples::FrameSource> source = samples::FrameSource::create( parser.get<String>( "source" ), parser.get<bool>( "loop" ) );
+    source->setRealtime( parser.get<bool>( "realtime" ) );
+    source->setFps( parser.get<double>( "fps" ) );
+    source->setMaxFrames( parser.get<int>( "frames" ) );
     //! [cap]
-    //! [window]
-    //创建窗口
-    namedWindow("Video Capture", WINDOW_NORMAL);
-    namedWindow("Object Detection", WINDOW_NORMAL);
-    //! [window]
-    //! [trackbar]
-    //-- Trackbars to set thresholds for RGB values
-    //创建滑动条，六个滑动条，控制三个B、G、R通道的两个阈值
-    createTrackbar("Low R","Object Detection", &low_r, 255, on_low_r_thresh_trackbar);
-    createTrackbar("High R","Object Detection", &high_r, 255, on_high_r_thresh_trackbar);
-    createTrackbar("Low G","Object Detection", &low_g, 255, on_low_g_thresh_trackbar);
-    createTrackbar("High G","Object Detection", &high_g, 255, on_high_g_thresh_trackbar);
-    createTrackbar("Low B","Object Detection", &low_b, 255, on_low_b_thresh_trackbar);
-    createTrackbar("High B","Object Detection", &high_b, 255, on_high_b_thresh_trackbar);
-    //! [trackbar]
-    while((char)waitKey(1)!='q'){ //按下q退出
-        //! [while]
-        cap>>frame; //从cap对象获取一帧图像
-        if(frame.empty())
-            break;
-        //-- Detect the object based on RGB Range Values
-        // 基于RGB颜色空间的目标检测
-        inRange(frame,Scalar(low_b,low_g,low_r), Scalar(high_b,high_g,high_r),frame_threshold);
-        /*
-        //检查数组元素是否位于两个其他数组的元素之间
-        void cv::inRange	(	InputArray 	src,//输入原图
-            InputArray 	lowerb,//阈值上限
-            InputArray 	upperb,//阈值上限
-            OutputArray 	dst //输出图像， CV_8U类型的二值图
-            )		
-        */
-        //! [while]
-        //! [show]
-        //-- Show the frames
-        imshow("Video Capture",frame);  //显示原图
-        imshow("Object Detection",frame_threshold);//显示检测结果
-        //! [show]
+    //无窗口模式：检测结果写到输出，阈值保持初始值
+    Ptr<samples::FrameSink> sink;
+    if( headless )
+        sink = samples::FrameSink::create( parser.get<String>( "output" ) );
+    else
+    {
+        //! [window]
+        //创建窗口
+        namedWindow("Video Capture", WINDOW_NORMAL);
+        namedWindow("Object Detection", WINDOW_NORMAL);
+        //! [window]
+        //! [trackbar]
+        //-- Trackbars to set thresholds for RGB values
+        //创建滑动条，六个滑动条，控制三个B、G、R通道的两个阈值
+        createTrackbar("Low R","Object Detection", &low_r, 255, on_low_r_thresh_trackbar);
+        createTrackbar("High R","Object Detection", &high_r, 255, on_high_r_thresh_trackbar);
+        createTrackbar("Low G","Object Detection", &low_g, 255, on_low_g_thresh_trackbar);
+        createTrackbar("High G","Object Detection", &high_g, 255, on_high_g_thresh_trackbar);
+        createTrackbar("Low B","Object Detection", &low_b, 255, on_low_b_thresh_trackbar);
+        createTrackbar("High B","Object Detection", &high_b, 255, on_high_b_thresh_trackbar);
+        //! [trackbar]
     }
+    publish_range();
+
+    //! [rings]
+    //采集->处理、处理->显示两个环形缓冲
+    samples::SpscRing<Captured> captured( slots, policy );
+    samples::SpscRing<Result> processed( slots, policy );
+    //! [rings]
+
+    //! [capture]
+    //采集线程：直接读入环形缓冲中预先分配的帧
+    std::thread capture_thread( [&]
+    {
+        samples::AllocationStage stage( "capture" );
+        for( ;; )
+        {
+            Captured* slot = captured.beginWrite();
+            if( !slot )
+                break;
+            bool got;
+            {
+                SAMPLES_TRACE_SCOPE( "capture" );
+                got = source->read( slot->frame ); //从帧来源获取一帧图像
+            }
+            if( !got )
+                break;
+            slot->tick = getTickCount();
+            latency.record( CAPTURE, (unsigned long long)(source->stats().lastLatencyMs*1e6) ); //不含实时播放的等待
+            captured.commitWrite();
+        }
+        captured.close();
+    } );
+    //! [capture]
+
+    //! [while]
+    //处理线程
+    std::thread process_thread( [&]
+    {
+        samples::AllocationStage stage( "inRange" );
+        Captured in;
+        RangeSnapshot last = range_snapshot.load();
+        while( captured.waitRead( in ) )
+        {
+            Result* out = processed.beginWrite();
+            if( !out )
+                break;
+            const Mat& frame = in.frame;
+            int64 t0 = getTickCount();
+            //-- Detect the object based on RGB Range Values
+            // 基于RGB颜色空间的目标检测，阈值取自快照
+            RangeSnapshot s = range_snapshot.load();
+            Scalar lowerb( s.low[0], s.low[1], s.low[2] ), upperb( s.high[0], s.high[1], s.high[2] );
+            if( !track )
+            {
+                SAMPLES_TRACE_SCOPE( "inRange" );
+                if( packed )
+                    samples::inRangePacked( frame, lowerb, upperb, out->packed ); //环形缓冲只传递 1/8 大小的掩码
+                else
+                    inRange( frame, lowerb, upperb, out->frame_threshold );
+                out->roi = Rect( Point(), frame.size() );
+            }
+            else
+            {
+                //! [track]
+                SAMPLES_TRACE_SCOPE( "inRange roi" );
+                if( std::memcmp( &s, &last, sizeof(s) ) != 0 )
+                    tracker.reset(); //阈值变了，旧的跟踪结果不再可信
+                last = s;
+
+                //槽位的结果只在它记录的 roi 内可能非零，复用时只清掉旧 roi 中这次不处理的部分
+                const Rect previous = out->roi;
+                const bool reused = out->frame_threshold.size() == frame.size() && out->frame_threshold.type() == CV_8UC1;
+                out->frame_threshold.create( frame.size(), CV_8UC1 );
+                out->roi = tracker.begin( frame.size() );
+                double cleared = 0;
+                if( reused )
+                    cleared = samples::clearOutside( out->frame_threshold, previous, out->roi );
+                else if( out->roi.size() != frame.size() )
+                {
+                    out->frame_threshold.setTo( 0 ); //新分配的结果，ROI 以外没有检测
+                    cleared = frame.size().area();
+                }
+                Mat roi_threshold = out->frame_threshold( out->roi );
+                inRange( frame( out->roi ), lowerb, upperb, roi_threshold ); //直接写进整帧结果的 ROI 部分
+                tracker.end( roi_threshold, 1000.0*(getTickCount() - t0)/getTickFrequency(), cleared );
+                //! [track]
+            }
+            /*
+            //检查数组元素是否位于两个其他数组的元素之间
+            void cv::inRange	(	InputArray 	src,//输入原图
+                InputArray 	lowerb,//阈值上限
+                InputArray 	upperb,//阈值上限
+                OutputArray 	dst //输出图像， CV_8U类型的二值图
+                )		
+            */
+            latency.recordTicks( THRESHOLD, getTickCount() - t0 );
+            cv::swap( out->frame, in.frame ); //原图随结果一起交给显示线程，旧缓冲换回来复用
+            out->tick = in.tick;
+            processed.commitWrite();
+        }
+        processed.close();
+    } );
+    //! [while]
+
+    //! [show]
+    //-- Show the frames
+    //主线程负责显示（HighGUI 只能在主线程调用），无窗口模式下写到输出
+    samples::AllocationStage stage( "display" );
+    Result result;
+    long long shown = 0;
+    int64 start = getTickCount(), last_report = start;
+    while( headless || (char)waitKey(1) != 'q' ) //按下q退出
+    {
+        if( report_seconds > 0 && getTickCount() - last_report > report_seconds*getTickFrequency() )
+        {
+            cout << "Latency over the last " << report_seconds << " s:" << endl;
+            latency.report( cout ); //只统计这段时间内的帧
+            last_report = getTickCount();
+        }
+        //无窗口模式没有 waitKey 的等待，阻塞到下一个结果
+        if( !(headless ? processed.waitRead( result ) : processed.read( result )) )
+        {
+            if( headless || (processed.closed() && !processed.read( result )) )
+                break; //视频结束
+            continue;
+        }
+        if( track )
+            rectangle( result.frame, result.roi, Scalar( 0, 255, 255 ), 2 ); //标出本帧处理的区域
+        {
+            samples::LatencyRecorder::Scope scope( latency, DISPLAY );
+            SAMPLES_TRACE_SCOPE( "display" );
+            if( packed )
+                result.packed.toMat( result.frame_threshold ); //显示前才展开成 CV_8U
+            if( headless )
+                sink->write( result.frame_threshold );
+            else
+            {
+                imshow("Video Capture",result.frame);  //显示原图
+                imshow("Object Detection",result.frame_threshold);//显示检测结果
+            }
+        }
+        latency.recordTicks( END_TO_END, getTickCount() - result.tick ); //从采集完成到显示
+        shown++;
+    }
+    double seconds = ((double)getTickCount() - start)/getTickFrequency();
+    //! [show]
+
+    //结束两个线程
+    captured.close();
+    processed.close();
+    capture_thread.join();
+    process_thread.join();
+    source->stats().print( cout );
+    if( headless )
+        sink->stats().print( cout, "output", "write" );
+    cout << "Displayed " << shown << " frames, " << shown/seconds << " frames/s; dropped "
+         << captured.dropped() << " before processing, " << processed.dropped() << " before display" << endl;
+    if( track )
+        tracker.stats().print( cout );
+    cout << "Latency over the whole run:" << endl;
+    latency.print( cout, latency.snapshot() );
+    String latency_file = parser.get<String>( "latency" );
+    if( !latency_file.empty() && !latency.exportTo( latency_file ) )
+        cout << "Could not write " << latency_file << endl;
     return 0;
 }
 
@@ -85,6 +330,7 @@ void on_low_r_thresh_trackbar(int, void *)
 {
     low_r = min(high_r-1, low_r); //区分确定low、high
     setTrackbarPos("Low R","Object Detection", low_r);
+    publish_range();
 }
 //! [low]
 //! [high]
@@ -93,6 +339,7 @@ void on_high_r_thresh_trackbar(int, void *)
 {
     high_r = max(high_r, low_r+1);
     setTrackbarPos("High R", "Object Detection", high_r);
+    publish_range();
 }
 //![high]
 /** @function on_low_g_thresh_trackbar */
@@ -100,6 +347,7 @@ void on_low_g_thresh_trackbar(int, void *)
 {
     low_g = min(high_g-1, low_g);
     setTrackbarPos("Low G","Object Detection", low_g);
+    publish_range();
 }
 
 /** @function on_high_g_thresh_trackbar */
@@ -107,6 +355,7 @@ void on_high_g_thresh_trackbar(int, void *)
 {
     high_g = max(high_g, low_g+1);
     setTrackbarPos("High G", "Object Detection", high_g);
+    publish_range();
 }
 
 /** @function on_low_b_thresh_trackbar */
@@ -114,6 +363,7 @@ void on_low_b_thresh_trackbar(int, void *)
 {
     low_b= min(high_b-1, low_b);
     setTrackbarPos("Low B","Object Detection", low_b);
+    publish_range();
 }
 
 /** @function on_high_b_thresh_trackbar */
@@ -121,6 +371,7 @@ void on_high_b_thresh_trackbar(int, void *)
 {
     high_b = max(high_b, low_b+1);
     setTrackbarPos("High B", "Object Detection", high_b);
+    publish_range();
 }
 
 
@@ -135,4 +386,16 @@ void on_high_b_thresh_trackbar(int, void *)
   * 
   * 彩色阈值操作
   * inRange函数：作用检查数组元素是否位于两个其他数组的元素之间， 对应输出二值图里面的白色区域
+  *
+  * 采集、处理、显示流水线
+  * 各阶段由单生产者/单消费者无锁环形缓冲连接，帧预先分配并用 swap 传递
+  * 缓冲满时丢弃最旧的帧(drop)保证低延迟，或等待(block)保证不丢帧
+  * GUI 线程修改的参数通过 std::atomic 快照发布给工作线程
+  *
+  * 延迟统计
+  * 每个线程写自己的直方图，记录不加锁；对数-线性分桶，用分位数而不是平均值衡量尾延迟
+  *
+  * ROI 跟踪
+  * 只在上一次检测的外接矩形扩大后的区域内检测，定期或丢失时全帧扫描
+  * inRange 可以直接写进输出图像的 ROI，不需要额外复制
 */
\ No newline at end of file
@@ -0,0 +1,143 @@
+/**
+ * @file TiledFiltering.cpp
+ * @brief Cache-blocked tiled execution of the Smoothing/Morphology filters, compared with full-frame calls
+ * @author OpenCV team
+ */
+
+/**
+ * 分块滤波
+ * 把图像放大到 8K，对 Smoothing.cpp 和 Morphology_1.cpp 中用到的滤波分别整帧执行和分块执行，
+ * 比较耗时，并检查两者结果是否逐位一致。
+ */
+
+/**
+ * 程序流程
+ * 1、加载图像并放大到 7680x4320
+ * 2、对每种滤波整帧执行、分块执行，取平均耗时
+ * 3、norm(NORM_INF) 检查结果是否一致
+ * 4、显示分块结果
+ */
+
+//头文件
+#include <iostream>
+#include <string>
+#include <vector>
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/highgui.hpp"
+
+#include "../common/tiled_filter.hpp"
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp" //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
+//命名空间
+using namespace std;
+using namespace cv;
+using samples::TiledFilter;
+
+/**
+ * @function main
+ */
+int main( int argc, char** argv )
+{
+    CommandLineParser parser( argc, argv,
+        "{@input | ../data/lena.jpg | input image}"
+        "{width  | 7680 | width the image is resized to}"
+        "{height | 4320 | height the image is resized to}"
+        "{tile   | 0    | tile side in pixels, 0 derives it from the L2 budget}"
+        "{l2     | 256  | per-core L2 budget in KB}"
+        "{runs   | 5    | runs averaged per measurement}" );
+
+    //统计 Mat 的分配，按阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+    samples::AllocationStage stage( "setup" );
+
+    /// Load the source image and bring it to 8K
+    /// 加载图像并放大到 8K
+    Mat img = samples::imreadCached( parser.get<String>( "@input" ), IMREAD_COLOR );
+    if( img.empty() )
+    {
+        cout << "Could not open or find the image!\n" << endl;
+        cout << "Usage: " << argv[0] << " <Input image>" << endl;
+        return -1;
+    }
+    Mat src;
+    resize( img, src, Size( parser.get<int>( "width" ), parser.get<int>( "height" ) ), 0, 0, INTER_LINEAR );
+
+    const int runs = std::max( parser.get<int>( "runs" ), 1 );
+    const int tile = parser.get<int>( "tile" );
+
+    /// The filters of Smoothing.cpp and Morphology_1.cpp (largest kernel sizes of their loops/trackbars)
+    /// Smoothing.cpp 和 Morphology_1.cpp 中的滤波
+    struct Case { string name; TiledFilter tiled; };
+    Mat rect21 = getStructuringElement( MORPH_RECT, Size( 2*10 + 1, 2*10 + 1 ), Point( 10, 10 ) );
+    Mat ellipse43 = getStructuringElement( MORPH_ELLIPSE, Size( 2*21 + 1, 2*21 + 1 ), Point( 21, 21 ) );
+    vector<Case> cases;
+    cases.push_back( Case{ "blur 29x29",         TiledFilter::blur( Size(29, 29) ) } );
+    cases.push_back( Case{ "GaussianBlur 29x29", TiledFilter::gaussianBlur( Size(29, 29), 0, 0 ) } );
+    cases.push_back( Case{ "medianBlur 5",       TiledFilter::medianBlur( 5 ) } );
+    cases.push_back( Case{ "medianBlur 29",      TiledFilter::medianBlur( 29 ) } );
+    cases.push_back( Case{ "bilateralFilter 9",  TiledFilter::bilateralFilter( 9, 18, 4 ) } );
+    cases.push_back( Case{ "erode rect 21",      TiledFilter::erode( rect21 ) } );
+    cases.push_back( Case{ "dilate ellipse 43",  TiledFilter::dilate( ellipse43 ) } );
+
+    cout << "Image " << src.cols << "x" << src.rows << ", " << getNumThreads() << " threads" << endl;
+
+    Mat full, tiled;
+    for( size_t c = 0; c < cases.size(); c++ )
+    {
+        TiledFilter& f = cases[c].tiled;
+        f.setCacheBytes( (size_t)parser.get<int>( "l2" )*1024 );
+        if( tile > 0 )
+            f.setTileSize( Size( tile, tile ) );
+
+        stage.enter( "full frame" );
+        //![full_frame]
+        /// Full-frame: the same call on the whole image
+        /// 整帧执行，tiles 为空时 TiledFilter 直接整帧调用滤波函数
+        TiledFilter fullFrame = f;
+        fullFrame.setTileSize( src.size() );
+        double t = (double)getTickCount();
+        for( int i = 0; i < runs; i++ )
+        {
+            SAMPLES_TRACE_SCOPE( "full frame" );
+            fullFrame.apply( src, full );
+        }
+        double tFull = 1000*((double)getTickCount() - t)/getTickFrequency()/runs;
+        //![full_frame]
+
+        stage.enter( "tiled" );
+        //![tiled]
+        t = (double)getTickCount();
+        for( int i = 0; i < runs; i++ )
+        {
+            SAMPLES_TRACE_SCOPE( "tiled" );
+            f.apply( src, tiled );
+        }
+        double tTiled = 1000*((double)getTickCount() - t)/getTickFrequency()/runs;
+        //![tiled]
+
+        double diff = norm( full, tiled, NORM_INF );
+        cout << cases[c].name << ": full " << tFull << " ms, tiled " << tTiled << " ms ("
+             << f.tiles( src.size(), src.type() ).size() << " tiles), "
+             << (diff == 0 ? "bit-identical" : "max diff " + to_string( diff )) << endl;
+    }
+
+    /// Show the last tiled result, scaled down
+    stage.enter( "display" );
+    Mat show;
+    resize( tiled, show, Size(), 0.125, 0.125, INTER_AREA );
+    imshow( "Tiled Filtering", show );
+    waitKey(0);
+    return 0;
+}
+
+/**
+ * 要点总结
+ * 对 ROI 调用滤波函数时，默认会读取父图像中 ROI 外的像素，结果与整帧一致
+ * 带 BORDER_ISOLATED 的函数（如 medianBlur）需要把 halo 一起取出来，再裁剪中心部分
+ * 块的大小按 L2 缓存估算，块在 parallel_for_ 的线程池上并行执行
+ * BORDER_WRAP 需要图像另一侧的像素，不能分块
+ */
@@ -0,0 +1,259 @@
+/**
+ * @file allocation_tracker.hpp
+ * @brief MatAllocator wrapper counting Mat allocations, bytes and peak live bytes per pipeline stage
+ * @author OpenCV team
+ */
+
+/**
+ * Mat 分配统计
+ * 示例只打印耗时，看不出内存：DFT 示例要分配好几块整幅的 float 缓冲，扫描基准测试每次运行都 clone 一次。
+ * AllocationTracker 包装默认的 MatAllocator，安装后所有 Mat::create 的分配都经过它：
+ *  - 统计分配次数、分配的总字节数、当前存活的字节数和存活字节数的峰值
+ *  - 按阶段分别统计：AllocationStage 是作用域守卫，构造时把当前线程的阶段设为给定名字，析构时恢复；
+ *    enter() 在同一个守卫里切换到下一个阶段，适合一段顺序执行的 main
+ *  - 释放记到分配时的阶段，存活和峰值是该阶段分配、尚未释放的字节
+ * 阶段是每个线程各自的，其他线程上的分配记到那个线程当前的阶段，没有守卫时记为 (untagged)。
+ * 只统计由分配器自己分配的内存：用户数据构造的 Mat、映射文件（image_cache.hpp）不计入。
+ * 统计要给每次分配加锁、记录所有者，会计入基准测试的耗时，所以是可选的：
+ * install() 只在环境变量 OPENCV_SAMPLES_ALLOC_STATS 设为非 0 时把它设为默认分配器，并在程序退出时打印汇总；
+ * 未安装时分配不经过它，AllocationStage 也什么都不做。
+ * 分配器本身从不析构，全局 Mat 在退出处理之后释放也没有问题。
+ *
+ * 用法：
+ *   samples::AllocationTracker::install();
+ *   samples::AllocationStage stage( "load" );
+ *   ...
+ *   stage.enter( "dft" );
+ */
+
+#ifndef SAMPLES_ALLOCATION_TRACKER_HPP
+#define SAMPLES_ALLOCATION_TRACKER_HPP
+
+#include "opencv2/core.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace samples {
+
+/**
+ * @brief Allocation counters of one stage, or of the whole process
+ */
+struct AllocationStats
+{
+    AllocationStats() : allocations(0), bytes(0), live(0), peak(0) {}
+
+    long long allocations;
+    long long bytes;  ///< total bytes allocated
+    long long live;   ///< bytes allocated and not yet released
+    long long peak;   ///< largest value live has reached
+};
+
+/**
+ * @brief MatAllocator forwarding to the previous default allocator and counting what goes through it
+ *
+ * A single process-wide instance, installed as the default allocator by install().
+ */
+class AllocationTracker : public cv::MatAllocator
+{
+public:
+    /// The process-wide tracker; never destroyed, Mats released after the exit handlers still find it
+    static AllocationTracker& instance()
+    {
+        static AllocationTracker* tracker = new AllocationTracker( cv::Mat::getDefaultAllocator() );
+        return *tracker;
+    }
+
+    /**
+     * @brief Installs the tracker as cv::Mat's default allocator on first call and prints the summary at exit
+     * Only when $OPENCV_SAMPLES_ALLOC_STATS is set and not 0; otherwise Mat allocations stay untouched.
+     */
+    static AllocationTracker& install()
+    {
+        static AllocationTracker& tracker = installOnce();
+        return tracker;
+    }
+
+    /// True once install() has put the tracker in place
+    static bool installed() { return installedFlag().load( std::memory_order_relaxed ); }
+
+    cv::UMatData* allocate( int dims, const int* sizes, int type, void* data, size_t* step,
+                            cv::AccessFlag flags, cv::UMatUsageFlags usage ) const CV_OVERRIDE
+    {
+        cv::UMatData* u = base_->allocate( dims, sizes, type, data, step, flags, usage );
+        if( !u || data )
+            return u;  // user data: nothing was allocated, the base allocator keeps it
+
+        // Route the release back through the tracker
+        u->currAllocator = this;
+        std::lock_guard<std::mutex> lock( mutex_ );
+        const int stage = currentStage();
+        owners_[u] = stage;
+        add( total_, (long long)u->size );
+        add( stages_[stage], (long long)u->size );
+        return u;
+    }
+
+    bool allocate( cv::UMatData* u, cv::AccessFlag flags, cv::UMatUsageFlags usage ) const CV_OVERRIDE
+    {
+        return base_->allocate( u, flags, usage );
+    }
+
+    void deallocate( cv::UMatData* u ) const CV_OVERRIDE
+    {
+        if( !u )
+            return;
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            std::unordered_map<const cv::UMatData*, int>::iterator it = owners_.find( u );
+            if( it != owners_.end() )
+            {
+                total_.live -= (long long)u->size;
+                stages_[it->second].live -= (long long)u->size;
+                owners_.erase( it );
+            }
+        }
+        u->currAllocator = base_;
+        base_->deallocate( u );
+    }
+
+    /// Counters of every allocation
+    AllocationStats total() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return total_;
+    }
+
+    /// Stage names and their counters, in order of first use; index 0 is (untagged)
+    std::vector<std::pair<std::string, AllocationStats> > stages() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        std::vector<std::pair<std::string, AllocationStats> > s;
+        for( size_t i = 0; i < names_.size(); i++ )
+            s.push_back( std::make_pair( names_[i], stages_[i] ) );
+        return s;
+    }
+
+    /// Totals, then one line per stage that allocated anything
+    void print( std::ostream& out ) const
+    {
+        const double MB = 1.0/(1 << 20);
+        const AllocationStats t = total();
+        out << std::fixed << std::setprecision( 1 )
+            << "Mat allocations: " << t.allocations << " (" << t.bytes*MB << " MB), peak live "
+            << t.peak*MB << " MB, live at exit " << t.live*MB << " MB" << std::endl;
+        const std::vector<std::pair<std::string, AllocationStats> > s = stages();
+        for( size_t i = 0; i < s.size(); i++ )
+            if( s[i].second.allocations )
+                out << "  " << std::setw( 20 ) << std::left << s[i].first << std::right
+                    << " n=" << std::setw( 7 ) << s[i].second.allocations << "  total " << std::setw( 9 ) << s[i].second.bytes*MB
+                    << " MB  peak live " << std::setw( 8 ) << s[i].second.peak*MB << " MB" << std::endl;
+        out.unsetf( std::ios::floatfield );
+        out << std::setprecision( 6 );
+    }
+
+private:
+    friend class AllocationStage;
+
+    explicit AllocationTracker( const cv::MatAllocator* base ) : base_(base), names_( 1, "(untagged)" ), stages_( 1 ) {}
+
+    static AllocationTracker& installOnce()
+    {
+        AllocationTracker& tracker = instance();
+        const char* env = std::getenv( "OPENCV_SAMPLES_ALLOC_STATS" );
+        if( !env || !*env || std::string( env ) == "0" )
+            return tracker;
+        installedFlag().store( true );
+        cv::Mat::setDefaultAllocator( &tracker );
+        std::atexit( printAtExit );
+        return tracker;
+    }
+
+    static void printAtExit()
+    {
+        instance().print( std::cout );
+    }
+
+    static void add( AllocationStats& s, long long bytes )
+    {
+        s.allocations++;
+        s.bytes += bytes;
+        s.live += bytes;
+        s.peak = std::max( s.peak, s.live );
+    }
+
+    static std::atomic<bool>& installedFlag()
+    {
+        static std::atomic<bool> flag( false );
+        return flag;
+    }
+
+    /// Stage of the calling thread, 0 outside any AllocationStage
+    static int& currentStage()
+    {
+        static thread_local int stage = 0;
+        return stage;
+    }
+
+    int stageId( const char* name )
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        std::map<std::string, int>::const_iterator it = ids_.find( name );
+        if( it != ids_.end() )
+            return it->second;
+        const int id = (int)names_.size();
+        ids_[name] = id;
+        names_.push_back( name );
+        stages_.push_back( AllocationStats() );
+        return id;
+    }
+
+    const cv::MatAllocator* base_;
+    mutable std::mutex mutex_;
+    mutable std::unordered_map<const cv::UMatData*, int> owners_;  ///< stage of every live allocation
+    std::map<std::string, int> ids_;
+    std::vector<std::string> names_;
+    mutable std::vector<AllocationStats> stages_;
+    mutable AllocationStats total_;
+};
+
+/**
+ * @brief Tags the Mat allocations of the calling thread with a stage name for the lifetime of the guard
+ * Guards nest: the destructor restores the stage that was current at construction.
+ */
+class AllocationStage
+{
+public:
+    explicit AllocationStage( const char* name ) : previous_( AllocationTracker::currentStage() )
+    {
+        enter( name );
+    }
+
+    ~AllocationStage() { AllocationTracker::currentStage() = previous_; }
+
+    /// Switches to the next stage of a sequence; does nothing while the tracker is not installed
+    void enter( const char* name )
+    {
+        if( AllocationTracker::installed() )
+            AllocationTracker::currentStage() = AllocationTracker::instance().stageId( name );
+    }
+
+private:
+    AllocationStage( const AllocationStage& );
+    AllocationStage& operator=( const AllocationStage& );
+
+    int previous_;
+};
+
+} // namespace samples
+
+#endif // SAMPLES_ALLOCATION_TRACKER_HPP
@@ -0,0 +1,199 @@
+/**
+ * @file color_classifier.hpp
+ * @brief Single-pass multi-class color segmentation into a CV_8U label map
+ * @author OpenCV team
+ */
+
+/**
+ * 多类颜色分割
+ * inRange(frame, Scalar(low_b,...), Scalar(high_b,...), frame_threshold) 一次只处理一个颜色范围，
+ * 跟踪 N 种颜色就要对整帧扫描 N 次。MultiRangeClassifier 一次扫描完成所有类别：
+ * 每个像素输出第一个包含它的类别编号 1..N，都不包含时输出 0（背景）。
+ * 类别可以定义在 BGR 或 HSV 空间；HSV 时逐行转换到一小块行缓冲里再分类，不写出整幅 HSV 图像。
+ */
+
+#ifndef SAMPLES_COLOR_CLASSIFIER_HPP
+#define SAMPLES_COLOR_CLASSIFIER_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+#include "opencv2/imgproc.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace samples {
+
+/**
+ * @brief Per-pixel RGB2HSV_b of OpenCV (8-bit, H in [0,180)) for a row of BGR pixels
+ * 与 OpenCV 8 位 COLOR_BGR2HSV 相同的定点算法（hsv_shift = 12，除法查表）
+ */
+static void bgr2hsvRow( const uchar* src, uchar* dst, int width )
+{
+    enum { HSV_SHIFT = 12 };
+    struct Tables
+    {
+        int sdiv[256], hdiv[256];
+        Tables()
+        {
+            sdiv[0] = hdiv[0] = 0;
+            for( int i = 1; i < 256; i++ )
+            {
+                sdiv[i] = cv::saturate_cast<int>( (255 << HSV_SHIFT)/(1.*i) );
+                hdiv[i] = cv::saturate_cast<int>( (180 << HSV_SHIFT)/(6.*i) );
+            }
+        }
+    };
+    static const Tables tables;  //局部静态变量的初始化是线程安全的
+    const int* sdiv = tables.sdiv;
+    const int* hdiv = tables.hdiv;
+
+    for( int x = 0; x < width; x++, src += 3, dst += 3 )
+    {
+        int b = src[0], g = src[1], r = src[2];
+        int v = std::max( b, std::max( g, r ) );
+        int vmin = std::min( b, std::min( g, r ) );
+        int diff = v - vmin;
+        int vr = v == r ? -1 : 0;
+        int vg = v == g ? -1 : 0;
+
+        int s = (diff*sdiv[v] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+        int h = (vr & (g - b)) + (~vr & ((vg & (b - r + 2*diff)) + ((~vg) & (r - g + 4*diff))));
+        h = (h*hdiv[diff] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+        h += h < 0 ? 180 : 0;
+
+        dst[0] = cv::saturate_cast<uchar>( h );
+        dst[1] = (uchar)s;
+        dst[2] = (uchar)v;
+    }
+}
+
+/**
+ * @brief Labels every pixel with the first of N color boxes that contains it
+ */
+class MultiRangeClassifier
+{
+public:
+    enum { MAX_CLASSES = 64 };
+    enum ColorSpace { BGR, HSV };
+
+    explicit MultiRangeClassifier( ColorSpace space = BGR ) : space_(space) {}
+
+    /**
+     * @brief Adds a class with inclusive bounds, same meaning as inRange(src, lowerb, upperb)
+     * @return the label of the class, 1 for the first one
+     */
+    int addClass( const cv::Scalar& lowerb, const cv::Scalar& upperb )
+    {
+        CV_Assert( (int)lo_.size()/3 < MAX_CLASSES );
+        for( int c = 0; c < 3; c++ )
+        {
+            //与 inRange 一样用 cvRound 取整
+            int l = std::max( cvRound( lowerb[c] ), 0 ), h = std::min( cvRound( upperb[c] ), 255 );
+            if( l > h ) { l = 255; h = 0; }   //空区间 [255, 0]：永远不匹配
+            lo_.push_back( (uchar)l );
+            hi_.push_back( (uchar)h );
+        }
+        return (int)lo_.size()/3;
+    }
+
+    void clear() { lo_.clear(); hi_.clear(); }
+    int classes() const { return (int)lo_.size()/3; }
+    ColorSpace colorSpace() const { return space_; }
+
+    /**
+     * @brief labels(y,x) = index of the first matching class (1-based), 0 when none matches
+     * @param src CV_8UC3 BGR image; converted row by row when the classes are in HSV
+     */
+    void classify( const cv::Mat& src, cv::Mat& labels ) const
+    {
+        CV_Assert( src.type() == CV_8UC3 );
+        labels.create( src.size(), CV_8UC1 );
+        cv::Mat dst = labels;
+        const int width = src.cols;
+
+        //每个类别的上下界广播成向量，每次调用只建一次，所有线程共享
+        Bounds bounds;
+#if CV_SIMD
+        for( int k = 0; k < classes()*3; k++ )
+        {
+            bounds.lo[k] = cv::vx_setall_u8( lo_[k] );
+            bounds.hi[k] = cv::vx_setall_u8( hi_[k] );
+        }
+#endif
+
+        cv::parallel_for_( cv::Range( 0, src.rows ), [&]( const cv::Range& r )
+        {
+            SAMPLES_TRACE_SCOPE( "ColorClassifier rows" );
+            cv::AutoBuffer<uchar> hsv( space_ == HSV ? width*3 : 1 );
+            for( int y = r.start; y < r.end; y++ )
+            {
+                const uchar* s = src.ptr<uchar>(y);
+                if( space_ == HSV )
+                {
+                    bgr2hsvRow( s, hsv.data(), width );  //行缓冲留在 L1 中
+                    s = hsv.data();
+                }
+                classifyRow( s, dst.ptr<uchar>(y), width, bounds );
+            }
+        } );
+    }
+
+private:
+    /// Class bounds broadcast to vector registers
+    struct Bounds
+    {
+#if CV_SIMD
+        cv::v_uint8 lo[MAX_CLASSES*3], hi[MAX_CLASSES*3];
+#endif
+    };
+
+    void classifyRow( const uchar* src, uchar* dst, int width, const Bounds& bounds ) const
+    {
+        const int n = classes();
+        const uchar* lo = lo_.data();
+        const uchar* hi = hi_.data();
+        int x = 0;
+#if CV_SIMD
+        using namespace cv;
+        const int VECSZ = VTraits<v_uint8>::vlanes();
+        const v_uint8* vlo = bounds.lo;
+        const v_uint8* vhi = bounds.hi;
+        for( ; x <= width - VECSZ; x += VECSZ )
+        {
+            v_uint8 a, b, c;
+            v_load_deinterleave( src + x*3, a, b, c );
+            v_uint8 label = vx_setzero_u8();
+            // 从后往前覆盖，最终留下的是第一个匹配的类别
+            for( int k = n - 1; k >= 0; k-- )
+            {
+                v_uint8 m = v_and( v_and( v_ge( a, vlo[3*k] ), v_le( a, vhi[3*k] ) ),
+                                   v_and( v_and( v_ge( b, vlo[3*k + 1] ), v_le( b, vhi[3*k + 1] ) ),
+                                          v_and( v_ge( c, vlo[3*k + 2] ), v_le( c, vhi[3*k + 2] ) ) ) );
+                label = v_select( m, vx_setall_u8( (uchar)(k + 1) ), label );
+            }
+            v_store( dst + x, label );
+        }
+#endif
+        for( ; x < width; x++ )
+        {
+            const uchar* p = src + x*3;
+            uchar label = 0;
+            for( int k = 0; k < n && !label; k++ )
+                if( p[0] >= lo[3*k] && p[0] <= hi[3*k] && p[1] >= lo[3*k + 1] && p[1] <= hi[3*k + 1] &&
+                    p[2] >= lo[3*k + 2] && p[2] <= hi[3*k + 2] )
+                    label = (uchar)(k + 1);
+            dst[x] = label;
+        }
+        (void)bounds;
+    }
+
+    ColorSpace space_;
+    std::vector<uchar> lo_, hi_;
+};
+
+} // namespace samples
+
+#endif // SAMPLES_COLOR_CLASSIFIER_HPP
@@ -0,0 +1,262 @@
+/**
+ * @file compositor.hpp
+ * @brief Single-pass weighted blending of N 8-bit images, with scalar weights or per-pixel alpha masks
+ * @author OpenCV team
+ */
+
+/**
+ * N 幅图像一次混合
+ * 用 addWeighted 混合 N 幅图像要链式调用 N-1 次，每一步都把完整的中间结果写出去再读回来，
+ * 每一步还各舍入一次。这里每个像素块只遍历一次：
+ *  - 标量权重：dst = saturate(w0*src0 + ... + w(N-1)*src(N-1) + gamma)
+ *    权重量化成 Q15 等 16 位定点数，两幅图的像素交错成 16 位对，一次 v_dotprod 累加两幅图，
+ *    32 位累加器，最后一次舍入、饱和存储
+ *  - 逐像素 alpha：dst = saturate(round((a0*src0 + ... + a(N-1)*src(N-1))/255))，ai 为 CV_8U 掩码，
+ *    a*src 在 16 位内精确，累加到 32 位，最后乘 1/255 舍入。单通道掩码对多通道图像按行展开
+ * 行在 OpenCV 线程池上并行。
+ */
+
+#ifndef SAMPLES_COMPOSITOR_HPP
+#define SAMPLES_COMPOSITOR_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace samples {
+
+namespace compose_detail {
+
+/// Fractional bits so that every weight fits a short and the 32-bit sum cannot overflow, 0 if none does
+static inline int weightShift( const std::vector<double>& weights, double gamma )
+{
+    double wmax = 0, wsum = 0;
+    for( size_t i = 0; i < weights.size(); i++ )
+    {
+        wmax = std::max( wmax, std::fabs( weights[i] ) );
+        wsum += std::fabs( weights[i] );
+    }
+    for( int s = 15; s >= 12; s-- )
+        if( cvRound( wmax*(1 << s) ) <= 32767 && (255*wsum + std::fabs( gamma ) + 1)*(1 << s) < 2147483647.0 )
+            return s;
+    return 0;
+}
+
+/**
+ * @brief One row: sources taken two at a time as interleaved (a, b) pairs, one v_dotprod per pair
+ * @param w quantized weights, an even count (a zero weight pads an odd N)
+ */
+template<int S>
+static void weightedRow( const uchar* const* src, const short* w, int pairs, int bias, uchar* d, int n,
+                         const uchar* zeros )
+{
+    int i = 0;
+#if CV_SIMD
+    const int VECSZ = cv::VTraits<cv::v_uint8>::vlanes();
+    const cv::v_int32 b = cv::vx_setall_s32( bias );
+    for( ; i <= n - VECSZ; i += VECSZ )
+    {
+        cv::v_int32 acc0 = b, acc1 = b, acc2 = b, acc3 = b;
+        for( int p = 0; p < pairs; p++ )
+        {
+            const uchar* s1 = src[2*p + 1] ? src[2*p + 1] + i : zeros;
+            cv::v_int16 wp, unused;
+            cv::v_zip( cv::vx_setall_s16( w[2*p] ), cv::vx_setall_s16( w[2*p + 1] ), wp, unused );
+            cv::v_uint16 a0, a1, b0, b1;
+            cv::v_expand( cv::vx_load( src[2*p] + i ), a0, a1 );
+            cv::v_expand( cv::vx_load( s1 ), b0, b1 );
+            cv::v_int16 q0, q1, q2, q3;
+            cv::v_zip( cv::v_reinterpret_as_s16( a0 ), cv::v_reinterpret_as_s16( b0 ), q0, q1 );
+            cv::v_zip( cv::v_reinterpret_as_s16( a1 ), cv::v_reinterpret_as_s16( b1 ), q2, q3 );
+            acc0 = cv::v_dotprod( q0, wp, acc0 );
+            acc1 = cv::v_dotprod( q1, wp, acc1 );
+            acc2 = cv::v_dotprod( q2, wp, acc2 );
+            acc3 = cv::v_dotprod( q3, wp, acc3 );
+        }
+        cv::v_int16 lo = cv::v_pack( cv::v_shr<S>( acc0 ), cv::v_shr<S>( acc1 ) );
+        cv::v_int16 hi = cv::v_pack( cv::v_shr<S>( acc2 ), cv::v_shr<S>( acc3 ) );
+        cv::v_store( d + i, cv::v_pack_u( lo, hi ) );
+    }
+#endif
+    for( ; i < n; i++ )
+    {
+        int acc = bias;
+        for( int p = 0; p < pairs; p++ )
+            acc += src[2*p][i]*w[2*p] + (src[2*p + 1] ? src[2*p + 1][i]*w[2*p + 1] : 0);
+        d[i] = cv::saturate_cast<uchar>( acc >> S );
+    }
+}
+
+/// One row of the alpha-mask blend; alpha rows already have as many values as the source rows
+static inline void maskedRow( const uchar* const* src, const uchar* const* alpha, int count, uchar* d, int n )
+{
+    int i = 0;
+#if CV_SIMD
+    const int VECSZ = cv::VTraits<cv::v_uint8>::vlanes();
+    const cv::v_float32 scale = cv::vx_setall_f32( 1.f/255 );
+    for( ; i <= n - VECSZ; i += VECSZ )
+    {
+        cv::v_uint32 acc0 = cv::vx_setzero_u32(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for( int k = 0; k < count; k++ )
+        {
+            cv::v_uint16 s0, s1, a0, a1;
+            cv::v_expand( cv::vx_load( src[k] + i ), s0, s1 );
+            cv::v_expand( cv::vx_load( alpha[k] + i ), a0, a1 );
+            // 255*255 仍在 16 位内，乘积精确
+            cv::v_uint32 p0, p1, p2, p3;
+            cv::v_expand( cv::v_mul_wrap( s0, a0 ), p0, p1 );
+            cv::v_expand( cv::v_mul_wrap( s1, a1 ), p2, p3 );
+            acc0 = cv::v_add( acc0, p0 );
+            acc1 = cv::v_add( acc1, p1 );
+            acc2 = cv::v_add( acc2, p2 );
+            acc3 = cv::v_add( acc3, p3 );
+        }
+        cv::v_int32 r0 = cv::v_round( cv::v_mul( cv::v_cvt_f32( cv::v_reinterpret_as_s32( acc0 ) ), scale ) );
+        cv::v_int32 r1 = cv::v_round( cv::v_mul( cv::v_cvt_f32( cv::v_reinterpret_as_s32( acc1 ) ), scale ) );
+        cv::v_int32 r2 = cv::v_round( cv::v_mul( cv::v_cvt_f32( cv::v_reinterpret_as_s32( acc2 ) ), scale ) );
+        cv::v_int32 r3 = cv::v_round( cv::v_mul( cv::v_cvt_f32( cv::v_reinterpret_as_s32( acc3 ) ), scale ) );
+        cv::v_store( d + i, cv::v_pack_u( cv::v_pack( r0, r1 ), cv::v_pack( r2, r3 ) ) );
+    }
+#endif
+    for( ; i < n; i++ )
+    {
+        unsigned acc = 0;
+        for( int k = 0; k < count; k++ )
+            acc += src[k][i]*alpha[k][i];
+        d[i] = cv::saturate_cast<uchar>( cvRound( (float)acc*(1.f/255) ) );
+    }
+}
+
+/// All sources CV_8U with the size and type of the first
+static inline void checkSources( const std::vector<cv::Mat>& srcs )
+{
+    CV_Assert( !srcs.empty() );
+    for( size_t i = 0; i < srcs.size(); i++ )
+        CV_Assert( srcs[i].size() == srcs[0].size() && srcs[i].type() == srcs[0].type() );
+}
+
+} // namespace compose_detail
+
+/**
+ * @brief dst = saturate(sum of weights[i]*srcs[i] + gamma), one pass over all sources
+ * Same result as a single float accumulation, up to the Q15 quantization of the weights.
+ * Non-8U sources and weights too large for 16-bit fixed point are accumulated in CV_32F instead.
+ */
+static inline void compose( const std::vector<cv::Mat>& srcs, const std::vector<double>& weights, cv::Mat& dst,
+                            double gamma = 0 )
+{
+    compose_detail::checkSources( srcs );
+    CV_Assert( weights.size() == srcs.size() );
+    const int shift = compose_detail::weightShift( weights, gamma );
+    if( srcs[0].depth() != CV_8U || !shift )
+    {
+        cv::Mat acc( srcs[0].size(), CV_MAKETYPE( CV_32F, srcs[0].channels() ), cv::Scalar::all( gamma ) ), f;
+        for( size_t i = 0; i < srcs.size(); i++ )
+        {
+            srcs[i].convertTo( f, CV_32F );
+            cv::scaleAdd( f, weights[i], acc, acc );
+        }
+        acc.convertTo( dst, srcs[0].depth() );
+        return;
+    }
+
+    // 权重补成偶数个，奇数时最后一幅图与全零行配对
+    const int count = (int)srcs.size(), pairs = (count + 1)/2;
+    std::vector<short> w( 2*pairs, 0 );
+    for( int i = 0; i < count; i++ )
+        w[i] = (short)cvRound( weights[i]*(1 << shift) );
+    const int bias = cvRound( gamma*(1 << shift) ) + (1 << (shift - 1));
+
+    const cv::Size size = srcs[0].size();
+    const int len = size.width*srcs[0].channels();
+    std::vector<cv::Mat> in( srcs );  //dst 可能与某个输入相同，先复制一份
+    for( int i = 0; i < count; i++ )
+        if( in[i].data == dst.data )
+            in[i] = in[i].clone();
+    dst.create( size, srcs[0].type() );
+    cv::Mat out = dst;
+
+    cv::parallel_for_( cv::Range( 0, size.height ), [&]( const cv::Range& r )
+    {
+        SAMPLES_TRACE_SCOPE( "compose rows" );
+        std::vector<const uchar*> rows( 2*pairs, (const uchar*)0 );
+        std::vector<uchar> zeros( cv::VTraits<cv::v_uint8>::max_nlanes, 0 );
+        for( int y = r.start; y < r.end; y++ )
+        {
+            for( int i = 0; i < count; i++ )
+                rows[i] = in[i].ptr<uchar>(y);
+            uchar* d = out.ptr<uchar>(y);
+            switch( shift )
+            {
+            case 15: compose_detail::weightedRow<15>( &rows[0], &w[0], pairs, bias, d, len, &zeros[0] ); break;
+            case 14: compose_detail::weightedRow<14>( &rows[0], &w[0], pairs, bias, d, len, &zeros[0] ); break;
+            case 13: compose_detail::weightedRow<13>( &rows[0], &w[0], pairs, bias, d, len, &zeros[0] ); break;
+            case 12: compose_detail::weightedRow<12>( &rows[0], &w[0], pairs, bias, d, len, &zeros[0] ); break;
+            }
+        }
+    } );
+}
+
+/**
+ * @brief dst = saturate(round(sum of alphas[i]*srcs[i]/255)), one pass over all sources and masks
+ * @param alphas CV_8U masks of the source size, with one channel or as many as the sources
+ */
+static inline void composeMasked( const std::vector<cv::Mat>& srcs, const std::vector<cv::Mat>& alphas, cv::Mat& dst )
+{
+    compose_detail::checkSources( srcs );
+    CV_Assert( alphas.size() == srcs.size() && srcs[0].depth() == CV_8U );
+    const int count = (int)srcs.size(), cn = srcs[0].channels();
+    const cv::Size size = srcs[0].size();
+    for( int i = 0; i < count; i++ )
+        CV_Assert( alphas[i].size() == size && alphas[i].depth() == CV_8U &&
+                   (alphas[i].channels() == 1 || alphas[i].channels() == cn) );
+
+    std::vector<cv::Mat> in( srcs ), a( alphas );
+    for( int i = 0; i < count; i++ )
+    {
+        if( in[i].data == dst.data ) in[i] = in[i].clone();
+        if( a[i].data == dst.data ) a[i] = a[i].clone();
+    }
+    dst.create( size, srcs[0].type() );
+    cv::Mat out = dst;
+    const int len = size.width*cn;
+
+    cv::parallel_for_( cv::Range( 0, size.height ), [&]( const cv::Range& r )
+    {
+        SAMPLES_TRACE_SCOPE( "composeMasked rows" );
+        std::vector<const uchar*> rows( count ), arows( count );
+        std::vector<uchar> expanded;  //单通道掩码按通道展开后的行
+        for( int y = r.start; y < r.end; y++ )
+        {
+            for( int i = 0; i < count; i++ )
+            {
+                rows[i] = in[i].ptr<uchar>(y);
+                arows[i] = a[i].ptr<uchar>(y);
+            }
+            if( cn > 1 )
+            {
+                expanded.resize( (size_t)count*len );
+                for( int i = 0; i < count; i++ )
+                {
+                    if( a[i].channels() != 1 )
+                        continue;
+                    uchar* e = &expanded[(size_t)i*len];
+                    for( int x = 0; x < size.width; x++ )
+                        for( int c = 0; c < cn; c++ )
+                            e[x*cn + c] = arows[i][x];
+                    arows[i] = e;
+                }
+            }
+            compose_detail::maskedRow( &rows[0], &arows[0], count, out.ptr<uchar>(y), len );
+        }
+    } );
+}
+
+} // namespace samples
+
+#endif // SAMPLES_COMPOSITOR_HPP
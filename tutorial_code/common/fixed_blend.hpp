@@ -0,0 +1,273 @@
+/**
+ * @file fixed_blend.hpp
+ * @brief Fixed-point addWeighted for 8-bit images with Q15/Q8 weights and selectable rounding
+ * @author OpenCV team
+ */
+
+/**
+ * 定点数的线性混合
+ * addWeighted 对 8 位图像逐像素做浮点乘加：u8 转 float、两次乘法、加法、舍入、再转回 u8。
+ * 权重固定时可以先把它们量化成整数，整个混合只用 16 位整数 SIMD：
+ *  - BLEND_Q15：权重放大 2^15（有权重达到 1 时用 2^14，依此类推），像素与权重交错成 16 位对，
+ *    v_dotprod 一次完成 a*wa + b*wb 并累加到 32 位，误差约 1/32768
+ *  - BLEND_Q8：权重放大 2^8，a*wa + b*wb 直接在 16 位无符号数里累加，每条指令处理的像素是 Q15 的两倍，
+ *    只适用于非负权重且 255*(wa + wb) + gamma 不超过 16 位的情况，否则自动改用 Q15
+ * 舍入方式：
+ *  - BLEND_ROUND_NEAREST：右移前加上 0.5，结果是定点和四舍五入，与 addWeighted 通常最多差 1
+ *  - BLEND_TRUNCATE：直接右移，即向下取整，少一次加法，结果平均偏小 0.5
+ * 与浮点结果的最大偏差用 norm(ref, dst, NORM_INF) 测量，见 AddingImages.cpp。
+ *
+ * 两幅图固定、只有 alpha 变化时（滑动条），alpha*src1 + (1 - alpha)*src2 = src2 + alpha*(src1 - src2)：
+ * DifferenceBlend 预先算好 16 位有符号的差 src1 - src2，之后每次只需一次乘加。
+ */
+
+#ifndef SAMPLES_FIXED_BLEND_HPP
+#define SAMPLES_FIXED_BLEND_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace samples {
+
+/// Fixed-point format of the weights
+enum BlendPrecision
+{
+    BLEND_Q15 = 0,  ///< 16-bit signed weights, 32-bit accumulation
+    BLEND_Q8  = 1   ///< 8.8 unsigned weights, 16-bit accumulation
+};
+
+/// How the fixed-point sum is turned into a pixel
+enum BlendRounding
+{
+    BLEND_ROUND_NEAREST = 0,  ///< add half an output step before shifting
+    BLEND_TRUNCATE      = 1   ///< shift only, rounding towards minus infinity
+};
+
+/**
+ * @brief dst = saturate(alpha*src1 + beta*src2 + gamma) in fixed point for 8-bit data
+ *
+ * The weights are quantized once in the constructor; apply() can then be called for any number of
+ * frames. valid() is false when the weights are too large for 16-bit fixed point (|w| >= 8), in which
+ * case addWeightedFixed() uses addWeighted.
+ */
+class FixedBlend
+{
+public:
+    FixedBlend( double alpha, double beta, double gamma,
+                BlendPrecision precision = BLEND_Q15, BlendRounding rounding = BLEND_ROUND_NEAREST )
+        : precision_(precision), shift_(0), wa_(0), wb_(0), bias_(0)
+    {
+        if( precision_ == BLEND_Q8 )
+        {
+            int wa = cvRound( alpha*256 ), wb = cvRound( beta*256 );
+            int bias = cvRound( gamma*256 ) + (rounding == BLEND_ROUND_NEAREST ? 128 : 0);
+            if( wa >= 0 && wb >= 0 && bias >= 0 && 255*(wa + wb) + bias <= 65535 )
+            {
+                shift_ = 8; wa_ = wa; wb_ = wb; bias_ = bias;
+                return;
+            }
+            precision_ = BLEND_Q15;  //16 位无符号数放不下，改用 Q15
+        }
+
+        // 取权重仍能放进 16 位有符号数的最大小数位数
+        const double w = std::max( std::fabs( alpha ), std::fabs( beta ) );
+        for( int s = 15; s >= 12 && !shift_; s-- )
+            if( cvRound( w*(1 << s) ) <= 32767 && std::fabs( gamma )*(1 << s) < (double)(1 << 30) )
+                shift_ = s;
+        if( !shift_ )
+            return;
+        wa_ = cvRound( alpha*(1 << shift_) );
+        wb_ = cvRound( beta*(1 << shift_) );
+        bias_ = cvRound( gamma*(1 << shift_) ) + (rounding == BLEND_ROUND_NEAREST ? 1 << (shift_ - 1) : 0);
+    }
+
+    bool valid() const { return shift_ != 0; }
+    /// Format actually used, Q8 falls back to Q15 for negative or too large weights
+    BlendPrecision precision() const { return precision_; }
+    /// Fractional bits of the weights
+    int shift() const { return shift_; }
+    /// Quantized weights as applied
+    double alpha() const { return (double)wa_/(1 << shift_); }
+    double beta() const { return (double)wb_/(1 << shift_); }
+
+    /// One row of n bytes, channels interleaved
+    void apply( const uchar* a, const uchar* b, uchar* d, int n ) const
+    {
+        if( precision_ == BLEND_Q8 )
+        {
+            rowQ8( a, b, d, n );
+            return;
+        }
+        switch( shift_ )
+        {
+        case 15: rowQ15<15>( a, b, d, n ); break;
+        case 14: rowQ15<14>( a, b, d, n ); break;
+        case 13: rowQ15<13>( a, b, d, n ); break;
+        case 12: rowQ15<12>( a, b, d, n ); break;
+        }
+    }
+
+    /// Whole images of the same size and CV_8U type, rows in parallel
+    void apply( const cv::Mat& src1, const cv::Mat& src2, cv::Mat& dst ) const
+    {
+        CV_Assert( valid() && src1.depth() == CV_8U && src1.size() == src2.size() && src1.type() == src2.type() );
+        dst.create( src1.size(), src1.type() );
+        cv::Mat out = dst;
+        const int len = src1.cols*src1.channels();
+        cv::parallel_for_( cv::Range( 0, src1.rows ), [&]( const cv::Range& r )
+        {
+            SAMPLES_TRACE_SCOPE( "FixedBlend rows" );
+            for( int y = r.start; y < r.end; y++ )
+                apply( src1.ptr<uchar>(y), src2.ptr<uchar>(y), out.ptr<uchar>(y), len );
+        } );
+    }
+
+private:
+    void rowQ8( const uchar* a, const uchar* b, uchar* d, int n ) const
+    {
+        int i = 0;
+#if CV_SIMD
+        const int VECSZ = cv::VTraits<cv::v_uint8>::vlanes();
+        const cv::v_uint16 wa = cv::vx_setall_u16( (ushort)wa_ ), wb = cv::vx_setall_u16( (ushort)wb_ );
+        const cv::v_uint16 bias = cv::vx_setall_u16( (ushort)bias_ );
+        for( ; i <= n - VECSZ; i += VECSZ )
+        {
+            cv::v_uint16 a0, a1, b0, b1;
+            cv::v_expand( cv::vx_load( a + i ), a0, a1 );
+            cv::v_expand( cv::vx_load( b + i ), b0, b1 );
+            // 构造时保证 255*(wa + wb) + bias 不超过 65535，不会回绕
+            a0 = cv::v_add_wrap( cv::v_add_wrap( cv::v_mul_wrap( a0, wa ), cv::v_mul_wrap( b0, wb ) ), bias );
+            a1 = cv::v_add_wrap( cv::v_add_wrap( cv::v_mul_wrap( a1, wa ), cv::v_mul_wrap( b1, wb ) ), bias );
+            cv::v_store( d + i, cv::v_pack( cv::v_shr<8>( a0 ), cv::v_shr<8>( a1 ) ) );
+        }
+#endif
+        for( ; i < n; i++ )
+            d[i] = (uchar)std::min( (a[i]*wa_ + b[i]*wb_ + bias_) >> 8, 255 );
+    }
+
+    template<int S>
+    void rowQ15( const uchar* a, const uchar* b, uchar* d, int n ) const
+    {
+        int i = 0;
+#if CV_SIMD
+        const int VECSZ = cv::VTraits<cv::v_uint8>::vlanes();
+        // 权重交错成 (wa, wb) 对，与像素对 (a, b) 做 v_dotprod
+        cv::v_int16 w, unused;
+        cv::v_zip( cv::vx_setall_s16( (short)wa_ ), cv::vx_setall_s16( (short)wb_ ), w, unused );
+        const cv::v_int32 bias = cv::vx_setall_s32( bias_ );
+        for( ; i <= n - VECSZ; i += VECSZ )
+        {
+            cv::v_uint16 a0, a1, b0, b1;
+            cv::v_expand( cv::vx_load( a + i ), a0, a1 );
+            cv::v_expand( cv::vx_load( b + i ), b0, b1 );
+            cv::v_int16 p0, p1, p2, p3;
+            cv::v_zip( cv::v_reinterpret_as_s16( a0 ), cv::v_reinterpret_as_s16( b0 ), p0, p1 );
+            cv::v_zip( cv::v_reinterpret_as_s16( a1 ), cv::v_reinterpret_as_s16( b1 ), p2, p3 );
+            cv::v_int16 lo = cv::v_pack( cv::v_shr<S>( cv::v_dotprod( p0, w, bias ) ),
+                                         cv::v_shr<S>( cv::v_dotprod( p1, w, bias ) ) );
+            cv::v_int16 hi = cv::v_pack( cv::v_shr<S>( cv::v_dotprod( p2, w, bias ) ),
+                                         cv::v_shr<S>( cv::v_dotprod( p3, w, bias ) ) );
+            cv::v_store( d + i, cv::v_pack_u( lo, hi ) );
+        }
+#endif
+        for( ; i < n; i++ )
+            d[i] = cv::saturate_cast<uchar>( (a[i]*wa_ + b[i]*wb_ + bias_) >> S );
+    }
+
+    BlendPrecision precision_;
+    int shift_;
+    int wa_, wb_, bias_;
+};
+
+/**
+ * @brief Same as addWeighted(src1, alpha, src2, beta, gamma, dst) for CV_8U images, in fixed point
+ * Other depths, and weights FixedBlend cannot represent, go to addWeighted.
+ */
+static inline void addWeightedFixed( const cv::Mat& src1, double alpha, const cv::Mat& src2, double beta, double gamma,
+                                     cv::Mat& dst, BlendPrecision precision = BLEND_Q15,
+                                     BlendRounding rounding = BLEND_ROUND_NEAREST )
+{
+    FixedBlend blend( alpha, beta, gamma, precision, rounding );
+    if( src1.depth() != CV_8U || !blend.valid() )
+        cv::addWeighted( src1, alpha, src2, beta, gamma, dst );
+    else
+        blend.apply( src1, src2, dst );
+}
+
+/**
+ * @brief dst = src2 + alpha*(src1 - src2) for a fixed pair of CV_8U images and changing alpha
+ *
+ * setSources() stores src1 - src2 once as CV_16S. Each apply() is then one multiply-add per value:
+ * (diff, src2) pairs times (alpha, 1) in Q14 by v_dotprod, equal to alpha*src1 + (1 - alpha)*src2.
+ * src2 is referenced, not copied, and must stay unchanged until setSources() is called again.
+ */
+class DifferenceBlend
+{
+public:
+    DifferenceBlend() {}
+    DifferenceBlend( const cv::Mat& src1, const cv::Mat& src2 ) { setSources( src1, src2 ); }
+
+    void setSources( const cv::Mat& src1, const cv::Mat& src2 )
+    {
+        CV_Assert( src1.depth() == CV_8U && src1.size() == src2.size() && src1.type() == src2.type() );
+        src2_ = src2;
+        cv::subtract( src1, src2, diff_, cv::noArray(), CV_16S );
+    }
+
+    bool empty() const { return diff_.empty(); }
+
+    /// |alpha| <= 32767/16384, so that alpha in Q14 fits a short; BLEND_TRUNCATE floors instead of rounding
+    void apply( double alpha, cv::Mat& dst, BlendRounding rounding = BLEND_ROUND_NEAREST ) const
+    {
+        CV_Assert( !empty() && std::fabs( alpha ) <= 32767.0/(1 << 14) );
+        const int a = cvRound( alpha*(1 << 14) ), bias = rounding == BLEND_ROUND_NEAREST ? 1 << 13 : 0;
+        dst.create( src2_.size(), src2_.type() );
+        cv::Mat out = dst;
+        const int len = src2_.cols*src2_.channels();
+        cv::parallel_for_( cv::Range( 0, src2_.rows ), [&]( const cv::Range& r )
+        {
+            SAMPLES_TRACE_SCOPE( "DifferenceBlend rows" );
+            for( int y = r.start; y < r.end; y++ )
+                row( diff_.ptr<short>(y), src2_.ptr<uchar>(y), out.ptr<uchar>(y), len, a, bias );
+        } );
+    }
+
+private:
+    static void row( const short* diff, const uchar* src2, uchar* d, int n, int a, int bias )
+    {
+        int i = 0;
+#if CV_SIMD
+        const int VECSZ = cv::VTraits<cv::v_uint8>::vlanes(), HALF = VECSZ/2;
+        cv::v_int16 w, unused;
+        cv::v_zip( cv::vx_setall_s16( (short)a ), cv::vx_setall_s16( 1 << 14 ), w, unused );
+        const cv::v_int32 b = cv::vx_setall_s32( bias );
+        for( ; i <= n - VECSZ; i += VECSZ )
+        {
+            cv::v_uint16 s0, s1;
+            cv::v_expand( cv::vx_load( src2 + i ), s0, s1 );
+            cv::v_int16 p0, p1, p2, p3;
+            cv::v_zip( cv::vx_load( diff + i ), cv::v_reinterpret_as_s16( s0 ), p0, p1 );
+            cv::v_zip( cv::vx_load( diff + i + HALF ), cv::v_reinterpret_as_s16( s1 ), p2, p3 );
+            cv::v_int16 lo = cv::v_pack( cv::v_shr<14>( cv::v_dotprod( p0, w, b ) ),
+                                         cv::v_shr<14>( cv::v_dotprod( p1, w, b ) ) );
+            cv::v_int16 hi = cv::v_pack( cv::v_shr<14>( cv::v_dotprod( p2, w, b ) ),
+                                         cv::v_shr<14>( cv::v_dotprod( p3, w, b ) ) );
+            cv::v_store( d + i, cv::v_pack_u( lo, hi ) );
+        }
+#endif
+        for( ; i < n; i++ )
+            d[i] = cv::saturate_cast<uchar>( (diff[i]*a + (src2[i] << 14) + bias) >> 14 );
+    }
+
+    cv::Mat diff_;  ///< src1 - src2, CV_16S
+    cv::Mat src2_;
+};
+
+} // namespace samples
+
+#endif // SAMPLES_FIXED_BLEND_HPP
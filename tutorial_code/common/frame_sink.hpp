@@ -0,0 +1,252 @@
+/**
+ * @file frame_sink.hpp
+ * @brief Frame sinks for the samples: discard, image sequence, video file, shared memory
+ * @author OpenCV team
+ */
+
+/**
+ * 帧输出
+ * 与 frame_source.hpp 对应，把处理结果写到哪里也抽象出来：
+ *  - 空串或 null       丢弃，只做计时
+ *  - 含 % 的路径        图像序列，frames/%05d.png 依次写出每一帧
+ *  - shm:名字           POSIX 共享内存，只保存最新的一帧，供另一个进程读取
+ *  - 其他路径           视频文件，按扩展名选编码（.avi 用 MJPG，其他用 mp4v）
+ * 视频文件和共享内存在写第一帧时按帧的大小打开，之后大小不同的帧写入失败。统计写出的帧数、帧率和每帧写入耗时。
+ * 有了输出抽象，示例程序可以不创建窗口（无界面环境下的批处理），用 --output 选择输出，
+ * imshow/waitKey 的时间也不再计入测量。
+ */
+
+#ifndef SAMPLES_FRAME_SINK_HPP
+#define SAMPLES_FRAME_SINK_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/videoio.hpp"
+
+#include "frame_source.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace samples {
+
+/**
+ * @brief Base class of all frame sinks
+ * write() adds statistics around the backend's writeFrame(); latency is the time spent writing.
+ */
+class FrameSink
+{
+public:
+    virtual ~FrameSink() {}
+
+    bool write( const cv::Mat& frame )
+    {
+        cv::int64 t0 = cv::getTickCount();
+        if( !writeFrame( frame ) )
+            return false;
+        cv::int64 t1 = cv::getTickCount();
+
+        double latency = 1000.0*(t1 - t0)/cv::getTickFrequency();
+        if( stats_.frames == 0 )
+            stats_.startTick = t1;
+        stats_.lastTick = t1;
+        stats_.frames++;
+        stats_.latencySumMs += latency;
+        stats_.latencyMaxMs = std::max( stats_.latencyMaxMs, latency );
+        stats_.lastLatencyMs = latency;
+        return true;
+    }
+
+    const FrameStats& stats() const { return stats_; }
+
+    /**
+     * @brief Creates a sink from a specification string
+     * "" or "null", a pattern with '%' for an image sequence, "shm:name" for shared memory,
+     * otherwise a video file written at fps.
+     */
+    static cv::Ptr<FrameSink> create( const cv::String& spec, double fps = 30 );
+
+protected:
+    virtual bool writeFrame( const cv::Mat& frame ) = 0;
+
+private:
+    FrameStats stats_;
+};
+
+/// Discards the frames
+class NullSink : public FrameSink
+{
+protected:
+    bool writeFrame( const cv::Mat& ) CV_OVERRIDE { return true; }
+};
+
+/// One image file per frame, named by a printf pattern of the frame index
+class ImageSequenceSink : public FrameSink
+{
+public:
+    explicit ImageSequenceSink( const cv::String& pattern, int first = 0 ) : pattern_(pattern), next_(first) {}
+
+protected:
+    bool writeFrame( const cv::Mat& frame ) CV_OVERRIDE
+    {
+        std::vector<char> name( pattern_.size() + 32 );
+        std::snprintf( &name[0], name.size(), pattern_.c_str(), next_++ );
+        return cv::imwrite( &name[0], frame );
+    }
+
+private:
+    cv::String pattern_;
+    int next_;
+};
+
+/// Video file through VideoWriter, opened with the size and channels of the first frame; other sizes are refused
+class VideoSink : public FrameSink
+{
+public:
+    VideoSink( const cv::String& path, double fps, int fourcc ) : path_(path), fps_(fps), fourcc_(fourcc), color_(false) {}
+
+protected:
+    bool writeFrame( const cv::Mat& frame ) CV_OVERRIDE
+    {
+        if( !writer_.isOpened() )
+        {
+            if( !writer_.open( path_, fourcc_, fps_, frame.size(), frame.channels() > 1 ) )
+                return false;
+            size_ = frame.size();
+            color_ = frame.channels() > 1;
+        }
+        // VideoWriter 不报错地丢弃大小或通道数不同的帧，这里拒绝，统计中不计入
+        if( frame.size() != size_ || (frame.channels() > 1) != color_ )
+            return false;
+        writer_.write( frame );
+        return true;
+    }
+
+private:
+    cv::VideoWriter writer_;
+    cv::String path_;
+    double fps_;
+    int fourcc_;
+    cv::Size size_;
+    bool color_;
+};
+
+/**
+ * @brief Latest frame in a POSIX shared memory object, for a consumer in another process
+ *
+ * Layout: a 64-byte Header followed by the pixels, rows*cols*elemSize bytes without row padding.
+ * The object is sized by the first frame; larger frames are refused. Writes follow a sequence lock:
+ * sequence is odd while a frame is being copied, so a reader copies the frame between two equal even
+ * values of sequence. The name is unlinked when the sink is destroyed; mappings stay valid.
+ */
+class SharedMemorySink : public FrameSink
+{
+public:
+    struct Header
+    {
+        std::atomic<unsigned long long> sequence;  ///< 2*frames written, odd during a write
+        int rows, cols, type, reserved;
+        unsigned long long capacity;               ///< bytes available for pixels
+        char padding[64 - 2*sizeof(unsigned long long) - 4*sizeof(int)];
+    };
+
+    /// name is a POSIX shared memory name; a leading '/' is added if missing
+    explicit SharedMemorySink( const cv::String& name )
+        : name_( name.empty() || name[0] != '/' ? "/" + name : name ), fd_(-1), map_(0), size_(0) {}
+
+    ~SharedMemorySink()
+    {
+#ifndef _WIN32
+        if( map_ )
+            munmap( map_, size_ );
+        if( fd_ >= 0 )
+        {
+            close( fd_ );
+            shm_unlink( name_.c_str() );
+        }
+#endif
+    }
+
+protected:
+    bool writeFrame( const cv::Mat& frame ) CV_OVERRIDE
+    {
+        const size_t row = frame.cols*frame.elemSize(), bytes = row*frame.rows;
+        if( !map_ && (fd_ >= 0 || !open( bytes )) )
+            return false;  // not opened, or a previous open failed
+        Header* h = (Header*)map_;
+        if( bytes > h->capacity )
+            return false;
+
+        uchar* pixels = (uchar*)map_ + sizeof(Header);
+        const unsigned long long seq = h->sequence.load( std::memory_order_relaxed );
+        h->sequence.store( seq + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+        h->rows = frame.rows;
+        h->cols = frame.cols;
+        h->type = frame.type();
+        for( int y = 0; y < frame.rows; y++ )
+            std::memcpy( pixels + y*row, frame.ptr(y), row );
+        h->sequence.store( seq + 2, std::memory_order_release );
+        return true;
+    }
+
+private:
+    bool open( size_t bytes )
+    {
+#ifndef _WIN32
+        CV_Assert( sizeof(Header) == 64 );
+        fd_ = shm_open( name_.c_str(), O_CREAT | O_RDWR, 0600 );
+        if( fd_ < 0 )
+            return false;
+        size_ = sizeof(Header) + bytes;
+        if( ftruncate( fd_, (off_t)size_ ) != 0 )
+            return false;
+        void* p = mmap( 0, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0 );
+        if( p == MAP_FAILED )
+            return false;
+        map_ = p;
+        Header* h = new( map_ ) Header();
+        h->sequence.store( 0 );
+        h->capacity = bytes;
+        return true;
+#else
+        (void)bytes;
+        return false;
+#endif
+    }
+
+    cv::String name_;
+    int fd_;
+    void* map_;
+    size_t size_;
+};
+
+inline cv::Ptr<FrameSink> FrameSink::create( const cv::String& spec, double fps )
+{
+    if( spec.empty() || spec == "null" )
+        return cv::makePtr<NullSink>();
+    if( spec.compare( 0, 4, "shm:" ) == 0 )
+        return cv::makePtr<SharedMemorySink>( spec.substr( 4 ) );
+    if( spec.find( '%' ) != cv::String::npos )
+        return cv::makePtr<ImageSequenceSink>( spec );
+
+    size_t dot = spec.rfind( '.' );
+    cv::String ext = dot == cv::String::npos ? cv::String() : spec.substr( dot );
+    int fourcc = ext == ".avi" ? cv::VideoWriter::fourcc( 'M', 'J', 'P', 'G' ) : cv::VideoWriter::fourcc( 'm', 'p', '4', 'v' );
+    return cv::makePtr<VideoSink>( spec, fps > 0 ? fps : 30, fourcc );
+}
+
+} // namespace samples
+
+#endif // SAMPLES_FRAME_SINK_HPP
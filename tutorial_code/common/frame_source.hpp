@@ -0,0 +1,282 @@
+/**
+ * @file frame_source.hpp
+ * @brief Frame sources for the video samples: camera, video file replay, image sequence, synthetic generator
+ * @author OpenCV team
+ */
+
+/**
+ * 帧来源
+ * Threshold_inRange.cpp 写死了 VideoCapture cap(0)，没有摄像头的机器上无法做基准测试或回归测试。
+ * FrameSource 把帧的来源抽象出来：
+ *  - camera:N          摄像头
+ *  - 视频文件路径       回放视频文件，可循环
+ *  - 含 % 或 * 的路径   图像序列（%04d 交给 VideoCapture 的 CAP_IMAGES，* 用 glob 列出文件）
+ *  - synthetic:WxH     确定性的合成画面，每次运行内容完全相同
+ * 可以按帧率实时播放(realtime)，也可以尽可能快地读取，并统计帧率和每帧读取延迟。
+ */
+
+#ifndef SAMPLES_FRAME_SOURCE_HPP
+#define SAMPLES_FRAME_SOURCE_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/videoio.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace samples {
+
+/**
+ * @brief Throughput and read latency of a frame source
+ */
+struct FrameStats
+{
+    FrameStats() : frames(0), startTick(0), lastTick(0), latencySumMs(0), latencyMaxMs(0), lastLatencyMs(0) {}
+
+    long long frames;
+    cv::int64 startTick, lastTick;  ///< ticks of the first and the last delivered frame
+    double latencySumMs;            ///< time spent inside read() or write(), pacing excluded
+    double latencyMaxMs;
+    double lastLatencyMs;           ///< read latency of the last delivered frame
+
+    double seconds() const { return frames > 1 ? (double)(lastTick - startTick)/cv::getTickFrequency() : 0; }
+    double fps() const { return seconds() > 0 ? (frames - 1)/seconds() : 0; }
+    double meanLatencyMs() const { return frames > 0 ? latencySumMs/frames : 0; }
+
+    /// what names the timed call: "read" for sources, "write" for sinks
+    void print( std::ostream& out, const char* name = "source", const char* what = "read" ) const
+    {
+        out << name << ": " << frames << " frames, " << fps() << " frames/s, " << what << " latency "
+            << meanLatencyMs() << " ms mean / " << latencyMaxMs << " ms max" << std::endl;
+    }
+};
+
+/**
+ * @brief Base class of all frame sources
+ *
+ * read() adds pacing, a frame limit and statistics around the backend's readFrame().
+ * In real-time mode frame i is delivered no earlier than i/fps seconds after the first one.
+ */
+class FrameSource
+{
+public:
+    FrameSource() : realtime_(false), maxFrames_(0), fps_(0) {}
+    virtual ~FrameSource() {}
+
+    /// Next frame into frame (its buffer is reused when the size matches); false at the end
+    bool read( cv::Mat& frame )
+    {
+        if( maxFrames_ > 0 && stats_.frames >= maxFrames_ )
+            return false;
+
+        cv::int64 t0 = cv::getTickCount();
+        if( !readFrame( frame ) || frame.empty() )
+            return false;
+        cv::int64 t1 = cv::getTickCount();
+
+        double fps = fps_ > 0 ? fps_ : nominalFps();
+        if( realtime_ && fps > 0 && stats_.frames > 0 )
+        {
+            // 第 i 帧不早于 start + i/fps 送出
+            double due = stats_.frames/fps - (double)(t1 - stats_.startTick)/cv::getTickFrequency();
+            if( due > 0 )
+                std::this_thread::sleep_for( std::chrono::microseconds( (long long)(due*1e6) ) );
+        }
+
+        double latency = 1000.0*(t1 - t0)/cv::getTickFrequency();
+        if( stats_.frames == 0 )
+            stats_.startTick = cv::getTickCount();
+        stats_.lastTick = cv::getTickCount();
+        stats_.frames++;
+        stats_.latencySumMs += latency;
+        stats_.latencyMaxMs = std::max( stats_.latencyMaxMs, latency );
+        stats_.lastLatencyMs = latency;
+        return true;
+    }
+
+    /// Real-time pacing at fps() instead of as fast as possible
+    void setRealtime( bool realtime ) { realtime_ = realtime; }
+    /// Stops after n frames, 0 for no limit
+    void setMaxFrames( long long n ) { maxFrames_ = n; }
+    /// Overrides the frame rate reported by the backend
+    void setFps( double fps ) { fps_ = fps; }
+    double fps() const { return fps_ > 0 ? fps_ : nominalFps(); }
+    const FrameStats& stats() const { return stats_; }
+
+    /**
+     * @brief Creates a source from a specification string
+     * "camera:N" or a bare number, "synthetic:WxH", a pattern with '%' or '*', or a video file.
+     * @param loop rewinds files and sequences at their end
+     */
+    static cv::Ptr<FrameSource> create( const cv::String& spec, bool loop = false );
+
+protected:
+    virtual bool readFrame( cv::Mat& frame ) = 0;
+    virtual double nominalFps() const { return 0; }
+
+private:
+    bool realtime_;
+    long long maxFrames_;
+    double fps_;
+    FrameStats stats_;
+};
+
+/**
+ * @brief Camera or video file through VideoCapture, with optional rewind at the end
+ */
+class CaptureSource : public FrameSource
+{
+public:
+    explicit CaptureSource( int camera ) : cap_( camera ), loop_(false) {}
+    CaptureSource( const cv::String& path, bool loop, int apiPreference = cv::CAP_ANY )
+        : cap_( path, apiPreference ), loop_(loop) {}
+
+    bool isOpened() const { return cap_.isOpened(); }
+
+protected:
+    bool readFrame( cv::Mat& frame ) CV_OVERRIDE
+    {
+        if( cap_.read( frame ) )
+            return true;
+        if( !loop_ || !cap_.set( cv::CAP_PROP_POS_FRAMES, 0 ) )
+            return false;
+        return cap_.read( frame );
+    }
+
+    double nominalFps() const CV_OVERRIDE { return cap_.get( cv::CAP_PROP_FPS ); }
+
+private:
+    cv::VideoCapture cap_;
+    bool loop_;
+};
+
+/**
+ * @brief Files matched by a glob pattern, read in sorted order
+ * With preload the images are decoded once up front so decoding does not distort measurements.
+ */
+class ImageSequenceSource : public FrameSource
+{
+public:
+    ImageSequenceSource( const cv::String& pattern, bool loop, bool preload = true )
+        : loop_(loop), next_(0)
+    {
+        cv::glob( pattern, files_ );
+        std::sort( files_.begin(), files_.end() );
+        if( preload )
+            for( size_t i = 0; i < files_.size(); i++ )
+                images_.push_back( cv::imread( files_[i], cv::IMREAD_COLOR ) );
+    }
+
+    size_t size() const { return files_.size(); }
+
+protected:
+    bool readFrame( cv::Mat& frame ) CV_OVERRIDE
+    {
+        if( next_ >= files_.size() )
+        {
+            if( !loop_ || files_.empty() )
+                return false;
+            next_ = 0;
+        }
+        size_t i = next_++;
+        if( images_.empty() )
+            frame = cv::imread( files_[i], cv::IMREAD_COLOR );
+        else
+            images_[i].copyTo( frame );
+        return !frame.empty();
+    }
+
+private:
+    std::vector<cv::String> files_;
+    std::vector<cv::Mat> images_;
+    bool loop_;
+    size_t next_;
+};
+
+/**
+ * @brief Deterministic synthetic scene: a fixed textured background with moving colored boxes
+ *
+ * Frame i depends only on i and the seed, so every run produces the same sequence. One box uses
+ * a color inside the default inRange bounds of Threshold_inRange.cpp, the others lie outside.
+ * 第 i 帧只取决于 i 和种子；其中一个方块的颜色落在 Threshold_inRange.cpp 默认的阈值范围内。
+ */
+class SyntheticSource : public FrameSource
+{
+public:
+    SyntheticSource( cv::Size size, double fps = 30, unsigned seed = 0x12345678 )
+        : rate_(fps), index_(0)
+    {
+        background_.create( size, CV_8UC3 );
+        cv::RNG rng( seed );
+        for( int y = 0; y < size.height; y++ )
+        {
+            uchar* p = background_.ptr<uchar>(y);
+            for( int x = 0; x < size.width; x++ )
+            {
+                int n = rng.uniform( -8, 9 );
+                p[3*x]     = cv::saturate_cast<uchar>( 160 + 80*x/size.width + n );
+                p[3*x + 1] = cv::saturate_cast<uchar>( 140 + 80*y/size.height + n );
+                p[3*x + 2] = cv::saturate_cast<uchar>( 200 - 40*(x + y)/(size.width + size.height) + n );
+            }
+        }
+    }
+
+protected:
+    bool readFrame( cv::Mat& frame ) CV_OVERRIDE
+    {
+        background_.copyTo( frame );
+        const cv::Size sz = frame.size();
+        const int side = std::max( std::min( sz.width, sz.height )/8, 4 );
+        const double t = index_++/(rate_ > 0 ? rate_ : 30.0);
+
+        // 目标：沿椭圆运动，颜色在 (30..100) 范围内
+        cv::Point c( (int)(sz.width*(0.5 + 0.35*std::cos( t ))), (int)(sz.height*(0.5 + 0.35*std::sin( 1.3*t ))) );
+        cv::rectangle( frame, cv::Rect( c.x - side/2, c.y - side/2, side, side ), cv::Scalar( 60, 70, 80 ), cv::FILLED );
+        // 干扰：颜色在阈值范围外
+        cv::Point d( (int)(sz.width*(0.5 + 0.4*std::sin( 0.7*t ))), (int)(sz.height*(0.5 + 0.3*std::cos( t ))) );
+        cv::rectangle( frame, cv::Rect( d.x - side/3, d.y - side/3, 2*side/3, 2*side/3 ), cv::Scalar( 20, 200, 20 ), cv::FILLED );
+        return true;
+    }
+
+    double nominalFps() const CV_OVERRIDE { return rate_; }
+
+private:
+    cv::Mat background_;
+    double rate_;
+    long long index_;
+};
+
+inline cv::Ptr<FrameSource> FrameSource::create( const cv::String& spec, bool loop )
+{
+    if( spec.compare( 0, 10, "synthetic:" ) == 0 )
+    {
+        int w = 1280, h = 720;
+        std::sscanf( spec.c_str() + 10, "%dx%d", &w, &h );
+        return cv::makePtr<SyntheticSource>( cv::Size( w, h ) );
+    }
+    if( spec == "synthetic" )
+        return cv::makePtr<SyntheticSource>( cv::Size( 1280, 720 ) );
+
+    bool number = !spec.empty() && spec.find_first_not_of( "0123456789" ) == cv::String::npos;
+    if( number || spec.compare( 0, 7, "camera:" ) == 0 )
+        return cv::makePtr<CaptureSource>( std::atoi( spec.c_str() + (number ? 0 : 7) ) );
+
+    if( spec.find( '*' ) != cv::String::npos )
+        return cv::makePtr<ImageSequenceSource>( spec, loop );
+    if( spec.find( '%' ) != cv::String::npos )
+        return cv::makePtr<CaptureSource>( spec, loop, cv::CAP_IMAGES );
+    return cv::makePtr<CaptureSource>( spec, loop );
+}
+
+} // namespace samples
+
+#endif // SAMPLES_FRAME_SOURCE_HPP
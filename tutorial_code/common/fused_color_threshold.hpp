@@ -0,0 +1,131 @@
+/**
+ * @file fused_color_threshold.hpp
+ * @brief BGR -> gray conversion and threshold fused into one SIMD pass
+ * @author OpenCV team
+ */
+
+/**
+ * 颜色转换与阈值融合
+ * Threshold.cpp 先 cvtColor( src, src_gray, COLOR_BGR2GRAY ) 写出整幅灰度图，再由 threshold() 读回。
+ * 这里一次读取 BGR，用定点数计算亮度，立即做阈值，只写输出图像，省去中间的灰度平面。
+ *
+ * 亮度使用与 OpenCV RGB2Gray<uchar> 相同的 Q14 定点系数：
+ *     gray = (1868*B + 9617*G + 4899*R + (1 << 13)) >> 14
+ */
+
+#ifndef SAMPLES_FUSED_COLOR_THRESHOLD_HPP
+#define SAMPLES_FUSED_COLOR_THRESHOLD_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+#include "opencv2/imgproc.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+
+namespace samples {
+
+namespace fused_detail {
+
+enum { GRAY_SHIFT = 14, B2Y = 1868, G2Y = 9617, R2Y = 4899 };
+
+/// Threshold of one luma value, same rules as threshold() on CV_8U
+static inline uchar thresholdValue( int v, int thresh, int maxval, int type )
+{
+    bool above = v > thresh;
+    switch( type )
+    {
+    case cv::THRESH_BINARY:     return (uchar)(above ? maxval : 0);
+    case cv::THRESH_BINARY_INV: return (uchar)(above ? 0 : maxval);
+    case cv::THRESH_TRUNC:      return (uchar)(above ? std::max( thresh, 0 ) : v);
+    case cv::THRESH_TOZERO:     return (uchar)(above ? v : 0);
+    default:                    return (uchar)(above ? 0 : v);
+    }
+}
+
+static inline int luma( const uchar* bgr )
+{
+    return (bgr[0]*B2Y + bgr[1]*G2Y + bgr[2]*R2Y + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT;
+}
+
+/// One row: BGR in, thresholded luma out
+static void row( const uchar* src, uchar* dst, int width, int thresh, int maxval, int type )
+{
+    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    using namespace cv;
+    // 阈值在 [0, 254] 之间时才能用 8 位比较，其余情况（全 0、全 maxval、原样复制）走标量
+    if( thresh >= 0 && thresh < 255 )
+    {
+        const int VECSZ = VTraits<v_uint8>::vlanes();
+        v_int16 cbg, cr1, tmp;
+        v_zip( vx_setall_s16( (short)B2Y ), vx_setall_s16( (short)G2Y ), cbg, tmp );
+        v_zip( vx_setall_s16( (short)R2Y ), vx_setall_s16( (short)(1 << (GRAY_SHIFT - 1)) ), cr1, tmp );
+        const v_int16 one = vx_setall_s16( 1 );
+        const v_uint8 vthresh = vx_setall_u8( (uchar)thresh ), vmax = vx_setall_u8( (uchar)maxval );
+
+        for( ; x <= width - VECSZ; x += VECSZ )
+        {
+            v_uint8 b, g, r;
+            v_load_deinterleave( src + x*3, b, g, r );
+
+            // (b, g) 与 (r, 1) 两两交错，两次点积得到 32 位的 B2Y*b + G2Y*g + R2Y*r + 舍入项
+            v_uint16 b0, b1, g0, g1, r0, r1;
+            v_expand( b, b0, b1 ); v_expand( g, g0, g1 ); v_expand( r, r0, r1 );
+            v_int16 bg0, bg1, bg2, bg3, ro0, ro1, ro2, ro3;
+            v_zip( v_reinterpret_as_s16(b0), v_reinterpret_as_s16(g0), bg0, bg1 );
+            v_zip( v_reinterpret_as_s16(b1), v_reinterpret_as_s16(g1), bg2, bg3 );
+            v_zip( v_reinterpret_as_s16(r0), one, ro0, ro1 );
+            v_zip( v_reinterpret_as_s16(r1), one, ro2, ro3 );
+
+            v_int32 y0 = v_shr<GRAY_SHIFT>( v_dotprod( bg0, cbg, v_dotprod( ro0, cr1 ) ) );
+            v_int32 y1 = v_shr<GRAY_SHIFT>( v_dotprod( bg1, cbg, v_dotprod( ro1, cr1 ) ) );
+            v_int32 y2 = v_shr<GRAY_SHIFT>( v_dotprod( bg2, cbg, v_dotprod( ro2, cr1 ) ) );
+            v_int32 y3 = v_shr<GRAY_SHIFT>( v_dotprod( bg3, cbg, v_dotprod( ro3, cr1 ) ) );
+            v_uint8 gray = v_pack_u( v_pack( y0, y1 ), v_pack( y2, y3 ) );
+
+            v_uint8 mask = v_gt( gray, vthresh ), out;
+            switch( type )
+            {
+            case THRESH_BINARY:     out = v_and( mask, vmax ); break;
+            case THRESH_BINARY_INV: out = v_and( v_not( mask ), vmax ); break;
+            case THRESH_TRUNC:      out = v_min( gray, vthresh ); break;
+            case THRESH_TOZERO:     out = v_and( mask, gray ); break;
+            default:                out = v_and( v_not( mask ), gray ); break;
+            }
+            v_store( dst + x, out );
+        }
+    }
+#endif
+    for( ; x < width; x++ )
+        dst[x] = thresholdValue( luma( src + x*3 ), thresh, maxval, type );
+}
+
+} // namespace fused_detail
+
+/**
+ * @brief dst = threshold(cvtColor(src, COLOR_BGR2GRAY), thresh, maxval, type) without the gray plane
+ * @param src  CV_8UC3 BGR image
+ * @param dst  CV_8UC1 output, reused when already allocated
+ * @param type one of THRESH_BINARY .. THRESH_TOZERO_INV
+ */
+static inline void cvtColorThreshold( const cv::Mat& src, cv::Mat& dst, double thresh, double maxval, int type )
+{
+    CV_Assert( src.type() == CV_8UC3 && type >= cv::THRESH_BINARY && type <= cv::THRESH_TOZERO_INV );
+    dst.create( src.size(), CV_8UC1 );
+
+    const int t = std::min( std::max( cvFloor(thresh), -1 ), 255 );
+    const int m = cv::saturate_cast<uchar>( cvRound(maxval) );
+    cv::Mat out = dst;
+    cv::parallel_for_( cv::Range( 0, src.rows ), [&]( const cv::Range& r )
+    {
+        SAMPLES_TRACE_SCOPE( "fused threshold rows" );
+        for( int y = r.start; y < r.end; y++ )
+            fused_detail::row( src.ptr<uchar>(y), out.ptr<uchar>(y), src.cols, t, m, type );
+    } );
+}
+
+} // namespace samples
+
+#endif // SAMPLES_FUSED_COLOR_THRESHOLD_HPP
@@ -0,0 +1,237 @@
+/**
+ * @file image_cache.hpp
+ * @brief imread-compatible loader backed by a cache of decoded images in memory-mappable raw files
+ * @author OpenCV team
+ */
+
+/**
+ * 解码图像缓存
+ * 每个示例每次运行都用 imread 重新解码 lena.jpg、stuff.jpg 等图像，反复运行基准测试时，
+ * JPEG/PNG 解码占了启动时间的大部分。解码结果与文件内容一一对应，可以缓存：
+ *  - 键：源文件的规范路径和 imread 标志的哈希，加上源文件的修改时间和大小，任一变化即失效
+ *  - 格式：固定大小的文件头 + 原始像素，像素从 4096 字节（页）对齐处开始，行之间不填充（连续）
+ *  - 命中时用 mmap 映射缓存文件，返回直接指向映射的 Mat，不解码也不拷贝；
+ *    映射是私有的写时复制（MAP_PRIVATE），示例就地修改图像不会改动缓存文件，
+ *    未修改的页在多个并发进程之间共享同一份物理内存
+ *  - 未命中时 imread 解码，写入临时文件后 rename，多个进程同时写入也不会读到半个文件
+ * Mat 释放最后一个引用时由自定义的 MatAllocator 解除映射。
+ * 缓存目录取环境变量 OPENCV_SAMPLES_IMAGE_CACHE，未设置时为 /tmp/opencv_samples_image_cache，
+ * 设为空串关闭缓存。Windows 上直接调用 imread。
+ */
+
+#ifndef SAMPLES_IMAGE_CACHE_HPP
+#define SAMPLES_IMAGE_CACHE_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgcodecs.hpp"
+
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace samples {
+
+namespace image_cache_detail {
+
+/// Fixed-size header in front of the pixels of a cache file
+struct Header
+{
+    char magic[8];                   ///< "CVIMGRAW"
+    int version, flags;              ///< format version, imread flags
+    long long mtime, sourceSize;     ///< modification time (s) and size of the source file
+    unsigned long long key;          ///< hash of the canonical source path and the flags
+    int rows, cols, type, reserved;
+    unsigned long long step, offset; ///< bytes per row, file offset of the pixels
+};
+
+enum { VERSION = 1, ALIGN = 4096 };
+
+/// 64-bit FNV-1a
+static inline unsigned long long fnv1a( const std::string& s, unsigned long long h = 14695981039346656037ULL )
+{
+    for( size_t i = 0; i < s.size(); i++ )
+        h = (h ^ (unsigned char)s[i])*1099511628211ULL;
+    return h;
+}
+
+#ifndef _WIN32
+/// Unmaps the cache file when the last Mat referencing the mapping is released
+class MappedAllocator : public cv::MatAllocator
+{
+public:
+    // Reallocations of a mapped Mat go to the standard allocator
+    cv::UMatData* allocate( int dims, const int* sizes, int type, void* data, size_t* step,
+                            cv::AccessFlag flags, cv::UMatUsageFlags usage ) const CV_OVERRIDE
+    {
+        return cv::Mat::getStdAllocator()->allocate( dims, sizes, type, data, step, flags, usage );
+    }
+    bool allocate( cv::UMatData* u, cv::AccessFlag flags, cv::UMatUsageFlags usage ) const CV_OVERRIDE
+    {
+        return cv::Mat::getStdAllocator()->allocate( u, flags, usage );
+    }
+    void deallocate( cv::UMatData* u ) const CV_OVERRIDE
+    {
+        if( !u )
+            return;
+        munmap( u->origdata, u->size );
+        delete u;
+    }
+
+    static const MappedAllocator* instance()
+    {
+        static MappedAllocator allocator;
+        return &allocator;
+    }
+};
+#endif
+
+} // namespace image_cache_detail
+
+/**
+ * @brief Decoded images cached as raw files in a directory
+ *
+ * read() has the semantics of cv::imread. On a hit the returned Mat is a private mapping of the cache file.
+ */
+class ImageCache
+{
+public:
+    explicit ImageCache( const cv::String& dir = defaultDirectory() ) : dir_(dir), hits_(0), misses_(0) {}
+
+    /// $OPENCV_SAMPLES_IMAGE_CACHE, or /tmp/opencv_samples_image_cache when it is not set
+    static cv::String defaultDirectory()
+    {
+        const char* env = std::getenv( "OPENCV_SAMPLES_IMAGE_CACHE" );
+        return env ? cv::String( env ) : cv::String( "/tmp/opencv_samples_image_cache" );
+    }
+
+    bool enabled() const { return !dir_.empty(); }
+    long long hits() const { return hits_; }
+    long long misses() const { return misses_; }
+
+    cv::Mat read( const cv::String& path, int flags = cv::IMREAD_COLOR )
+    {
+#ifndef _WIN32
+        using namespace image_cache_detail;
+        struct stat st;
+        char real[PATH_MAX];
+        if( !enabled() || stat( path.c_str(), &st ) != 0 || !realpath( path.c_str(), real ) )
+            return cv::imread( path, flags );
+
+        Header want;
+        std::memset( &want, 0, sizeof(want) );
+        std::memcpy( want.magic, "CVIMGRAW", 8 );
+        want.version = VERSION;
+        want.flags = flags;
+        want.mtime = (long long)st.st_mtime;
+        want.sourceSize = (long long)st.st_size;
+        want.key = fnv1a( std::string( real ) + '\n' + std::to_string( flags ) );
+
+        char name[32];
+        std::snprintf( name, sizeof(name), "/%016llx.raw", want.key );
+        const std::string file = std::string( dir_ ) + name;
+
+        cv::Mat img = load( file, want );
+        if( !img.empty() )
+        {
+            hits_++;
+            return img;
+        }
+        misses_++;
+        img = cv::imread( path, flags );
+        if( !img.empty() )
+            store( file, want, img );
+        return img;
+#else
+        return cv::imread( path, flags );
+#endif
+    }
+
+private:
+#ifndef _WIN32
+    /// Maps a cache file whose header matches want, empty if it is missing, stale or inconsistent
+    static cv::Mat load( const std::string& file, const image_cache_detail::Header& want )
+    {
+        using namespace image_cache_detail;
+        int fd = ::open( file.c_str(), O_RDONLY );
+        if( fd < 0 )
+            return cv::Mat();
+        struct stat st;
+        Header h;
+        bool ok = fstat( fd, &st ) == 0 && (size_t)st.st_size >= sizeof(Header) &&
+                  pread( fd, &h, sizeof(h), 0 ) == (ssize_t)sizeof(h) &&
+                  std::memcmp( h.magic, want.magic, 8 ) == 0 && h.version == want.version &&
+                  h.flags == want.flags && h.mtime == want.mtime && h.sourceSize == want.sourceSize &&
+                  h.key == want.key && h.rows > 0 && h.cols > 0 &&
+                  h.type >= 0 && h.type == CV_MAT_TYPE(h.type) && //有效的深度和通道数
+                  h.step >= (unsigned long long)h.cols*CV_ELEM_SIZE(h.type) && //行之间不重叠
+                  h.step <= (unsigned long long)st.st_size && h.offset <= (unsigned long long)st.st_size &&
+                  h.offset + h.step*h.rows <= (unsigned long long)st.st_size;
+        void* p = ok ? mmap( 0, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 ) : MAP_FAILED;
+        ::close( fd );
+        if( p == MAP_FAILED )
+            return cv::Mat();
+
+        // The Mat owns the mapping through a UMatData of the mapped allocator
+        uchar* pixels = (uchar*)p + h.offset;
+        cv::Mat m( h.rows, h.cols, h.type, pixels, (size_t)h.step );
+        cv::UMatData* u = new cv::UMatData( MappedAllocator::instance() );
+        u->data = pixels;
+        u->origdata = (uchar*)p;
+        u->size = (size_t)st.st_size;
+        u->refcount = 1;
+        m.u = u;
+        return m;
+    }
+
+    /// Writes header and pixels to a temporary file renamed into place
+    void store( const std::string& file, const image_cache_detail::Header& want, const cv::Mat& img ) const
+    {
+        using namespace image_cache_detail;
+        mkdir( dir_.c_str(), 0755 );
+
+        Header h = want;
+        h.rows = img.rows;
+        h.cols = img.cols;
+        h.type = img.type();
+        h.step = img.cols*img.elemSize();
+        h.offset = ALIGN;
+
+        const std::string tmp = file + "." + std::to_string( (long long)getpid() ) + ".tmp";
+        FILE* f = std::fopen( tmp.c_str(), "wb" );
+        if( !f )
+            return;
+        std::vector<char> pad( ALIGN - sizeof(Header), 0 );
+        bool ok = std::fwrite( &h, sizeof(h), 1, f ) == 1 && std::fwrite( &pad[0], pad.size(), 1, f ) == 1;
+        for( int y = 0; ok && y < img.rows; y++ )
+            ok = std::fwrite( img.ptr(y), (size_t)h.step, 1, f ) == 1;
+        ok = std::fclose( f ) == 0 && ok;
+        if( !ok || std::rename( tmp.c_str(), file.c_str() ) != 0 )
+            std::remove( tmp.c_str() );
+    }
+#endif
+
+    cv::String dir_;
+    std::atomic<long long> hits_, misses_;
+};
+
+/// cv::imread through a process-wide ImageCache in ImageCache::defaultDirectory()
+static inline cv::Mat imreadCached( const cv::String& path, int flags = cv::IMREAD_COLOR )
+{
+    static ImageCache cache;
+    return cache.read( path, flags );
+}
+
+} // namespace samples
+
+#endif // SAMPLES_IMAGE_CACHE_HPP
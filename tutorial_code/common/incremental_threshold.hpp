@@ -0,0 +1,179 @@
+/**
+ * @file incremental_threshold.hpp
+ * @brief Incremental re-thresholding of an 8-bit image driven by an intensity-sorted pixel index
+ * @author OpenCV team
+ */
+
+/**
+ * 增量阈值
+ * Threshold.cpp 中滑动条每动一下就对整幅 src_gray 重新调用 threshold()。
+ * 这里先用计数排序按灰度建立一次像素位置索引：positions 中灰度为 v 的像素位于
+ * [offsets[v], offsets[v+1])。阈值从 t1 变为 t2 时，只有灰度在 (min(t1,t2), max(t1,t2)]
+ * 之间的像素结果会变，只改写这些像素即可（THRESH_TRUNC 例外，见 changedRange）。
+ * 类型或 maxval 改变时才整幅重新计算。
+ */
+
+#ifndef SAMPLES_INCREMENTAL_THRESHOLD_HPP
+#define SAMPLES_INCREMENTAL_THRESHOLD_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+namespace samples {
+
+/**
+ * @brief Keeps threshold(src, dst, thresh, maxval, type) up to date while thresh changes
+ *
+ * The index costs 4 bytes per pixel plus 257 offsets and is built once per source image.
+ * 索引每像素 4 字节，每幅图只建立一次。
+ */
+class IncrementalThreshold
+{
+public:
+    IncrementalThreshold() : thresh_(0), maxval_(0), type_(-1), updated_(0) {}
+
+    /// Builds the counting-sort index of src (CV_8UC1); the next apply() is a full pass
+    void build( const cv::Mat& src )
+    {
+        CV_Assert( src.type() == CV_8UC1 && src.total() < (size_t)INT_MAX );
+        src_ = src;
+        type_ = -1;
+
+        // 1. 直方图  2. 前缀和得到每个灰度的起始位置  3. 按灰度分桶写入像素位置（行优先，桶内有序）
+        offsets_.assign( 257, 0 );
+        for( int y = 0; y < src.rows; y++ )
+        {
+            const uchar* p = src.ptr<uchar>(y);
+            for( int x = 0; x < src.cols; x++ )
+                offsets_[p[x] + 1]++;
+        }
+        for( int v = 0; v < 256; v++ )
+            offsets_[v + 1] += offsets_[v];
+
+        positions_.resize( src.total() );
+        std::vector<unsigned> next( offsets_.begin(), offsets_.end() - 1 );
+        for( int y = 0; y < src.rows; y++ )
+        {
+            const uchar* p = src.ptr<uchar>(y);
+            unsigned idx = (unsigned)y*src.cols;
+            for( int x = 0; x < src.cols; x++ )
+                positions_[next[p[x]]++] = idx + x;
+        }
+    }
+
+    /**
+     * @brief Same result as threshold(src, dst, thresh, maxval, type) for the src given to build()
+     * Only thresh changes are incremental; a new type or maxval recomputes the whole image.
+     */
+    const cv::Mat& apply( double thresh, double maxval, int type )
+    {
+        CV_Assert( !src_.empty() && type >= cv::THRESH_BINARY && type <= cv::THRESH_TOZERO_INV );
+        int t = std::min( std::max( cvFloor(thresh), -1 ), 255 );
+        int m = cv::saturate_cast<uchar>( cvRound(maxval) );
+
+        if( type != type_ || m != maxval_ || dst_.empty() )
+        {
+            cv::threshold( src_, dst_, t, m, type );
+            updated_ = src_.total();
+        }
+        else if( t != thresh_ )
+        {
+            int lo, hi;
+            changedRange( thresh_, t, type, lo, hi );
+            updated_ = rewrite( lo, hi, lookUpTable( t, m, type ) );
+        }
+        else
+            updated_ = 0;
+
+        thresh_ = t; maxval_ = m; type_ = type;
+        return dst_;
+    }
+
+    /**
+     * @brief Calls fn(thresh, dst) for thresh = 0..255 in increasing order
+     * One full pass plus the deltas, instead of 256 full passes.
+     */
+    template<typename Fn>
+    void sweep( double maxval, int type, Fn fn )
+    {
+        for( int t = 0; t < 256; t++ )
+            fn( t, apply( t, maxval, type ) );
+    }
+
+    const cv::Mat& result() const { return dst_; }
+    /// Pixels rewritten by the last apply()
+    size_t lastUpdated() const { return updated_; }
+
+private:
+    /**
+     * @brief Intensities [lo, hi] whose output differs between thresholds t1 and t2
+     * 只有 (min, max] 之间的灰度会跨过阈值；THRESH_TRUNC 时大于阈值的像素输出就是阈值本身，
+     * 所以所有大于 min(t1,t2) 的像素都要改写。
+     */
+    static void changedRange( int t1, int t2, int type, int& lo, int& hi )
+    {
+        lo = std::min( t1, t2 ) + 1;
+        hi = type == cv::THRESH_TRUNC ? 255 : std::max( t1, t2 );
+    }
+
+    static std::vector<uchar> lookUpTable( int t, int maxval, int type )
+    {
+        std::vector<uchar> lut( 256 );
+        for( int v = 0; v < 256; v++ )
+        {
+            bool above = v > t;
+            switch( type )
+            {
+            case cv::THRESH_BINARY:     lut[v] = (uchar)(above ? maxval : 0); break;
+            case cv::THRESH_BINARY_INV: lut[v] = (uchar)(above ? 0 : maxval); break;
+            case cv::THRESH_TRUNC:      lut[v] = (uchar)(above ? std::max( t, 0 ) : v); break;
+            case cv::THRESH_TOZERO:     lut[v] = (uchar)(above ? v : 0); break;
+            default:                    lut[v] = (uchar)(above ? 0 : v); break;
+            }
+        }
+        return lut;
+    }
+
+    /// Writes lut[v] to every pixel of intensity v in [lo, hi], in parallel over the index
+    size_t rewrite( int lo, int hi, const std::vector<uchar>& lut )
+    {
+        if( lo > hi )
+            return 0;
+        const int begin = (int)offsets_[lo], end = (int)offsets_[hi + 1];
+        const unsigned* pos = positions_.data();
+        const unsigned* offs = offsets_.data();
+        const uchar* table = lut.data();
+        uchar* d = dst_.ptr<uchar>();
+        CV_Assert( dst_.isContinuous() );
+
+        cv::parallel_for_( cv::Range( begin, end ), [&]( const cv::Range& r )
+        {
+            SAMPLES_TRACE_SCOPE( "incremental rewrite" );
+            // 找到 r.start 所在的灰度桶，之后顺序推进
+            int v = (int)(std::upper_bound( offs + lo, offs + hi + 2, (unsigned)r.start ) - offs) - 1;
+            for( int i = r.start; i < r.end; i++ )
+            {
+                while( (unsigned)i >= offs[v + 1] )
+                    v++;
+                d[pos[i]] = table[v];
+            }
+        }, (end - begin)/(1 << 16) + 1 );
+        return (size_t)(end - begin);
+    }
+
+    cv::Mat src_, dst_;
+    std::vector<unsigned> offsets_;
+    std::vector<unsigned> positions_;
+    int thresh_, maxval_, type_;
+    size_t updated_;
+};
+
+} // namespace samples
+
+#endif // SAMPLES_INCREMENTAL_THRESHOLD_HPP
@@ -0,0 +1,478 @@
+/**
+ * @file joint_morphology.hpp
+ * @brief Erosion and dilation in one pass, and stripe-fused opening, closing, gradient and top-hats
+ * @author OpenCV team
+ */
+
+/**
+ * 腐蚀、膨胀一次完成，以及在此基础上的开、闭运算、形态学梯度、顶帽、黑帽
+ * 形态学梯度 = 膨胀 - 腐蚀，两次独立的整帧运算把同一幅原图读两遍，两套滑动窗口的下标计算也各做一遍。
+ * 这里 van Herk/Gil-Werman 的每一步同时求最小值和最大值：
+ *  - 水平方向：每个输入像素只读一次，块内前缀/后缀的最小、最大值在同一个循环里递推
+ *  - 垂直方向：同一组行指针、同一个分块循环，一次 SIMD 循环同时写两个结果
+ * 开运算 = 先腐蚀再膨胀，闭运算相反，中间结果不写回整帧：图像按行切成 L2 大小的条带，
+ * 每个条带先算出第二步需要的中间行（条带加上下 halo），留在线程自己的缓冲里，再算出条带的最终结果。
+ * 一行带放不进 L2 时（宽图像、大结构元素）条带再按列切块；条带和块的大小至少是 halo 的几倍，重复计算有上限。
+ * 顶帽 = 原图 - 开运算，黑帽 = 闭运算 - 原图，减法也在条带内完成。
+ * 结果与 erode/dilate/morphologyEx 逐位一致；结构元素按 MorphologyPlan 分解成矩形。
+ */
+
+#ifndef SAMPLES_JOINT_MORPHOLOGY_HPP
+#define SAMPLES_JOINT_MORPHOLOGY_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "rect_morphology.hpp"
+#include "morphology_plan.hpp"
+#include "tiled_filter.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace samples {
+
+namespace morph_detail {
+
+/// A padded row of the erosion and of the dilation pass
+struct RowPair
+{
+    const uchar* lo;  ///< minimum
+    const uchar* hi;  ///< maximum
+};
+
+/// dlo[i] = min(alo[i], blo[i]) and dhi[i] = max(ahi[i], bhi[i]) in one loop
+static inline void combine2( const uchar* alo, const uchar* blo, uchar* dlo,
+                             const uchar* ahi, const uchar* bhi, uchar* dhi, int n )
+{
+    int i = 0;
+#if CV_SIMD
+    const int VECSZ = cv::VTraits<cv::v_uint8>::vlanes();
+    for( ; i <= n - VECSZ; i += VECSZ )
+    {
+        cv::v_store( dlo + i, cv::v_min( cv::vx_load( alo + i ), cv::vx_load( blo + i ) ) );
+        cv::v_store( dhi + i, cv::v_max( cv::vx_load( ahi + i ), cv::vx_load( bhi + i ) ) );
+    }
+#endif
+    for( ; i < n; i++ )
+    {
+        dlo[i] = std::min( alo[i], blo[i] );
+        dhi[i] = std::max( ahi[i], bhi[i] );
+    }
+}
+
+/// d[i] = saturate(a[i] - b[i]) for n bytes, as subtract() in morphologyEx
+static inline void subtractRow( const uchar* a, const uchar* b, uchar* d, int n )
+{
+    int i = 0;
+#if CV_SIMD
+    const int VECSZ = cv::VTraits<cv::v_uint8>::vlanes();
+    for( ; i <= n - VECSZ; i += VECSZ )
+        cv::v_store( d + i, cv::v_sub( cv::vx_load( a + i ), cv::vx_load( b + i ) ) );
+#endif
+    for( ; i < n; i++ )
+        d[i] = (uchar)std::max( a[i] - b[i], 0 );
+}
+
+/**
+ * @brief lineH() for MinOp and MaxOp at once, each source pixel read once
+ * @param buf scratch of 2*lineHBufSize() bytes
+ */
+static inline void lineH2( const uchar* src, uchar* dlo, uchar* dhi, int width, int cn, int k, int anchor, uchar* buf )
+{
+    const int L = padLeft( anchor ), W = L + width + padRight( k, anchor ), n = W*cn;
+    uchar* plo = buf;
+    uchar* phi = buf + n;
+    uchar* glo = buf + 2*n;
+    uchar* ghi = buf + 3*n;
+    uchar* hlo = buf + 4*n;
+    uchar* hhi = buf + 5*n;
+    // 两个填充行只有边界不同
+    std::fill( plo, plo + L*cn, MinOp::border() );
+    std::fill( phi, phi + L*cn, MaxOp::border() );
+    for( int e = 0; e < width*cn; e++ )
+        plo[L*cn + e] = phi[L*cn + e] = src[e];
+    std::fill( plo + (L + width)*cn, plo + n, MinOp::border() );
+    std::fill( phi + (L + width)*cn, phi + n, MaxOp::border() );
+
+    for( int x = 0; x < W; x += k )
+    {
+        const int b0 = x*cn, b1 = std::min( x + k, W )*cn;
+        for( int e = b0; e < b0 + cn; e++ )
+        {
+            glo[e] = plo[e];
+            ghi[e] = phi[e];
+        }
+        for( int e = b0 + cn; e < b1; e++ )
+        {
+            glo[e] = std::min( glo[e - cn], plo[e] );
+            ghi[e] = std::max( ghi[e - cn], phi[e] );
+        }
+        for( int e = b1 - cn; e < b1; e++ )
+        {
+            hlo[e] = plo[e];
+            hhi[e] = phi[e];
+        }
+        for( int e = b1 - cn - 1; e >= b0; e-- )
+        {
+            hlo[e] = std::min( hlo[e + cn], plo[e] );
+            hhi[e] = std::max( hhi[e + cn], phi[e] );
+        }
+    }
+    const int s0 = (L - anchor)*cn, s1 = s0 + (k - 1)*cn;
+    combine2( hlo + s0, glo + s1, dlo, hhi + s0, ghi + s1, dhi, width*cn );
+}
+
+/**
+ * @brief lineV() for MinOp and MaxOp at once over the same blocks
+ * rows(i) returns the RowPair of padded row i.
+ * @param buf scratch of 2*(k + 1)*len bytes
+ */
+template<class Rows>
+static void lineV2( Rows rows, const cv::Range& out, uchar* const* dlo, uchar* const* dhi, int len, int k, uchar* buf )
+{
+    uchar* Glo = buf;
+    uchar* Ghi = buf + len;
+    uchar* Hlo = buf + 2*len;
+    uchar* Hhi = Hlo + (size_t)k*len;
+    for( int b = out.start; b < out.end; b += k )
+    {
+        RowPair last = rows( b + k - 1 );
+        std::copy( last.lo, last.lo + len, Hlo + (size_t)(k - 1)*len );
+        std::copy( last.hi, last.hi + len, Hhi + (size_t)(k - 1)*len );
+        for( int j = k - 2; j >= 0; j-- )
+        {
+            RowPair p = rows( b + j );
+            combine2( Hlo + (size_t)(j + 1)*len, p.lo, Hlo + (size_t)j*len,
+                      Hhi + (size_t)(j + 1)*len, p.hi, Hhi + (size_t)j*len, len );
+        }
+
+        const int jn = std::min( k, out.end - b );
+        std::copy( Hlo, Hlo + len, dlo[b - out.start] );
+        std::copy( Hhi, Hhi + len, dhi[b - out.start] );
+        for( int j = 1; j < jn; j++ )
+        {
+            RowPair p = rows( b + k + j - 1 );
+            if( j == 1 )
+            {
+                std::copy( p.lo, p.lo + len, Glo );
+                std::copy( p.hi, p.hi + len, Ghi );
+            }
+            else
+                combine2( Glo, p.lo, Glo, Ghi, p.hi, Ghi, len );
+            combine2( Hlo + (size_t)j*len, Glo, dlo[b + j - out.start],
+                      Hhi + (size_t)j*len, Ghi, dhi[b + j - out.start], len );
+        }
+    }
+}
+
+/// rectStripe() for MinOp into dlo and MaxOp into dhi at once
+template<class In>
+static void rectStripe2( In in, int width, int height, int cn, cv::Size ksize, cv::Point anchor,
+                         const cv::Range& r, uchar* const* dlo, uchar* const* dhi )
+{
+    const int len = width*cn, kw = ksize.width, kh = ksize.height;
+    const int y0 = std::min( std::max( r.start - anchor.y, 0 ), height );
+    const int y1 = std::max( std::min( r.end + kh - 1 - anchor.y, height ), y0 );
+    const bool horizontal = kw > 1 || anchor.x != 0;
+    const size_t rowsBytes = (size_t)(horizontal && kh > 1 ? y1 - y0 : 0)*len;
+    std::vector<uchar> buf( 2*len + 2*rowsBytes +
+                            std::max( 2*lineHBufSize( width, cn, kw, anchor.x ), (size_t)2*(kh + 1)*len ) );
+    uchar* borderLo = &buf[0];
+    uchar* borderHi = borderLo + len;
+    uchar* horizLo = borderHi + len;
+    uchar* horizHi = horizLo + rowsBytes;
+    uchar* scratch = horizHi + rowsBytes;
+    std::fill( borderLo, borderLo + len, MinOp::border() );
+    std::fill( borderHi, borderHi + len, MaxOp::border() );
+
+    if( kh == 1 )
+    {
+        for( int y = r.start; y < r.end; y++ )
+        {
+            int iy = y - anchor.y;
+            uchar* lo = dlo[y - r.start];
+            uchar* hi = dhi[y - r.start];
+            if( iy < 0 || iy >= height )
+            {
+                std::fill( lo, lo + len, MinOp::border() );
+                std::fill( hi, hi + len, MaxOp::border() );
+            }
+            else if( horizontal )
+                lineH2( in(iy), lo, hi, width, cn, kw, anchor.x, scratch );
+            else
+            {
+                std::copy( in(iy), in(iy) + len, lo );
+                std::copy( in(iy), in(iy) + len, hi );
+            }
+        }
+        return;
+    }
+
+    if( horizontal )
+        for( int y = y0; y < y1; y++ )
+            lineH2( in(y), horizLo + (size_t)(y - y0)*len, horizHi + (size_t)(y - y0)*len,
+                    width, cn, kw, anchor.x, scratch );
+
+    // 不需要水平计算时两个结果的输入是同一行
+    auto rows = [&]( int i ) -> RowPair
+    {
+        int y = i - anchor.y;
+        RowPair p;
+        if( y < y0 || y >= y1 )
+        {
+            p.lo = borderLo;
+            p.hi = borderHi;
+        }
+        else if( horizontal )
+        {
+            p.lo = horizLo + (size_t)(y - y0)*len;
+            p.hi = horizHi + (size_t)(y - y0)*len;
+        }
+        else
+            p.lo = p.hi = in(y);
+        return p;
+    };
+    lineV2( rows, r, dlo, dhi, len, kh, scratch );
+}
+
+/// Output rows r of Op by the whole plan: the first piece writes dst, the others are combined in
+template<class Op, class In>
+static void planStripe( In in, int width, int height, int cn, const MorphologyPlan& plan,
+                        const cv::Range& r, uchar* const* dst )
+{
+    const std::vector<MorphologyPlan::Piece>& pieces = plan.pieces();
+    const int len = width*cn;
+    rectStripe<Op>( in, width, height, cn, pieces[0].rect.size(), pieces[0].anchor, r, dst );
+    if( pieces.size() == 1 )
+        return;
+
+    std::vector<uchar> buf( (size_t)r.size()*len );
+    std::vector<uchar*> tmp( r.size() );
+    for( int i = 0; i < r.size(); i++ )
+        tmp[i] = &buf[0] + (size_t)i*len;
+    for( size_t p = 1; p < pieces.size(); p++ )
+    {
+        rectStripe<Op>( in, width, height, cn, pieces[p].rect.size(), pieces[p].anchor, r, &tmp[0] );
+        for( int i = 0; i < r.size(); i++ )
+            combine<Op>( dst[i], tmp[i], dst[i], len );
+    }
+}
+
+/// planStripe() for erosion into dlo and dilation into dhi at once
+template<class In>
+static void planStripe2( In in, int width, int height, int cn, const MorphologyPlan& plan,
+                         const cv::Range& r, uchar* const* dlo, uchar* const* dhi )
+{
+    const std::vector<MorphologyPlan::Piece>& pieces = plan.pieces();
+    const int len = width*cn;
+    rectStripe2( in, width, height, cn, pieces[0].rect.size(), pieces[0].anchor, r, dlo, dhi );
+    if( pieces.size() == 1 )
+        return;
+
+    std::vector<uchar> buf( (size_t)2*r.size()*len );
+    std::vector<uchar*> tlo( r.size() ), thi( r.size() );
+    for( int i = 0; i < r.size(); i++ )
+    {
+        tlo[i] = &buf[0] + (size_t)(2*i)*len;
+        thi[i] = tlo[i] + len;
+    }
+    for( size_t p = 1; p < pieces.size(); p++ )
+    {
+        rectStripe2( in, width, height, cn, pieces[p].rect.size(), pieces[p].anchor, r, &tlo[0], &thi[0] );
+        for( int i = 0; i < r.size(); i++ )
+            combine2( dlo[i], tlo[i], dlo[i], dhi[i], thi[i], dhi[i], len );
+    }
+}
+
+/**
+ * @brief Output tile of the stripe-fused sequence: rows per stripe and columns per tile
+ * A stripe spans the whole width when its src, its intermediate rows with halo and dst fit into cacheBytes.
+ * Otherwise the stripe is also cut into column tiles. Stripes are at least 4x the vertical halo and tiles
+ * at least 8x the horizontal halo, so the first pass recomputes at most about a quarter more per axis;
+ * for large elements the budget is exceeded rather than the overhead.
+ */
+static inline cv::Size stripeTile( const cv::Mat& src, const Halo& halo, size_t cacheBytes = 256*1024 )
+{
+    const int cn = src.channels(), hx = halo.left + halo.right, hy = halo.top + halo.bottom;
+    const int minRows = std::max( 4*hy, 16 );
+    const int rows = (int)(cacheBytes/(3*(size_t)src.cols*cn)) - hy;
+    if( rows >= minRows )
+        return cv::Size( src.cols, rows );
+
+    // 整行放不下：按列切块。第一步要多算两侧各 2 倍 halo 的列（第二步的 halo 加上它自己的 halo）
+    int cols = (int)(cacheBytes/(3*(size_t)cn*(minRows + hy))) - 2*hx;
+    cols = std::max( cols, std::max( 8*hx, 16 ) );
+    return cv::Size( std::min( cols, src.cols ), minRows );
+}
+
+/**
+ * @brief First then Second by the same plan, one tile at a time
+ * The part of First that a tile of Second reads stays in a per-thread buffer; when subtract is
+ * set, dst = src - result (top-hat) or result - src (black-hat) in the same tile.
+ * A column tile runs First on its columns plus twice the horizontal halo: the border padding at
+ * an inner edge is wrong, but only within the halo that Second does not write back.
+ */
+template<class First, class Second>
+static void sequenceStripes( const cv::Mat& in, cv::Mat& out, const MorphologyPlan& plan, int subtract )
+{
+    const int width = in.cols, height = in.rows, cn = in.channels();
+    const cv::Point a = plan.anchor();
+    const Halo halo = Halo::fromKernel( plan.element().size(), a );
+    const cv::Size tile = stripeTile( in, halo );
+    const int step = tile.height, stripes = (height + step - 1)/step;
+    const int tiles = (width + tile.width - 1)/tile.width;
+    const bool wholeRows = tiles == 1;
+
+    cv::parallel_for_( cv::Range( 0, stripes*tiles ), [&]( const cv::Range& range )
+    {
+        SAMPLES_TRACE_SCOPE( "joint morphology stripe" );
+        std::vector<uchar> mid, res;
+        std::vector<uchar*> midRows, dstRows;
+        for( int t = range.start; t < range.end; t++ )
+        {
+            const int s = t/tiles, c = t % tiles;
+            const cv::Range r( s*step, std::min( (s + 1)*step, height ) );
+            const int x0 = c*tile.width, x1 = std::min( x0 + tile.width, width );
+            // Second 的输出行 r 读 First 的 [r.start - top, r.end + bottom)，只保留图像内的部分
+            const cv::Range m( std::max( r.start - halo.top, 0 ), std::min( r.end + halo.bottom, height ) );
+            const int f0 = wholeRows ? 0 : std::max( x0 - 2*halo.left, 0 );
+            const int f1 = wholeRows ? width : std::min( x1 + 2*halo.right, width );
+            const int fw = f1 - f0, flen = fw*cn;
+
+            mid.resize( (size_t)m.size()*flen );
+            midRows.resize( m.size() );
+            for( int i = 0; i < m.size(); i++ )
+                midRows[i] = &mid[0] + (size_t)i*flen;
+            planStripe<First>( [&]( int y ) { return in.ptr<uchar>(y) + f0*cn; },
+                               fw, height, cn, plan, m, &midRows[0] );
+
+            // 整行的条带直接写 dst，列块先写进缓冲，只把块内的列复制回去
+            dstRows.resize( r.size() );
+            if( !wholeRows )
+                res.resize( (size_t)r.size()*flen );
+            for( int y = r.start; y < r.end; y++ )
+                dstRows[y - r.start] = wholeRows ? out.ptr<uchar>(y) : &res[0] + (size_t)(y - r.start)*flen;
+            planStripe<Second>( [&]( int y ) { return midRows[y - m.start]; },
+                                fw, height, cn, plan, r, &dstRows[0] );
+
+            const int len = (x1 - x0)*cn;
+            for( int y = r.start; y < r.end; y++ )
+            {
+                uchar* d = out.ptr<uchar>(y) + x0*cn;
+                if( !wholeRows )
+                    std::copy( dstRows[y - r.start] + (x0 - f0)*cn, dstRows[y - r.start] + (x0 - f0)*cn + len, d );
+                if( subtract > 0 )
+                    subtractRow( in.ptr<uchar>(y) + x0*cn, d, d, len );
+                else if( subtract < 0 )
+                    subtractRow( d, in.ptr<uchar>(y) + x0*cn, d, len );
+            }
+        }
+    }, (double)(stripes*tiles) );
+}
+
+} // namespace morph_detail
+
+/**
+ * @brief erode() and dilate() by plan.element() in one pass over src
+ * ero and dil must not share data with src.
+ */
+static inline void erodeDilate( const cv::Mat& src, cv::Mat& ero, cv::Mat& dil, const MorphologyPlan& plan )
+{
+    if( plan.dense() || src.depth() != CV_8U )
+    {
+        cv::erode( src, ero, plan.element(), plan.anchor() );
+        cv::dilate( src, dil, plan.element(), plan.anchor() );
+        return;
+    }
+    CV_Assert( src.data != ero.data && src.data != dil.data );
+    ero.create( src.size(), src.type() );
+    dil.create( src.size(), src.type() );
+    cv::Mat lo = ero, hi = dil;
+
+    cv::parallel_for_( cv::Range( 0, src.rows ), [&]( const cv::Range& r )
+    {
+        SAMPLES_TRACE_SCOPE( "erodeDilate rows" );
+        std::vector<uchar*> dlo( r.size() ), dhi( r.size() );
+        for( int y = r.start; y < r.end; y++ )
+        {
+            dlo[y - r.start] = lo.ptr<uchar>(y);
+            dhi[y - r.start] = hi.ptr<uchar>(y);
+        }
+        morph_detail::planStripe2( [&]( int y ) { return src.ptr<uchar>(y); }, src.cols, src.rows, src.channels(),
+                                   plan, r, &dlo[0], &dhi[0] );
+    } );
+}
+
+/**
+ * @brief Same result as morphologyEx(src, dst, op, plan.element(), plan.anchor())
+ * @param op MORPH_ERODE, MORPH_DILATE, MORPH_OPEN, MORPH_CLOSE, MORPH_GRADIENT, MORPH_TOPHAT or MORPH_BLACKHAT
+ * Gradient uses the joint pass; opening, closing and the top-hats keep their intermediate rows per stripe.
+ */
+static inline void morphologyEx( const cv::Mat& src, cv::Mat& dst, int op, const MorphologyPlan& plan )
+{
+    if( plan.dense() || src.depth() != CV_8U || op < cv::MORPH_ERODE || op > cv::MORPH_BLACKHAT )
+    {
+        cv::morphologyEx( src, dst, op, plan.element(), plan.anchor() );
+        return;
+    }
+    cv::Mat in = src.data == dst.data ? src.clone() : src;
+    dst.create( src.size(), src.type() );
+    cv::Mat out = dst;
+    const int width = in.cols, height = in.rows, cn = in.channels(), len = width*cn;
+    auto rowsOf = [&]( int y ) { return in.ptr<uchar>(y); };
+
+    switch( op )
+    {
+    case cv::MORPH_ERODE:
+    case cv::MORPH_DILATE:
+        cv::parallel_for_( cv::Range( 0, height ), [&]( const cv::Range& r )
+        {
+            SAMPLES_TRACE_SCOPE( "joint erode/dilate rows" );
+            std::vector<uchar*> d( r.size() );
+            for( int y = r.start; y < r.end; y++ )
+                d[y - r.start] = out.ptr<uchar>(y);
+            if( op == cv::MORPH_ERODE )
+                morph_detail::planStripe<morph_detail::MinOp>( rowsOf, width, height, cn, plan, r, &d[0] );
+            else
+                morph_detail::planStripe<morph_detail::MaxOp>( rowsOf, width, height, cn, plan, r, &d[0] );
+        } );
+        break;
+    case cv::MORPH_GRADIENT:
+        // 膨胀写进 dst，腐蚀留在条带缓冲里，随后 dst -= 腐蚀
+        cv::parallel_for_( cv::Range( 0, height ), [&]( const cv::Range& r )
+        {
+            SAMPLES_TRACE_SCOPE( "joint gradient rows" );
+            std::vector<uchar> buf( (size_t)r.size()*len );
+            std::vector<uchar*> lo( r.size() ), hi( r.size() );
+            for( int y = r.start; y < r.end; y++ )
+            {
+                lo[y - r.start] = &buf[0] + (size_t)(y - r.start)*len;
+                hi[y - r.start] = out.ptr<uchar>(y);
+            }
+            morph_detail::planStripe2( rowsOf, width, height, cn, plan, r, &lo[0], &hi[0] );
+            for( int i = 0; i < r.size(); i++ )
+                morph_detail::subtractRow( hi[i], lo[i], hi[i], len );
+        } );
+        break;
+    case cv::MORPH_OPEN:
+        morph_detail::sequenceStripes<morph_detail::MinOp, morph_detail::MaxOp>( in, out, plan, 0 );
+        break;
+    case cv::MORPH_CLOSE:
+        morph_detail::sequenceStripes<morph_detail::MaxOp, morph_detail::MinOp>( in, out, plan, 0 );
+        break;
+    case cv::MORPH_TOPHAT:
+        morph_detail::sequenceStripes<morph_detail::MinOp, morph_detail::MaxOp>( in, out, plan, 1 );
+        break;
+    case cv::MORPH_BLACKHAT:
+        morph_detail::sequenceStripes<morph_detail::MaxOp, morph_detail::MinOp>( in, out, plan, -1 );
+        break;
+    }
+}
+
+} // namespace samples
+
+#endif // SAMPLES_JOINT_MORPHOLOGY_HPP
@@ -0,0 +1,286 @@
+/**
+ * @file latency_histogram.hpp
+ * @brief Per-stage latency histograms with lock-free per-thread recording
+ * @author OpenCV team
+ */
+
+/**
+ * 分阶段延迟统计
+ * 视频循环关心的是尾延迟（p99、最大值），平均值看不出偶发的卡顿。
+ * LatencyHistogram 是 HdrHistogram 风格的对数-线性直方图：每个 2 的幂区间再均分成 32 个子桶，
+ * 记录一次只是一个下标计算和一次计数，相对误差约 3%，从 1ns 到几百年都能表示。
+ * LatencyRecorder 为每个线程、每个阶段各建一个直方图，记录时不加锁、没有线程间共享的写；
+ * 只有线程第一次记录（注册）和汇总时才加锁。汇总时把所有线程的直方图相加，求分位数。
+ *
+ * 用法：
+ *   samples::LatencyRecorder latency( { "capture", "threshold", "display" } );
+ *   { samples::LatencyRecorder::Scope s( latency, 1 ); threshold(...); }
+ *   latency.report( cout );          //打印自上次 report 以来的 p50/p99/max
+ *   latency.exportTo( "lat.csv" );   //导出完整分布
+ */
+
+#ifndef SAMPLES_LATENCY_HISTOGRAM_HPP
+#define SAMPLES_LATENCY_HISTOGRAM_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace samples {
+
+/**
+ * @brief Log-linear histogram of nanosecond values with a single writer
+ *
+ * Values below 2*HALF get a bucket each; above that every power of two is split into HALF buckets,
+ * so a bucket is at most 1/HALF of its value wide. Counters are atomics written with relaxed
+ * load/store by the owning thread only, so any thread may read them while recording goes on.
+ */
+class LatencyHistogram
+{
+public:
+    enum { SUB_BITS = 6, HALF = 1 << (SUB_BITS - 1), BUCKETS = (64 - SUB_BITS + 2)*HALF };
+
+    LatencyHistogram()
+    {
+        for( int i = 0; i < BUCKETS; i++ )
+            counts_[i].store( 0 );
+        sum_.store( 0 );
+    }
+
+    /// Owning thread only
+    void record( unsigned long long ns )
+    {
+        std::atomic<unsigned long long>& c = counts_[bucketOf( ns )];
+        c.store( c.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+        sum_.store( sum_.load( std::memory_order_relaxed ) + ns, std::memory_order_relaxed );
+    }
+
+    unsigned long long count( int bucket ) const { return counts_[bucket].load( std::memory_order_relaxed ); }
+    unsigned long long sum() const { return sum_.load( std::memory_order_relaxed ); }
+
+    static int bucketOf( unsigned long long v )
+    {
+        if( v < 2*HALF )
+            return (int)v;
+        int msb = 63;
+        while( !(v >> msb) )
+            msb--;
+        int shift = msb - SUB_BITS + 1;
+        return shift*HALF + (int)(v >> shift);
+    }
+
+    /// Smallest value that falls into bucket
+    static unsigned long long lowestValue( int bucket )
+    {
+        if( bucket < 2*HALF )
+            return (unsigned long long)bucket;
+        int shift = bucket/HALF - 1;
+        return (unsigned long long)(bucket - shift*HALF) << shift;
+    }
+
+    /// Largest value that falls into bucket
+    static unsigned long long highestValue( int bucket )
+    {
+        return bucket + 1 < BUCKETS ? lowestValue( bucket + 1 ) - 1 : ~0ULL;
+    }
+
+private:
+    std::atomic<unsigned long long> counts_[BUCKETS];
+    std::atomic<unsigned long long> sum_;
+};
+
+/**
+ * @brief Plain copy of one or more histograms, for percentiles and interval deltas
+ */
+struct LatencySnapshot
+{
+    LatencySnapshot() : counts( LatencyHistogram::BUCKETS, 0 ), total(0), sumNs(0) {}
+
+    std::vector<unsigned long long> counts;
+    unsigned long long total;
+    double sumNs;
+
+    void add( const LatencyHistogram& h )
+    {
+        for( int i = 0; i < LatencyHistogram::BUCKETS; i++ )
+        {
+            unsigned long long c = h.count( i );
+            counts[i] += c;
+            total += c;
+        }
+        sumNs += (double)h.sum();
+    }
+
+    /// Values recorded after prev was taken
+    LatencySnapshot since( const LatencySnapshot& prev ) const
+    {
+        LatencySnapshot d;
+        for( int i = 0; i < LatencyHistogram::BUCKETS; i++ )
+        {
+            d.counts[i] = counts[i] - std::min( counts[i], prev.counts[i] );
+            d.total += d.counts[i];
+        }
+        d.sumNs = sumNs - prev.sumNs;
+        return d;
+    }
+
+    /// Value at or below which a fraction p of the samples lie, to bucket precision
+    double percentileMs( double p ) const
+    {
+        if( total == 0 )
+            return 0;
+        unsigned long long rank = (unsigned long long)std::ceil( p*total ), seen = 0;
+        rank = std::min( std::max( rank, 1ULL ), total );
+        for( int i = 0; i < LatencyHistogram::BUCKETS; i++ )
+            if( (seen += counts[i]) >= rank )
+                return LatencyHistogram::highestValue( i )*1e-6;
+        return 0;
+    }
+
+    double maxMs() const { return percentileMs( 1.0 ); }
+    double meanMs() const { return total > 0 ? sumNs/total*1e-6 : 0; }
+};
+
+/**
+ * @brief Named stages, each with one histogram per recording thread
+ */
+class LatencyRecorder
+{
+public:
+    explicit LatencyRecorder( const std::vector<cv::String>& stages )
+        : names_(stages), id_( nextId() ), last_( stages.size() ) {}
+
+    int stages() const { return (int)names_.size(); }
+    const cv::String& name( int stage ) const { return names_[stage]; }
+
+    /// Lock-free except for the first call from each thread
+    void record( int stage, unsigned long long ns ) { shard()[stage].record( ns ); }
+    void recordTicks( int stage, cv::int64 ticks )
+    {
+        record( stage, (unsigned long long)(std::max( ticks, (cv::int64)0 )*1e9/cv::getTickFrequency()) );
+    }
+
+    /// Records the lifetime of the scope into a stage
+    class Scope
+    {
+    public:
+        Scope( LatencyRecorder& recorder, int stage )
+            : recorder_(recorder), stage_(stage), start_( cv::getTickCount() ) {}
+        ~Scope() { recorder_.recordTicks( stage_, cv::getTickCount() - start_ ); }
+    private:
+        LatencyRecorder& recorder_;
+        int stage_;
+        cv::int64 start_;
+    };
+
+    /// Sum over all threads, one snapshot per stage
+    std::vector<LatencySnapshot> snapshot() const
+    {
+        std::vector<LatencySnapshot> s( names_.size() );
+        std::lock_guard<std::mutex> lock( mutex_ );
+        for( size_t t = 0; t < shards_.size(); t++ )
+            for( size_t i = 0; i < names_.size(); i++ )
+                s[i].add( shards_[t][i] );
+        return s;
+    }
+
+    /// Prints count, mean, p50, p99, p99.9 and max per stage
+    void print( std::ostream& out, const std::vector<LatencySnapshot>& s ) const
+    {
+        out << std::fixed << std::setprecision( 3 );
+        for( size_t i = 0; i < names_.size(); i++ )
+            out << "  " << std::setw( 10 ) << std::left << names_[i] << std::right
+                << " n=" << std::setw( 7 ) << s[i].total << "  mean " << s[i].meanMs()
+                << "  p50 " << s[i].percentileMs( 0.5 ) << "  p99 " << s[i].percentileMs( 0.99 )
+                << "  p99.9 " << s[i].percentileMs( 0.999 ) << "  max " << s[i].maxMs() << " ms" << std::endl;
+        out.unsetf( std::ios::floatfield );
+        out << std::setprecision( 6 );
+    }
+
+    /// Prints the samples recorded since the previous report() call
+    void report( std::ostream& out )
+    {
+        std::vector<LatencySnapshot> now = snapshot();
+        std::vector<LatencySnapshot> delta( now.size() );
+        for( size_t i = 0; i < now.size(); i++ )
+            delta[i] = now[i].since( last_[i] );
+        last_.swap( now );
+        print( out, delta );
+    }
+
+    /**
+     * @brief Writes the cumulative distribution of every stage as CSV
+     * One row per non-empty bucket: stage, bucket upper bound in ms, count, cumulative fraction.
+     */
+    bool exportTo( const cv::String& path ) const
+    {
+        std::ofstream f( path.c_str() );
+        if( !f )
+            return false;
+        std::vector<LatencySnapshot> s = snapshot();
+        f << "stage,value_ms,count,percentile" << std::endl;
+        for( size_t i = 0; i < s.size(); i++ )
+        {
+            unsigned long long seen = 0;
+            for( int b = 0; b < LatencyHistogram::BUCKETS; b++ )
+                if( s[i].counts[b] )
+                {
+                    seen += s[i].counts[b];
+                    f << names_[i] << "," << LatencyHistogram::highestValue( b )*1e-6 << ","
+                      << s[i].counts[b] << "," << (double)seen/s[i].total << std::endl;
+                }
+        }
+        return (bool)f;
+    }
+
+private:
+    static unsigned long long nextId()
+    {
+        static std::atomic<unsigned long long> id( 0 );
+        return ++id;
+    }
+
+    /// Histograms of the calling thread, registered on first use
+    LatencyHistogram* shard()
+    {
+        struct Cache { unsigned long long id; LatencyHistogram* shard; };
+        static thread_local Cache cache = { 0, 0 };
+        if( cache.id == id_ )
+            return cache.shard;
+
+        std::lock_guard<std::mutex> lock( mutex_ );
+        std::thread::id self = std::this_thread::get_id();
+        size_t t = 0;
+        while( t < owners_.size() && owners_[t] != self )
+            t++;
+        if( t == owners_.size() )
+        {
+            shards_.push_back( std::unique_ptr<LatencyHistogram[]>( new LatencyHistogram[names_.size()] ) );
+            owners_.push_back( self );
+        }
+        cache.id = id_;
+        cache.shard = shards_[t].get();
+        return cache.shard;
+    }
+
+    std::vector<cv::String> names_;
+    const unsigned long long id_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<LatencyHistogram[]> > shards_;
+    std::vector<std::thread::id> owners_;
+    std::vector<LatencySnapshot> last_;
+};
+
+} // namespace samples
+
+#endif // SAMPLES_LATENCY_HISTOGRAM_HPP
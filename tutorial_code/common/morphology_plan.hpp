@@ -0,0 +1,194 @@
+/**
+ * @file morphology_plan.hpp
+ * @brief Decomposes structuring elements into rectangles and caches the plans
+ * @author OpenCV team
+ */
+
+/**
+ * 结构元素分解与缓存
+ * 对 MORPH_CROSS、MORPH_ELLIPSE，erode/dilate 对结构元素中的每个点都要比较一次，
+ * Morphology_1.cpp 每次滑动条事件还要重新调用 getStructuringElement。
+ *
+ * 用集合的并来分解：结构元素 B = R1 ∪ R2 ∪ ... ∪ Rn 时，
+ *   erode(src, B) = min( erode(src, R1), ..., erode(src, Rn) )，dilate 同理取 max。
+ * 每个矩形 Ri 用 rect_morphology.hpp 中的 van Herk/Gil-Werman 线段运算，耗时与大小无关。
+ *  - 十字 = 一条水平线段 ∪ 一条垂直线段
+ *  - 椭圆 = 一组以中心对称、宽度递增高度递减的嵌套矩形
+ * 分解对任意结构元素都精确：每一行的每一段连续像素，向上向下扩展到不再完全包含它的行为止，得到一个矩形。
+ * 矩形太多、不如直接计算时退回 erode/dilate。
+ * 分解结果按 (形状, 大小, 锚点) 缓存，滑动条来回拖动时不再重复计算。
+ */
+
+#ifndef SAMPLES_MORPHOLOGY_PLAN_HPP
+#define SAMPLES_MORPHOLOGY_PLAN_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "rect_morphology.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace samples {
+
+/**
+ * @brief Erosion/dilation by an arbitrary element as a union of rectangles
+ */
+class MorphologyPlan
+{
+public:
+    /// A rectangle of the decomposition with the anchor of the whole element in its coordinates
+    struct Piece
+    {
+        cv::Rect rect;     ///< position inside the element
+        cv::Point anchor;  ///< element anchor relative to rect.tl(), may lie outside the rectangle
+    };
+
+    /// Decomposes element (CV_8U, nonzero = member); anchor (-1,-1) is the centre
+    explicit MorphologyPlan( const cv::Mat& element, cv::Point anchor = cv::Point(-1,-1) )
+        : element_( element.clone() ), anchor_(anchor)
+    {
+        CV_Assert( element_.type() == CV_8UC1 );
+        if( anchor_.x < 0 ) anchor_.x = element_.cols/2;
+        if( anchor_.y < 0 ) anchor_.y = element_.rows/2;
+        decompose();
+    }
+
+    /**
+     * @brief Cached plan for getStructuringElement(shape, ksize, anchor)
+     * Plans are never evicted; the returned reference stays valid for the life of the program.
+     */
+    static const MorphologyPlan& get( int shape, cv::Size ksize, cv::Point anchor = cv::Point(-1,-1) )
+    {
+        if( anchor.x < 0 ) anchor.x = ksize.width/2;
+        if( anchor.y < 0 ) anchor.y = ksize.height/2;
+        typedef std::tuple<int, int, int, int, int> Key;
+        static std::mutex mutex;
+        static std::map<Key, MorphologyPlan> cache;
+
+        Key key( shape, ksize.width, ksize.height, anchor.x, anchor.y );
+        std::lock_guard<std::mutex> lock( mutex );
+        std::map<Key, MorphologyPlan>::iterator it = cache.find( key );
+        if( it == cache.end() )
+            it = cache.insert( std::make_pair( key,
+                    MorphologyPlan( cv::getStructuringElement( shape, ksize, anchor ), anchor ) ) ).first;
+        return it->second;
+    }
+
+    const cv::Mat& element() const { return element_; }
+    cv::Point anchor() const { return anchor_; }
+    const std::vector<Piece>& pieces() const { return pieces_; }
+    /// True when the element is run by erode/dilate directly because the pieces would cost more
+    bool dense() const { return dense_; }
+
+    /// Same result as erode(src, dst, element(), anchor())
+    void erode( const cv::Mat& src, cv::Mat& dst ) const
+    {
+        if( dense_ || src.depth() != CV_8U )
+            cv::erode( src, dst, element_, anchor_ );
+        else
+            run<morph_detail::MinOp>( src, dst );
+    }
+
+    /// Same result as dilate(src, dst, element(), anchor())
+    void dilate( const cv::Mat& src, cv::Mat& dst ) const
+    {
+        if( dense_ || src.depth() != CV_8U )
+            cv::dilate( src, dst, element_, anchor_ );
+        else
+            run<morph_detail::MaxOp>( src, dst );
+    }
+
+private:
+    /// Row y contains every pixel of [x0, x1]
+    bool covers( int y, int x0, int x1 ) const
+    {
+        const uchar* e = element_.ptr<uchar>(y);
+        for( int x = x0; x <= x1; x++ )
+            if( !e[x] )
+                return false;
+        return true;
+    }
+
+    void decompose()
+    {
+        std::vector<cv::Rect> rects;
+        for( int y = 0; y < element_.rows; y++ )
+        {
+            const uchar* e = element_.ptr<uchar>(y);
+            for( int x0 = 0; x0 < element_.cols; )
+            {
+                if( !e[x0] ) { x0++; continue; }
+                int x1 = x0;
+                while( x1 + 1 < element_.cols && e[x1 + 1] )
+                    x1++;
+                // 把这一段向上、向下扩展到所有完全包含它的相邻行
+                int top = y, bottom = y;
+                while( top > 0 && covers( top - 1, x0, x1 ) )
+                    top--;
+                while( bottom + 1 < element_.rows && covers( bottom + 1, x0, x1 ) )
+                    bottom++;
+                cv::Rect r( x0, top, x1 - x0 + 1, bottom - top + 1 );
+                if( std::find( rects.begin(), rects.end(), r ) == rects.end() )
+                    rects.push_back( r );
+                x0 = x1 + 1;
+            }
+        }
+
+        // 去掉被其他矩形包含的矩形
+        pieces_.clear();
+        for( size_t i = 0; i < rects.size(); i++ )
+        {
+            bool inside = false;
+            for( size_t j = 0; j < rects.size() && !inside; j++ )
+                inside = j != i && (rects[i] & rects[j]) == rects[i];
+            if( !inside )
+            {
+                Piece p;
+                p.rect = rects[i];
+                p.anchor = anchor_ - rects[i].tl();
+                pieces_.push_back( p );
+            }
+        }
+
+        // 每个矩形约 8 次比较（两次线段 + 合并），erode/dilate 每个结构元素点一次
+        dense_ = pieces_.empty() || 8*pieces_.size() >= (size_t)cv::countNonZero( element_ );
+    }
+
+    template<class Op>
+    void run( const cv::Mat& src, cv::Mat& dst ) const
+    {
+        cv::Mat in = src.data == dst.data ? src.clone() : src;  //后面的矩形还要读原图
+        morph_detail::rectMorph<Op>( in, dst, pieces_[0].rect.size(), pieces_[0].anchor );
+        if( pieces_.size() == 1 )
+            return;
+
+        cv::Mat piece, out = dst;
+        const int len = src.cols*src.channels();
+        for( size_t i = 1; i < pieces_.size(); i++ )
+        {
+            morph_detail::rectMorph<Op>( in, piece, pieces_[i].rect.size(), pieces_[i].anchor );
+            cv::parallel_for_( cv::Range( 0, src.rows ), [&]( const cv::Range& r )
+            {
+                SAMPLES_TRACE_SCOPE( "plan combine rows" );
+                for( int y = r.start; y < r.end; y++ )
+                    morph_detail::combine<Op>( out.ptr<uchar>(y), piece.ptr<uchar>(y), out.ptr<uchar>(y), len );
+            } );
+        }
+    }
+
+    cv::Mat element_;
+    cv::Point anchor_;
+    std::vector<Piece> pieces_;
+    bool dense_;
+};
+
+} // namespace samples
+
+#endif // SAMPLES_MORPHOLOGY_PLAN_HPP
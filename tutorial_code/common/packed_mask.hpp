@@ -0,0 +1,372 @@
+/**
+ * @file packed_mask.hpp
+ * @brief Binary mask stored at 1 bit per pixel, written directly by threshold/inRange
+ * @author OpenCV team
+ */
+
+/**
+ * 位压缩的二值掩码
+ * threshold 和 inRange 输出的 CV_8U 掩码每个像素占 1 字节，但只有 1 位信息。
+ * PackedMask 每行用若干 64 位字保存，第 x 个像素是第 x/64 个字的第 x%64 位（低位在左）。
+ * 行尾多余的位始终为 0，面积可以直接按字 popcount。
+ * 另外提供按行展开的游程编码(RLE)：从 0 的游程开始，0/1 交替记录长度，用于存储和传输。
+ */
+
+#ifndef SAMPLES_PACKED_MASK_HPP
+#define SAMPLES_PACKED_MASK_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+#include "opencv2/imgproc.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <vector>
+#if defined _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace samples {
+
+/// @name Bit scan helpers
+/// @{
+static inline int popcount64( cv::uint64 w )
+{
+#if defined _MSC_VER && defined _M_X64
+    return (int)__popcnt64( w );
+#elif defined __GNUC__
+    return __builtin_popcountll( w );
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ULL);
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    return (int)((((w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL)*0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/// Index of the lowest set bit, w != 0
+static inline int lowestBit64( cv::uint64 w )
+{
+#if defined _MSC_VER && defined _M_X64
+    unsigned long i; _BitScanForward64( &i, w ); return (int)i;
+#elif defined __GNUC__
+    return __builtin_ctzll( w );
+#else
+    int i = 0; while( !(w & 1) ) { w >>= 1; i++; } return i;
+#endif
+}
+
+/// Index of the highest set bit, w != 0
+static inline int highestBit64( cv::uint64 w )
+{
+#if defined _MSC_VER && defined _M_X64
+    unsigned long i; _BitScanReverse64( &i, w ); return (int)i;
+#elif defined __GNUC__
+    return 63 - __builtin_clzll( w );
+#else
+    int i = 63; while( !(w >> 63) ) { w <<= 1; i--; } return i;
+#endif
+}
+/// @}
+
+/**
+ * @brief 1-bit-per-pixel binary mask
+ */
+class PackedMask
+{
+public:
+    PackedMask() : rows(0), cols(0), wordsPerRow(0) {}
+    explicit PackedMask( cv::Size size ) : rows(0), cols(0), wordsPerRow(0) { create( size ); }
+
+    /// Allocates a cleared mask, reusing the storage when it is large enough
+    void create( cv::Size size )
+    {
+        rows = size.height; cols = size.width;
+        wordsPerRow = (cols + 63)/64;
+        bits_.assign( (size_t)rows*wordsPerRow, 0 );
+    }
+
+    cv::Size size() const { return cv::Size( cols, rows ); }
+    bool empty() const { return rows == 0 || cols == 0; }
+    size_t bytes() const { return bits_.size()*sizeof(cv::uint64); }
+
+    cv::uint64* row( int y ) { return &bits_[(size_t)y*wordsPerRow]; }
+    const cv::uint64* row( int y ) const { return &bits_[(size_t)y*wordsPerRow]; }
+
+    bool get( int y, int x ) const { return ((row(y)[x >> 6] >> (x & 63)) & 1) != 0; }
+    void set( int y, int x, bool v )
+    {
+        cv::uint64 bit = (cv::uint64)1 << (x & 63);
+        if( v ) row(y)[x >> 6] |= bit; else row(y)[x >> 6] &= ~bit;
+    }
+
+    /// Clears the unused bits at the end of every row; call after writing whole words
+    void clearPadding()
+    {
+        if( cols & 63 )
+        {
+            cv::uint64 keep = ((cv::uint64)1 << (cols & 63)) - 1;
+            for( int y = 0; y < rows; y++ )
+                row(y)[wordsPerRow - 1] &= keep;
+        }
+    }
+
+    /// Number of set pixels, same as countNonZero on the byte mask
+    size_t area() const
+    {
+        size_t n = 0;
+        for( size_t i = 0; i < bits_.size(); i++ )
+            n += popcount64( bits_[i] );
+        return n;
+    }
+
+    /// Bounding box of the set pixels, same as boundingRect on the byte mask
+    cv::Rect boundingRect() const
+    {
+        int x0 = cols, x1 = -1, y0 = rows, y1 = -1;
+        for( int y = 0; y < rows; y++ )
+        {
+            const cv::uint64* p = row(y);
+            int first = findBit( p, 0, true );
+            if( first >= cols )
+                continue;
+            int last = wordsPerRow - 1;
+            while( !p[last] ) last--;
+            y0 = std::min( y0, y ); y1 = y;
+            x0 = std::min( x0, first );
+            x1 = std::max( x1, last*64 + highestBit64( p[last] ) );
+        }
+        return y1 < 0 ? cv::Rect() : cv::Rect( x0, y0, x1 - x0 + 1, y1 - y0 + 1 );
+    }
+
+    /// First x >= from whose bit equals value, or cols
+    int findBit( const cv::uint64* p, int from, bool value ) const
+    {
+        if( from >= cols )
+            return cols;
+        int wi = from >> 6;
+        cv::uint64 w = (value ? p[wi] : ~p[wi]) & (~(cv::uint64)0 << (from & 63));
+        for( ;; )
+        {
+            if( w )
+                return std::min( cols, wi*64 + lowestBit64( w ) );
+            if( ++wi >= wordsPerRow )
+                return cols;
+            w = value ? p[wi] : ~p[wi];
+        }
+    }
+
+    /// Expands to a CV_8UC1 mask holding 0 and value
+    void toMat( cv::Mat& dst, uchar value = 255 ) const
+    {
+        dst.create( rows, cols, CV_8UC1 );
+        for( int y = 0; y < rows; y++ )
+        {
+            const cv::uint64* p = row(y);
+            uchar* d = dst.ptr<uchar>(y);
+            for( int x = 0; x < cols; x++ )
+                d[x] = ((p[x >> 6] >> (x & 63)) & 1) ? value : 0;
+        }
+    }
+
+    /// Packs a CV_8UC1 mask, non-zero pixels become 1
+    void fromMat( const cv::Mat& mask )
+    {
+        CV_Assert( mask.type() == CV_8UC1 );
+        create( mask.size() );
+        for( int y = 0; y < rows; y++ )
+        {
+            const uchar* m = mask.ptr<uchar>(y);
+            cv::uint64* p = row(y);
+            for( int x = 0; x < cols; x++ )
+                if( m[x] )
+                    p[x >> 6] |= (cv::uint64)1 << (x & 63);
+        }
+    }
+
+    /**
+     * @brief Run-length encoding of the mask read row by row
+     * Runs alternate between 0 and 1 starting with a (possibly empty) run of 0; they continue across rows.
+     * 逐行展开后交替记录 0、1 的游程长度，第一个是 0 的游程（可以为 0）。
+     */
+    std::vector<unsigned> encodeRLE() const
+    {
+        std::vector<unsigned> runs;
+        bool cur = false;
+        unsigned len = 0;
+        for( int y = 0; y < rows; y++ )
+        {
+            const cv::uint64* p = row(y);
+            for( int x = 0; x < cols; )
+            {
+                int next = findBit( p, x, !cur );
+                len += next - x;
+                x = next;
+                if( x < cols )
+                {
+                    runs.push_back( len );
+                    len = 0;
+                    cur = !cur;
+                }
+            }
+        }
+        runs.push_back( len );
+        return runs;
+    }
+
+    /// Inverse of encodeRLE()
+    void decodeRLE( cv::Size size, const std::vector<unsigned>& runs )
+    {
+        create( size );
+        size_t pos = 0, total = (size_t)rows*cols;
+        for( size_t i = 0; i < runs.size(); i++ )
+        {
+            size_t end = std::min( pos + runs[i], total );
+            if( i & 1 )
+                for( size_t k = pos; k < end; k++ )
+                    set( (int)(k/cols), (int)(k%cols), true );
+            pos = end;
+        }
+    }
+
+    int rows, cols;
+    int wordsPerRow;
+
+private:
+    std::vector<cv::uint64> bits_;
+};
+
+namespace packed_detail {
+
+/**
+ * @brief Packs the lanes of 64 consecutive compare results into one word
+ * pred(x) returns a v_uint8 lane mask for the pixels starting at x; scalar(x) a bool for one pixel.
+ */
+template<typename VecPred, typename ScalarPred>
+static void packRow( cv::uint64* dst, int width, VecPred pred, ScalarPred scalar )
+{
+    int x = 0;
+#if CV_SIMD
+    const int VECSZ = cv::VTraits<cv::v_uint8>::vlanes();
+    const cv::uint64 laneMask = VECSZ >= 64 ? ~(cv::uint64)0 : (((cv::uint64)1 << VECSZ) - 1);
+    for( ; x <= width - 64; x += 64 )
+    {
+        cv::uint64 w = 0;
+        for( int k = 0; k < 64; k += VECSZ )
+            w |= ((cv::uint64)(cv::int64)cv::v_signmask( pred( x + k ) ) & laneMask) << k;
+        dst[x >> 6] = w;
+    }
+#else
+    (void)pred;
+#endif
+    for( ; x < width; x += 64 )
+    {
+        cv::uint64 w = 0;
+        for( int k = 0, n = std::min( 64, width - x ); k < n; k++ )
+            w |= (cv::uint64)scalar( x + k ) << k;
+        dst[x >> 6] = w;
+    }
+}
+
+} // namespace packed_detail
+
+/**
+ * @brief threshold(src, dst, thresh, 1, THRESH_BINARY or THRESH_BINARY_INV) written straight into a PackedMask
+ * @param src CV_8UC1 image
+ */
+static inline void thresholdPacked( const cv::Mat& src, PackedMask& dst, double thresh, int type = cv::THRESH_BINARY )
+{
+    CV_Assert( src.type() == CV_8UC1 && (type == cv::THRESH_BINARY || type == cv::THRESH_BINARY_INV) );
+    dst.create( src.size() );
+    const int t = std::min( std::max( cvFloor(thresh), -1 ), 255 );
+    const bool inv = type == cv::THRESH_BINARY_INV;
+
+    cv::parallel_for_( cv::Range( 0, src.rows ), [&]( const cv::Range& r )
+    {
+        SAMPLES_TRACE_SCOPE( "thresholdPacked rows" );
+        for( int y = r.start; y < r.end; y++ )
+        {
+            const uchar* s = src.ptr<uchar>(y);
+            cv::uint64* d = dst.row(y);
+            if( t < 0 || t >= 255 )
+            {
+                // 全部为 1 或全部为 0
+                bool all = (t < 0) != inv;
+                std::fill( d, d + dst.wordsPerRow, all ? ~(cv::uint64)0 : 0 );
+                continue;
+            }
+#if CV_SIMD
+            const cv::v_uint8 vt = cv::vx_setall_u8( (uchar)t );
+            auto vpred = [&]( int x ) -> cv::v_uint8 {
+                cv::v_uint8 m = cv::v_gt( cv::vx_load( s + x ), vt );
+                return inv ? cv::v_not( m ) : m;
+            };
+#else
+            auto vpred = []( int ) { return 0; };
+#endif
+            packed_detail::packRow( d, src.cols, vpred, [&]( int x ) { return (s[x] > t) != inv; } );
+        }
+    } );
+    dst.clearPadding();
+}
+
+/**
+ * @brief inRange(src, lowerb, upperb, dst) written straight into a PackedMask
+ * @param src CV_8UC1 or CV_8UC3 image
+ */
+static inline void inRangePacked( const cv::Mat& src, const cv::Scalar& lowerb, const cv::Scalar& upperb, PackedMask& dst )
+{
+    CV_Assert( src.depth() == CV_8U && (src.channels() == 1 || src.channels() == 3) );
+    dst.create( src.size() );
+    const int cn = src.channels();
+
+    // 边界与 inRange 一样用 cvRound 取整，再限制在 [0,255]；有通道区间为空时结果全为 0
+    int lo[3], hi[3];
+    for( int c = 0; c < cn; c++ )
+    {
+        lo[c] = std::max( cvRound( lowerb[c] ), 0 );
+        hi[c] = std::min( cvRound( upperb[c] ), 255 );
+        if( lo[c] > hi[c] )
+            return;
+    }
+
+    cv::parallel_for_( cv::Range( 0, src.rows ), [&]( const cv::Range& r )
+    {
+        SAMPLES_TRACE_SCOPE( "inRangePacked rows" );
+        for( int y = r.start; y < r.end; y++ )
+        {
+            const uchar* s = src.ptr<uchar>(y);
+            cv::uint64* d = dst.row(y);
+#if CV_SIMD
+            using namespace cv;
+            const v_uint8 l0 = vx_setall_u8( (uchar)lo[0] ), h0 = vx_setall_u8( (uchar)hi[0] );
+            const v_uint8 l1 = vx_setall_u8( (uchar)lo[cn > 1 ? 1 : 0] ), h1 = vx_setall_u8( (uchar)hi[cn > 1 ? 1 : 0] );
+            const v_uint8 l2 = vx_setall_u8( (uchar)lo[cn > 2 ? 2 : 0] ), h2 = vx_setall_u8( (uchar)hi[cn > 2 ? 2 : 0] );
+            auto vpred = [&]( int x ) -> v_uint8 {
+                if( cn == 1 )
+                {
+                    v_uint8 v = vx_load( s + x );
+                    return v_and( v_ge( v, l0 ), v_le( v, h0 ) );
+                }
+                v_uint8 b, g, rr;
+                v_load_deinterleave( s + x*3, b, g, rr );
+                return v_and( v_and( v_and( v_ge( b, l0 ), v_le( b, h0 ) ), v_and( v_ge( g, l1 ), v_le( g, h1 ) ) ),
+                              v_and( v_ge( rr, l2 ), v_le( rr, h2 ) ) );
+            };
+#else
+            auto vpred = []( int ) { return 0; };
+#endif
+            packed_detail::packRow( d, src.cols, vpred, [&]( int x ) -> bool {
+                const uchar* p = s + x*cn;
+                for( int c = 0; c < cn; c++ )
+                    if( p[c] < lo[c] || p[c] > hi[c] )
+                        return false;
+                return true;
+            } );
+        }
+    } );
+}
+
+} // namespace samples
+
+#endif // SAMPLES_PACKED_MASK_HPP
@@ -0,0 +1,229 @@
+/**
+ * @file point_ops.hpp
+ * @brief Chains of 8-bit point operations compiled into per-channel lookup tables
+ * @author OpenCV team
+ */
+
+/**
+ * 点运算的查找表编译
+ * 输出像素只取决于同一位置输入像素的运算叫点运算：对比度/亮度 alpha*x + beta、gamma 校正、
+ * how_to_scan_images.cpp 的颜色缩减 divideWith*(x/divideWith)、阈值。
+ * 8 位数据只有 256 种取值，任意一串点运算无论多长都等价于一张 256 项的表：
+ *  - 每个运算作用在表上而不是图像上：table[i] = op(table[i])，代价只有 256 次运算
+ *  - 每一步的结果都饱和成 8 位，与逐步处理整幅图的结果逐位一致
+ *  - 每个通道可以有自己的表，运算可以只作用于某一个通道
+ * 应用时整幅图只遍历一次，行按 parallel_for_ 分给多个线程；所有通道共用一张表时按字节查表，
+ * 各通道的表不同时把表交错成 table[v*cn + c]，一个像素的各通道连续查表。
+ * 输出写进调用者持有的 Mat，大小类型不变时不会重新分配。
+ */
+
+#ifndef SAMPLES_POINT_OPS_HPP
+#define SAMPLES_POINT_OPS_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace samples {
+
+/**
+ * @brief A chain of point operations on 8-bit data, kept as one 256-entry table per channel
+ *
+ * Operations are appended in the order they are applied; channel -1 applies to every channel.
+ * apply() runs the whole chain in one pass over the image.
+ */
+class PointOps
+{
+public:
+    /// Identity on channels channels
+    explicit PointOps( int channels = 1 ) : cn_( channels ), table_( 256*channels )
+    {
+        CV_Assert( channels >= 1 && channels <= 4 );
+        for( int v = 0; v < 256; v++ )
+            for( int c = 0; c < cn_; c++ )
+                table_[v*cn_ + c] = (uchar)v;
+    }
+
+    int channels() const { return cn_; }
+
+    /// x = saturate(alpha*x + beta), the contrast/brightness transform
+    PointOps& linear( double alpha, double beta, int channel = -1 )
+    {
+        for( int c = first( channel ); c <= last( channel ); c++ )
+            for( int v = 0; v < 256; v++ )
+            {
+                uchar& t = table_[v*cn_ + c];
+                t = cv::saturate_cast<uchar>( alpha*t + beta );
+            }
+        return *this;
+    }
+
+    /// x = saturate(255*(x/255)^gamma)
+    PointOps& gamma( double g, int channel = -1 )
+    {
+        CV_Assert( g > 0 );
+        uchar lut[256];
+        for( int v = 0; v < 256; v++ )
+            lut[v] = cv::saturate_cast<uchar>( std::pow( v/255.0, g )*255.0 );
+        return map( lut, channel );
+    }
+
+    /// x = divideWith*(x/divideWith), the color space reduction of how_to_scan_images.cpp
+    PointOps& reduce( int divideWith, int channel = -1 )
+    {
+        CV_Assert( divideWith > 0 );
+        uchar lut[256];
+        for( int v = 0; v < 256; v++ )
+            lut[v] = (uchar)(divideWith*(v/divideWith));
+        return map( lut, channel );
+    }
+
+    /// cv::threshold on 8-bit data: THRESH_BINARY, _INV, TRUNC, TOZERO or TOZERO_INV
+    PointOps& threshold( double thresh, double maxval, int type, int channel = -1 )
+    {
+        // threshold() compares 8-bit pixels against floor(thresh) and writes round(maxval)
+        const int t = cvFloor( thresh );
+        const uchar m = cv::saturate_cast<uchar>( cvRound( maxval ) );
+        uchar lut[256];
+        for( int v = 0; v < 256; v++ )
+        {
+            const bool above = v > t;
+            switch( type )
+            {
+            case cv::THRESH_BINARY:     lut[v] = above ? m : 0; break;
+            case cv::THRESH_BINARY_INV: lut[v] = above ? 0 : m; break;
+            case cv::THRESH_TRUNC:      lut[v] = above ? cv::saturate_cast<uchar>( t ) : (uchar)v; break;
+            case cv::THRESH_TOZERO:     lut[v] = above ? (uchar)v : 0; break;
+            case cv::THRESH_TOZERO_INV: lut[v] = above ? 0 : (uchar)v; break;
+            default: CV_Error( cv::Error::StsBadArg, "Unsupported threshold type" );
+            }
+        }
+        return map( lut, channel );
+    }
+
+    /// x = lut[x] for an arbitrary 256-entry table
+    PointOps& map( const uchar* lut, int channel = -1 )
+    {
+        for( int c = first( channel ); c <= last( channel ); c++ )
+            for( int v = 0; v < 256; v++ )
+            {
+                uchar& t = table_[v*cn_ + c];
+                t = lut[t];
+            }
+        return *this;
+    }
+
+    /// The chain as a 1x256 table for cv::LUT, CV_8UC1 when all channels agree
+    cv::Mat lut() const
+    {
+        if( uniform() )
+        {
+            cv::Mat t( 1, 256, CV_8U );
+            for( int v = 0; v < 256; v++ )
+                t.at<uchar>(v) = table_[v*cn_];
+            return t;
+        }
+        return cv::Mat( 1, 256, CV_8UC(cn_), (void*)&table_[0] ).clone();
+    }
+
+    /**
+     * @brief dst = chain(src) in one pass, rows in parallel
+     * src is 8-bit with channels() channels, or any number of channels when all tables agree.
+     * dst is reallocated only if its size or type differs; src == dst is allowed.
+     */
+    void apply( const cv::Mat& src, cv::Mat& dst ) const
+    {
+        CV_Assert( src.depth() == CV_8U );
+        const bool one = uniform();
+        CV_Assert( one || src.channels() == cn_ );
+        dst.create( src.size(), src.type() );
+
+        std::vector<uchar> single;
+        if( one )
+        {
+            single.resize( 256 );
+            for( int v = 0; v < 256; v++ )
+                single[v] = table_[v*cn_];
+        }
+        const uchar* tab = one ? &single[0] : &table_[0];
+        const int step = one ? 1 : cn_;
+
+        // Continuous images are processed as one long row split into stripes
+        const bool flat = src.isContinuous() && dst.isContinuous();
+        const int rows = flat ? 1 : src.rows;
+        const int len = (flat ? src.rows : 1)*src.cols*src.channels();
+        cv::Mat out = dst;
+        if( flat )
+        {
+            const int stripe = (1 << 14)*src.channels();  // whole pixels per stripe
+            const int n = (len + stripe - 1)/stripe;
+            cv::parallel_for_( cv::Range( 0, n ), [&]( const cv::Range& r )
+            {
+                SAMPLES_TRACE_SCOPE( "PointOps stripes" );
+                const int begin = r.start*stripe, end = std::min( r.end*stripe, len );
+                row( src.ptr<uchar>() + begin, out.ptr<uchar>() + begin, end - begin, tab, step );
+            } );
+            return;
+        }
+        cv::parallel_for_( cv::Range( 0, rows ), [&]( const cv::Range& r )
+        {
+            SAMPLES_TRACE_SCOPE( "PointOps rows" );
+            for( int y = r.start; y < r.end; y++ )
+                row( src.ptr<uchar>(y), out.ptr<uchar>(y), len, tab, step );
+        } );
+    }
+
+private:
+    int first( int channel ) const
+    {
+        CV_Assert( channel >= -1 && channel < cn_ );
+        return channel < 0 ? 0 : channel;
+    }
+    int last( int channel ) const { return channel < 0 ? cn_ - 1 : channel; }
+
+    /// All channels share one table
+    bool uniform() const
+    {
+        for( int v = 0; v < 256; v++ )
+            for( int c = 1; c < cn_; c++ )
+                if( table_[v*cn_ + c] != table_[v*cn_] )
+                    return false;
+        return true;
+    }
+
+    /// d[i] = tab[s[i]*cn + i%cn]; n is a multiple of cn and starts on a pixel boundary
+    static void row( const uchar* s, uchar* d, int n, const uchar* tab, int cn )
+    {
+        int i = 0;
+        if( cn == 1 )
+        {
+            for( ; i <= n - 4; i += 4 )
+            {
+                uchar t0 = tab[s[i]], t1 = tab[s[i+1]];
+                d[i] = t0; d[i+1] = t1;
+                t0 = tab[s[i+2]]; t1 = tab[s[i+3]];
+                d[i+2] = t0; d[i+3] = t1;
+            }
+            for( ; i < n; i++ )
+                d[i] = tab[s[i]];
+        }
+        else
+        {
+            for( ; i < n; i += cn )
+                for( int c = 0; c < cn; c++ )
+                    d[i + c] = tab[s[i + c]*cn + c];
+        }
+    }
+
+    int cn_;
+    std::vector<uchar> table_;  ///< table_[v*cn + c]: value v of channel c
+};
+
+} // namespace samples
+
+#endif // SAMPLES_POINT_OPS_HPP
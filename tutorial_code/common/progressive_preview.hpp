@@ -0,0 +1,228 @@
+/**
+ * @file progressive_preview.hpp
+ * @brief Progressive rendering for trackbar samples: an immediate downscaled preview, refined off the GUI thread
+ * @author OpenCV team
+ */
+
+/**
+ * 渐进式预览
+ * 滑动条回调在 GUI 线程上同步处理整幅全分辨率图像，图像很大（几千万像素）时拖动会明显卡顿。
+ * 渐进模式把一次处理分成两步：
+ *  - 预览：回调里立即在缩小的图像上处理（默认约 512x512 像素），结果保持缩小的尺寸，不在 GUI 线程上放大到原图大小，
+ *    显示窗口用 WINDOW_NORMAL 创建并设为原图大小，由窗口系统把预览和全分辨率结果都缩放到窗口大小，
+ *    回调的代价只取决于预览像素数，显示的代价取决于窗口大小，都与原图大小无关
+ *  - 精化：工作线程在滑动条停止变化 idleMs 毫秒后处理全分辨率图像，按行带（band）分块计算，
+ *    每算完一块检查是否已有更新的请求，有就放弃当前结果（取消过时的计算）
+ * GUI 线程从不等待：在 waitKey 循环里调用 poll()，全分辨率结果就绪时取走并显示。
+ *
+ * 处理函数 render(in, out, scale) 在两个线程上被调用：
+ *  - scale 是输入相对原图的比例，预览时小于 1，依赖尺寸的参数（如核大小）应乘以 scale
+ *  - 只能使用按值捕获的参数，不能读取 GUI 线程会修改的全局变量
+ *  - 需要邻域的运算通过 halo 给出每侧需要的行数（核半径），每个行带多读 halo 行，结果与整幅处理相同
+ */
+
+#ifndef SAMPLES_PROGRESSIVE_PREVIEW_HPP
+#define SAMPLES_PROGRESSIVE_PREVIEW_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace samples {
+
+/**
+ * @brief Renders a downscaled preview synchronously and the full-resolution result on a worker thread
+ *
+ * request() and poll() are called from the GUI thread only; neither waits for the worker.
+ */
+class ProgressivePreview
+{
+public:
+    /// out = f(in); scale is the size of in relative to the full-resolution source
+    typedef std::function<void( const cv::Mat& in, cv::Mat& out, double scale )> Render;
+
+    /**
+     * @param previewPixels size of the preview input; sources not larger than this are rendered directly
+     * @param idleMs        time without a new request before the full-resolution render starts
+     * @param bandPixels    pixels per band of the full-resolution render, the granularity of cancellation
+     */
+    explicit ProgressivePreview( int previewPixels = 512*512, int idleMs = 150, int bandPixels = 1 << 20 )
+        : previewPixels_( std::max( previewPixels, 1 ) ), idleMs_( std::max( idleMs, 0 ) ),
+          bandPixels_( std::max( bandPixels, 1 ) ), scale_(1), halo_(0),
+          requested_(0), done_(0), ready_(0), shown_(0), stop_(false),
+          started_(0), cancelled_(0), completed_(0)
+    {
+        worker_ = std::thread( [this]{ work(); } );
+    }
+
+    ~ProgressivePreview()
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            stop_ = true;
+        }
+        changed_.notify_all();
+        worker_.join();
+    }
+
+    /// Sets the full-resolution source and its downscaled copy; pending work is cancelled
+    void setSource( const cv::Mat& src )
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        src_ = src;
+        const double pixels = (double)src.cols*src.rows;
+        scale_ = pixels > previewPixels_ ? std::sqrt( previewPixels_/pixels ) : 1.0;
+        if( scale_ < 1 )
+            cv::resize( src, small_, cv::Size(), scale_, scale_, cv::INTER_AREA );
+        else
+            small_ = src;
+        done_ = ++requested_;
+    }
+
+    /// Preview scale, 1 when the source is small enough to be rendered directly
+    double scale() const { return scale_; }
+
+    /**
+     * @brief Renders the preview into preview and schedules the full-resolution render
+     * The preview keeps the downscaled size: show it in a WINDOW_NORMAL window, which scales it to the
+     * window, instead of upscaling it on the GUI thread. halo is the number of rows of context render
+     * needs on each side of a band of the full-resolution render.
+     */
+    void request( const Render& render, cv::Mat& preview, int halo = 0 )
+    {
+        if( scale_ >= 1 )
+        {
+            // Small source: the full render is as cheap as a preview
+            render( src_, preview, 1.0 );
+            std::lock_guard<std::mutex> lock( mutex_ );
+            done_ = ++requested_;
+            return;
+        }
+
+        SAMPLES_TRACE_SCOPE( "preview" );
+        render( small_, previewSmall_, scale_ );
+        preview = previewSmall_;
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            render_ = render;
+            halo_ = std::max( halo, 0 );
+            ++requested_;
+        }
+        changed_.notify_one();
+    }
+
+    /// Non-blocking: true and full set once the full-resolution result of the latest request is ready
+    bool poll( cv::Mat& full )
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        if( ready_ != requested_ || shown_ == ready_ )
+            return false;
+        // Hand the buffer over: the worker allocates a new one instead of writing into a displayed image
+        full = result_;
+        result_.release();
+        shown_ = ready_;
+        return true;
+    }
+
+    /// Full-resolution renders started, cancelled by a newer request and completed
+    long long started() const { return started_; }
+    long long cancelled() const { return cancelled_; }
+    long long completed() const { return completed_; }
+
+private:
+    void work()
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+        for( ;; )
+        {
+            changed_.wait( lock, [this]{ return stop_ || done_ != requested_; } );
+            if( stop_ )
+                return;
+
+            // Wait until the slider has been idle for idleMs
+            long long gen = requested_;
+            while( changed_.wait_for( lock, std::chrono::milliseconds( idleMs_ ),
+                                      [this, &gen]{ return stop_ || requested_ != gen; } ) )
+            {
+                if( stop_ )
+                    return;
+                gen = requested_;
+            }
+            if( done_ == gen )
+                continue;  // setSource() or a direct render, nothing to refine
+
+            const Render render = render_;
+            const cv::Mat src = src_;
+            const int halo = halo_;
+            lock.unlock();
+
+            started_++;
+            const bool complete = renderBands( render, src, halo, gen );
+            lock.lock();
+            done_ = gen;
+            if( complete && requested_ == gen )
+            {
+                std::swap( work_, result_ );
+                ready_ = gen;
+                completed_++;
+            }
+            else
+                cancelled_++;
+        }
+    }
+
+    /// Full-resolution render band by band; false as soon as a newer request or stop arrives
+    bool renderBands( const Render& render, const cv::Mat& src, int halo, long long gen )
+    {
+        const int rows = std::max( bandPixels_/std::max( src.cols, 1 ), 1 );
+        cv::Mat out;
+        for( int y0 = 0; y0 < src.rows; y0 += rows )
+        {
+            if( stale( gen ) )
+                return false;
+            SAMPLES_TRACE_SCOPE( "refine band" );
+            const int y1 = std::min( y0 + rows, src.rows );
+            const int a = std::max( y0 - halo, 0 ), b = std::min( y1 + halo, src.rows );
+            render( src.rowRange( a, b ), out, 1.0 );
+            if( y0 == 0 )
+                work_.create( src.size(), out.type() );
+            cv::Mat band = work_.rowRange( y0, y1 );
+            out.rowRange( y0 - a, y1 - a ).copyTo( band );
+        }
+        return !stale( gen );
+    }
+
+    bool stale( long long gen )
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return stop_ || requested_ != gen;
+    }
+
+    const int previewPixels_, idleMs_, bandPixels_;
+    double scale_;
+    cv::Mat src_, small_, previewSmall_;
+    cv::Mat work_;    ///< full-resolution result being rendered, worker only
+    cv::Mat result_;  ///< last completed result not yet taken by poll()
+    Render render_;
+    int halo_;
+    long long requested_, done_, ready_, shown_;  ///< request generations
+    bool stop_;
+    std::atomic<long long> started_, cancelled_, completed_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::thread worker_;
+};
+
+} // namespace samples
+
+#endif // SAMPLES_PROGRESSIVE_PREVIEW_HPP
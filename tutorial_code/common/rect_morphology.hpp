@@ -0,0 +1,252 @@
+/**
+ * @file rect_morphology.hpp
+ * @brief Erosion and dilation by rectangles in constant time per pixel (van Herk/Gil-Werman)
+ * @author OpenCV team
+ */
+
+/**
+ * 矩形结构元素的快速腐蚀、膨胀
+ * 矩形结构元素可以分解成一次水平线段和一次垂直线段的运算。erode/dilate 对 k 个像素的线段
+ * 每个像素要比较 k-1 次，Morphology_1.cpp 中 k 最大为 43。
+ * van Herk/Gil-Werman 算法把序列切成长度为 k 的块，块内分别求前缀最小值 g 和后缀最小值 h，
+ * 窗口 [x, x+k-1] 的最小值就是 min(h[x], g[x+k-1])，每个像素大约 3 次比较，与 k 无关。
+ * 垂直方向的三次比较都是整行对整行，用通用 SIMD 指令在列方向上并行；
+ * 水平方向的前缀/后缀是沿行的递推，逐元素计算，最后一步合并用 SIMD。
+ * 图像外按 erode/dilate 的默认边界处理：腐蚀时视为 255，膨胀时视为 0，对整幅图像结果与 erode/dilate 逐位一致。
+ * 输入是子矩阵(ROI)时只读 ROI 内的像素，ROI 外同样按边界值处理，相当于带 BORDER_ISOLATED 调用；
+ * erode/dilate 不带 BORDER_ISOLATED 时会读父图像中 ROI 外的像素，这时两者结果在 ROI 边缘附近不同。
+ * MorphologyPlan 和 joint_morphology.hpp 建立在这里的矩形运算上，语义相同。
+ */
+
+#ifndef SAMPLES_RECT_MORPHOLOGY_HPP
+#define SAMPLES_RECT_MORPHOLOGY_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace samples {
+
+namespace morph_detail {
+
+/// Erosion: minimum, pixels outside the image count as 255
+struct MinOp
+{
+    static uchar border() { return 255; }
+    static uchar apply( uchar a, uchar b ) { return std::min( a, b ); }
+#if CV_SIMD
+    static cv::v_uint8 apply( const cv::v_uint8& a, const cv::v_uint8& b ) { return cv::v_min( a, b ); }
+#endif
+};
+
+/// Dilation: maximum, pixels outside the image count as 0
+struct MaxOp
+{
+    static uchar border() { return 0; }
+    static uchar apply( uchar a, uchar b ) { return std::max( a, b ); }
+#if CV_SIMD
+    static cv::v_uint8 apply( const cv::v_uint8& a, const cv::v_uint8& b ) { return cv::v_max( a, b ); }
+#endif
+};
+
+/// d[i] = Op(a[i], b[i]) for n bytes
+template<class Op>
+static void combine( const uchar* a, const uchar* b, uchar* d, int n )
+{
+    int i = 0;
+#if CV_SIMD
+    const int VECSZ = cv::VTraits<cv::v_uint8>::vlanes();
+    for( ; i <= n - VECSZ; i += VECSZ )
+        cv::v_store( d + i, Op::apply( cv::vx_load( a + i ), cv::vx_load( b + i ) ) );
+#endif
+    for( ; i < n; i++ )
+        d[i] = Op::apply( a[i], b[i] );
+}
+
+/// Pixels of padding left and right of a row for a window of k pixels; anchor may lie outside [0, k)
+static inline int padLeft( int anchor ) { return std::max( anchor, 0 ); }
+static inline int padRight( int k, int anchor ) { return std::max( k - 1 - anchor, 0 ); }
+
+/// Scratch bytes lineH() needs
+static inline size_t lineHBufSize( int width, int cn, int k, int anchor )
+{
+    return (size_t)3*(padLeft( anchor ) + width + padRight( k, anchor ))*cn;
+}
+
+/**
+ * @brief Horizontal pass: dst[x] = Op over src[x - anchor, x - anchor + k) per channel
+ * @param buf scratch of lineHBufSize() bytes
+ */
+template<class Op>
+static void lineH( const uchar* src, uchar* dst, int width, int cn, int k, int anchor, uchar* buf )
+{
+    const int L = padLeft( anchor ), W = L + width + padRight( k, anchor ), n = W*cn;
+    uchar* p = buf;
+    uchar* g = buf + n;
+    uchar* h = buf + 2*n;
+    std::fill( p, p + L*cn, Op::border() );
+    std::copy( src, src + width*cn, p + L*cn );
+    std::fill( p + (L + width)*cn, p + n, Op::border() );
+
+    for( int x = 0; x < W; x += k )
+    {
+        const int b0 = x*cn, b1 = std::min( x + k, W )*cn;
+        // 块内前缀 g 与后缀 h
+        for( int e = b0; e < b0 + cn; e++ )
+            g[e] = p[e];
+        for( int e = b0 + cn; e < b1; e++ )
+            g[e] = Op::apply( g[e - cn], p[e] );
+        for( int e = b1 - cn; e < b1; e++ )
+            h[e] = p[e];
+        for( int e = b1 - cn - 1; e >= b0; e-- )
+            h[e] = Op::apply( h[e + cn], p[e] );
+    }
+    // 输出 x 的窗口从填充后的 x + L - anchor 开始
+    const int s0 = (L - anchor)*cn;
+    combine<Op>( h + s0, g + s0 + (k - 1)*cn, dst, width*cn );
+}
+
+/**
+ * @brief Vertical pass: out row y = Op over rows(y), ..., rows(y + k - 1)
+ * rows(i) returns padded row i; every combination works on whole rows, so it vectorizes across columns.
+ * @param buf scratch of (k + 1)*len bytes
+ */
+template<class Op, class Rows>
+static void lineV( Rows rows, const cv::Range& out, uchar* const* dst, int len, int k, uchar* buf )
+{
+    uchar* G = buf;
+    uchar* H = buf + len;  // k 行后缀
+    for( int b = out.start; b < out.end; b += k )
+    {
+        // 块 [b, b+k) 的后缀
+        std::copy( rows( b + k - 1 ), rows( b + k - 1 ) + len, H + (k - 1)*len );
+        for( int j = k - 2; j >= 0; j-- )
+            combine<Op>( H + (j + 1)*len, rows( b + j ), H + j*len, len );
+
+        // 窗口 [b+j, b+j+k) = 本块后缀 h[j] 与下一块前缀 g[j-1]
+        const int jn = std::min( k, out.end - b );
+        std::copy( H, H + len, dst[b - out.start] );
+        for( int j = 1; j < jn; j++ )
+        {
+            if( j == 1 )
+                std::copy( rows( b + k ), rows( b + k ) + len, G );
+            else
+                combine<Op>( G, rows( b + k + j - 1 ), G, len );
+            combine<Op>( H + j*len, G, dst[b + j - out.start], len );
+        }
+    }
+}
+
+/**
+ * @brief Output rows [r.start, r.end) of rectMorph() into dst[0], ..., dst[r.size() - 1]
+ * in(y) returns input row y, 0 <= y < height; only rows [r.start - anchor.y, r.end + kh - 1 - anchor.y) are read,
+ * so the input may be a stripe buffer instead of a whole image.
+ */
+template<class Op, class In>
+static void rectStripe( In in, int width, int height, int cn, cv::Size ksize, cv::Point anchor,
+                        const cv::Range& r, uchar* const* dst )
+{
+    const int len = width*cn, kw = ksize.width, kh = ksize.height;
+    // 输出行 [r.start, r.end) 需要输入行 [r.start - anchor.y, r.end + kh - 1 - anchor.y)
+    const int y0 = std::min( std::max( r.start - anchor.y, 0 ), height );
+    const int y1 = std::max( std::min( r.end + kh - 1 - anchor.y, height ), y0 );
+    const bool horizontal = kw > 1 || anchor.x != 0;  //宽为 1、锚点为 0 时水平方向不需要计算
+    std::vector<uchar> buf( (size_t)(horizontal && kh > 1 ? y1 - y0 + 1 : 1)*len +
+                            std::max( lineHBufSize( width, cn, kw, anchor.x ), (size_t)(kh + 1)*len ) );
+    uchar* border = &buf[0];
+    uchar* horiz = border + len;
+    uchar* scratch = horiz + (size_t)(horizontal && kh > 1 ? y1 - y0 : 0)*len;
+    std::fill( border, border + len, Op::border() );
+
+    if( kh == 1 )
+    {
+        // 只有水平方向：输出行 y 来自输入行 y - anchor.y
+        for( int y = r.start; y < r.end; y++ )
+        {
+            int iy = y - anchor.y;
+            uchar* d = dst[y - r.start];
+            if( iy < 0 || iy >= height )
+                std::fill( d, d + len, Op::border() );
+            else if( horizontal )
+                lineH<Op>( in(iy), d, width, cn, kw, anchor.x, scratch );
+            else
+                std::copy( in(iy), in(iy) + len, d );
+        }
+        return;
+    }
+
+    if( horizontal )
+        for( int y = y0; y < y1; y++ )
+            lineH<Op>( in(y), horiz + (size_t)(y - y0)*len, width, cn, kw, anchor.x, scratch );
+
+    // 填充后的第 i 行对应图像第 i - anchor.y 行；不需要水平计算时直接读输入行
+    auto rows = [&]( int i ) -> const uchar*
+    {
+        int y = i - anchor.y;
+        if( y < y0 || y >= y1 )
+            return border;
+        return horizontal ? horiz + (size_t)(y - y0)*len : in(y);
+    };
+    lineV<Op>( rows, r, dst, len, kh, scratch );
+}
+
+/**
+ * @brief Erosion (MinOp) or dilation (MaxOp) of a CV_8U image by a ksize rectangle
+ * dst(x, y) = Op over src(x - anchor.x + i, y - anchor.y + j), 0 <= i < ksize.width, 0 <= j < ksize.height.
+ * The anchor is explicit and may lie outside the rectangle, as for the pieces of a decomposed element.
+ */
+template<class Op>
+static void rectMorph( const cv::Mat& src, cv::Mat& dst, cv::Size ksize, cv::Point anchor )
+{
+    CV_Assert( src.depth() == CV_8U && ksize.width > 0 && ksize.height > 0 );
+
+    cv::Mat in = src.data == dst.data ? src.clone() : src;  //条带之间会读到彼此的输出行
+    dst.create( src.size(), src.type() );
+    cv::Mat out = dst;
+
+    cv::parallel_for_( cv::Range( 0, src.rows ), [&]( const cv::Range& r )
+    {
+        SAMPLES_TRACE_SCOPE( "rect morphology rows" );
+        std::vector<uchar*> dstRows( r.size() );
+        for( int y = r.start; y < r.end; y++ )
+            dstRows[y - r.start] = out.ptr<uchar>(y);
+        rectStripe<Op>( [&]( int y ) { return in.ptr<uchar>(y); }, src.cols, src.rows, src.channels(),
+                        ksize, anchor, r, &dstRows[0] );
+    } );
+}
+
+} // namespace morph_detail
+
+/**
+ * @brief Same result as erode(src, dst, getStructuringElement(MORPH_RECT, ksize, anchor), anchor, iterations)
+ * for a whole image; a submatrix src is treated as isolated, as with BORDER_ISOLATED.
+ * Iterating a rectangle is erosion by a larger rectangle, so the cost does not grow with iterations either.
+ */
+static inline void erodeRect( const cv::Mat& src, cv::Mat& dst, cv::Size ksize,
+                              cv::Point anchor = cv::Point(-1,-1), int iterations = 1 )
+{
+    if( anchor.x < 0 ) anchor.x = ksize.width/2;
+    if( anchor.y < 0 ) anchor.y = ksize.height/2;
+    iterations = std::max( iterations, 1 );
+    morph_detail::rectMorph<morph_detail::MinOp>( src, dst,
+        cv::Size( (ksize.width - 1)*iterations + 1, (ksize.height - 1)*iterations + 1 ), anchor*iterations );
+}
+
+/// Same result as dilate() with a MORPH_RECT element of size ksize, with the same isolated treatment of submatrices
+static inline void dilateRect( const cv::Mat& src, cv::Mat& dst, cv::Size ksize,
+                               cv::Point anchor = cv::Point(-1,-1), int iterations = 1 )
+{
+    if( anchor.x < 0 ) anchor.x = ksize.width/2;
+    if( anchor.y < 0 ) anchor.y = ksize.height/2;
+    iterations = std::max( iterations, 1 );
+    morph_detail::rectMorph<morph_detail::MaxOp>( src, dst,
+        cv::Size( (ksize.width - 1)*iterations + 1, (ksize.height - 1)*iterations + 1 ), anchor*iterations );
+}
+
+} // namespace samples
+
+#endif // SAMPLES_RECT_MORPHOLOGY_HPP
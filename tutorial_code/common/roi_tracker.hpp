@@ -0,0 +1,176 @@
+/**
+ * @file roi_tracker.hpp
+ * @brief Restricts per-frame detection to an expanded box around the last detection
+ * @author OpenCV team
+ */
+
+/**
+ * 基于 ROI 跟踪的增量检测
+ * 目标只占画面一小块且移动缓慢时，每帧对整幅图像做 inRange 是浪费。
+ * RoiTracker 记住上一次检测结果的外接矩形，下一帧只处理把它向四周扩大后的区域；
+ * 每隔 K 帧或者目标丢失（ROI 内没有检测到任何像素）时重新扫描整帧，以发现新出现的目标。
+ * 同时统计实际处理的像素比例和节省的时间。
+ * 结果掩码跨帧复用时，clearOutside() 只清掉上一次 ROI 中这一次不处理的部分，不必每帧清空整帧。
+ *
+ * 用法：
+ *   Rect roi = tracker.begin( frame.size() );
+ *   ... 只在 frame(roi) 上检测，结果写进 mask(roi) ...
+ *   tracker.end( mask(roi), ms );
+ */
+
+#ifndef SAMPLES_ROI_TRACKER_HPP
+#define SAMPLES_ROI_TRACKER_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include <algorithm>
+#include <ostream>
+
+namespace samples {
+
+/**
+ * @brief How much work the tracker skipped
+ */
+struct RoiStats
+{
+    RoiStats() : frames(0), fullScans(0), losses(0), pixelsProcessed(0), pixelsCleared(0), pixelsTotal(0),
+                 fullMs(0), roiMs(0) {}
+
+    long long frames, fullScans, losses;
+    double pixelsProcessed, pixelsCleared, pixelsTotal;  ///< pixelsCleared: mask pixels zeroed outside the ROI
+    double fullMs, roiMs;  ///< detection time summed over full-frame scans and over ROI frames
+
+    /// Fraction of the frame pixels that were actually processed
+    double fraction() const { return pixelsTotal > 0 ? pixelsProcessed/pixelsTotal : 1; }
+    double meanFullMs() const { return fullScans > 0 ? fullMs/fullScans : 0; }
+    double meanRoiMs() const { return frames > fullScans ? roiMs/(frames - fullScans) : 0; }
+    /// Time saved against scanning every frame in full, estimated from the measured full scans
+    double savedMs() const { return frames > fullScans ? meanFullMs()*(frames - fullScans) - roiMs : 0; }
+
+    void print( std::ostream& out, const char* name = "roi" ) const
+    {
+        out << name << ": " << frames << " frames, " << fullScans << " full scans (" << losses << " after loss), "
+            << 100*fraction() << "% of pixels processed, "
+            << (pixelsTotal > 0 ? 100*pixelsCleared/pixelsTotal : 0) << "% cleared; " << meanFullMs() << " ms full / " << meanRoiMs()
+            << " ms ROI, " << (frames > 0 ? savedMs()/frames : 0) << " ms saved per frame" << std::endl;
+    }
+};
+
+/**
+ * @brief Chooses the region to process for each frame from the previous detection
+ */
+class RoiTracker
+{
+public:
+    /**
+     * @param rescanInterval full-frame scan at least every rescanInterval frames, 1 scans every frame
+     * @param margin the box is grown by margin times its size on each side
+     * @param minMargin and by at least this many pixels, so small or fast targets stay inside
+     */
+    explicit RoiTracker( int rescanInterval = 30, double margin = 0.5, int minMargin = 16 )
+        : rescanInterval_( std::max( rescanInterval, 1 ) ), margin_(margin), minMargin_(minMargin),
+          sinceFull_(0), tracking_(false), full_(true) {}
+
+    /// Region of the next frame to process; the whole frame on rescan or without a track
+    cv::Rect begin( cv::Size frameSize )
+    {
+        frame_ = cv::Rect( cv::Point(), frameSize );
+        full_ = !tracking_ || sinceFull_ + 1 >= rescanInterval_;
+        if( full_ )
+            roi_ = frame_;
+        else
+        {
+            int dx = std::max( cvRound( box_.width*margin_ ), minMargin_ );
+            int dy = std::max( cvRound( box_.height*margin_ ), minMargin_ );
+            roi_ = cv::Rect( box_.x - dx, box_.y - dy, box_.width + 2*dx, box_.height + 2*dy ) & frame_;
+        }
+        return roi_;
+    }
+
+    /**
+     * @brief Updates the track from the detection mask of the region returned by begin()
+     * @param roiMask CV_8UC1 mask of size roi.size(), nonzero where the target was detected
+     * @param ms time the detection took, for the statistics
+     * @param cleared mask pixels zeroed outside the ROI for this frame
+     */
+    void end( const cv::Mat& roiMask, double ms = 0, double cleared = 0 )
+    {
+        CV_Assert( roiMask.type() == CV_8UC1 && roiMask.size() == roi_.size() );
+        cv::Rect found = cv::boundingRect( roiMask );
+
+        stats_.frames++;
+        stats_.pixelsProcessed += roi_.area();
+        stats_.pixelsCleared += cleared;
+        stats_.pixelsTotal += frame_.area();
+        if( full_ )
+        {
+            stats_.fullScans++;
+            stats_.fullMs += ms;
+            sinceFull_ = 0;
+        }
+        else
+        {
+            stats_.roiMs += ms;
+            sinceFull_++;
+        }
+
+        tracking_ = found.area() > 0;
+        if( tracking_ )
+            box_ = found + roi_.tl();
+        else if( !full_ )
+            stats_.losses++;  //目标丢失：下一帧全帧扫描
+    }
+
+    /// Forgets the track, the next frame is scanned in full
+    void reset() { tracking_ = false; }
+
+    bool tracking() const { return tracking_; }
+    /// Bounding box of the last detection in frame coordinates
+    cv::Rect box() const { return box_; }
+    const RoiStats& stats() const { return stats_; }
+
+private:
+    int rescanInterval_;
+    double margin_;
+    int minMargin_;
+    int sinceFull_;
+    bool tracking_, full_;
+    cv::Rect frame_, roi_, box_;
+    RoiStats stats_;
+};
+
+/**
+ * @brief Zeroes the part of previous that current does not cover and returns the number of pixels zeroed
+ * For a mask reused across frames that is zero outside previous: afterwards it is zero outside current.
+ */
+static inline double clearOutside( cv::Mat& mask, const cv::Rect& previous, const cv::Rect& current )
+{
+    const cv::Rect p = previous & cv::Rect( cv::Point(), mask.size() );
+    if( p.empty() )
+        return 0;
+    const cv::Rect in = p & current;
+    if( in.empty() )
+    {
+        mask( p ).setTo( 0 );
+        return p.area();
+    }
+    // 上、下两条，中间左、右两块
+    const cv::Rect parts[4] = {
+        cv::Rect( p.x, p.y, p.width, in.y - p.y ),
+        cv::Rect( p.x, in.y + in.height, p.width, p.y + p.height - in.y - in.height ),
+        cv::Rect( p.x, in.y, in.x - p.x, in.height ),
+        cv::Rect( in.x + in.width, in.y, p.x + p.width - in.x - in.width, in.height ) };
+    double n = 0;
+    for( int i = 0; i < 4; i++ )
+        if( !parts[i].empty() )
+        {
+            mask( parts[i] ).setTo( 0 );
+            n += parts[i].area();
+        }
+    return n;
+}
+
+} // namespace samples
+
+#endif // SAMPLES_ROI_TRACKER_HPP
@@ -0,0 +1,157 @@
+/**
+ * @file spsc_ring.hpp
+ * @brief Lock-free single-producer/single-consumer ring of preallocated slots
+ * @author OpenCV team
+ */
+
+/**
+ * 单生产者/单消费者无锁环形缓冲
+ * 槽位(slot)预先分配，生产者通过 beginWrite() 拿到槽位原地写入（例如 cap >> *slot 复用 Mat 的内存），
+ * commitWrite() 发布；消费者 read(out) 用 swap 把槽位内容换到自己手里，
+ * 原来 out 中的缓冲留在槽位中给生产者复用，整个过程不复制图像数据。
+ *
+ * 缓冲满时两种策略：
+ *  - RING_BLOCK：生产者等待消费者
+ *  - RING_DROP_OLDEST：生产者丢弃最旧的未读项，保证消费者总是拿到最新的数据
+ * 策略与元素类型无关，同一个命令行选项可以用于不同类型的环形缓冲。
+ */
+
+#ifndef SAMPLES_SPSC_RING_HPP
+#define SAMPLES_SPSC_RING_HPP
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace samples {
+
+/// What a full ring does with a new item, for rings of any item type
+enum RingPolicy
+{
+    RING_BLOCK       = 0,  ///< the producer waits for the consumer
+    RING_DROP_OLDEST = 1   ///< the producer discards the oldest unread item
+};
+
+/**
+ * @brief Bounded SPSC queue whose slots are reused in place
+ *
+ * Indices grow monotonically and map to slot index % capacity. Items in [read_, write_) are unread.
+ * The consumer claims an item by advancing read_ with a CAS; with RING_DROP_OLDEST the producer advances
+ * read_ the same way to discard the oldest item, so exactly one side wins each index. While the consumer
+ * swaps a claimed slot out it announces the index in busy_, and the producer waits for that swap
+ * (a few header exchanges) before refilling the slot.
+ * All atomics use the default sequentially consistent ordering.
+ */
+template<typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing( size_t capacity, RingPolicy policy = RING_DROP_OLDEST )
+        : slots_( capacity < 1 ? 1 : capacity ), policy_(policy),
+          write_(0), read_(0), busy_(NONE), dropped_(0), closed_(false) {}
+
+    /**
+     * @brief Slot for the next item, or 0 once the ring is closed
+     * Only the producer thread may call it; finish with commitWrite().
+     */
+    T* beginWrite()
+    {
+        const size_t n = slots_.size();
+        const unsigned long long t = write_.load();
+        for( int spins = 0;; )
+        {
+            unsigned long long r = read_.load();
+            if( t - r < n )
+            {
+                // 槽位上一次的内容可能正被消费者 swap 出去，等它完成
+                while( t >= n && busy_.load() == t - n )
+                    std::this_thread::yield();
+                return &slots_[t % n];
+            }
+            if( closed_.load() )
+                return 0;
+            if( policy_ == RING_DROP_OLDEST )
+            {
+                if( read_.compare_exchange_strong( r, r + 1 ) )
+                    dropped_++;
+            }
+            else
+                backoff( spins );
+        }
+    }
+
+    /// Publishes the slot returned by beginWrite()
+    void commitWrite() { write_.store( write_.load() + 1 ); }
+
+    /**
+     * @brief Swaps the oldest unread item into out; false when the ring is empty
+     * Only the consumer thread may call it. The previous content of out goes back into the ring.
+     */
+    bool read( T& out )
+    {
+        for( ;; )
+        {
+            unsigned long long r = read_.load();
+            if( r == write_.load() )
+                return false;
+            busy_.store( r );
+            if( read_.compare_exchange_strong( r, r + 1 ) )
+            {
+                using std::swap;
+                swap( out, slots_[r % slots_.size()] );
+                busy_.store( NONE );
+                return true;
+            }
+            busy_.store( NONE );  //被生产者丢弃了，重试
+        }
+    }
+
+    /// Like read(), but yields until an item arrives or the ring is closed
+    bool waitRead( T& out )
+    {
+        for( int spins = 0; !read( out ); )
+        {
+            if( closed_.load() )
+                return read( out );
+            backoff( spins );
+        }
+        return true;
+    }
+
+    /// Wakes up a blocked producer and lets waitRead() return once the ring is drained
+    void close() { closed_.store( true ); }
+    bool closed() const { return closed_.load(); }
+
+    size_t capacity() const { return slots_.size(); }
+    size_t size() const { return (size_t)(write_.load() - read_.load()); }
+    /// Items discarded by RING_DROP_OLDEST so far
+    unsigned long long dropped() const { return dropped_.load(); }
+
+private:
+    static const unsigned long long NONE = ~0ULL;
+
+    /// Yields for a while, then sleeps briefly so an idle stage does not burn a core
+    static void backoff( int& spins )
+    {
+        if( ++spins < 64 )
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+    }
+
+    std::vector<T> slots_;
+    const RingPolicy policy_;
+    std::atomic<unsigned long long> write_;
+    std::atomic<unsigned long long> read_;
+    std::atomic<unsigned long long> busy_;
+    std::atomic<unsigned long long> dropped_;
+    std::atomic<bool> closed_;
+};
+
+template<typename T> const unsigned long long SpscRing<T>::NONE;
+
+} // namespace samples
+
+#endif // SAMPLES_SPSC_RING_HPP
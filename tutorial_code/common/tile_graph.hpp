@@ -0,0 +1,488 @@
+/**
+ * @file tile_graph.hpp
+ * @brief Operation graph (cvtColor, GaussianBlur, threshold/inRange, erode/dilate, blend) executed tile by tile
+ * @author OpenCV team
+ */
+
+/**
+ * 分块融合的运算图
+ * 实际的处理流程把各个示例中的运算串起来：cvtColor -> GaussianBlur -> threshold/inRange -> erode/dilate -> 混合。
+ * 逐个调用时每一步都把整幅的中间结果写到内存再读回来，8K 图像的中间结果远大于缓存。
+ * TileGraph 先声明运算图，节点包装这些 OpenCV 函数，并知道各自需要的边缘(halo)：
+ *  - 输出图像切成缓存大小的块，从输出往回推出每个节点在这一块需要计算的区域：
+ *    节点的区域是所有下游节点的区域各自加上下游节点的 halo 后的并集，再与整幅图像求交
+ *  - 一块内按节点顺序执行，中间结果写在每个线程复用的小缓冲区里，留在 L1/L2 中，只有输出写回整幅图像
+ *  - 块在 OpenCV 的线程池上并行执行
+ *  - 滤波以 BORDER_ISOLATED 调用：缓冲区的边缘如果是图像的边缘，外推方式与整幅执行相同；
+ *    如果在图像内部，外推出的错误像素只影响本块不需要的那圈 halo，所以结果与逐个整幅执行逐位一致
+ * 代价是相邻块的 halo 区域要重复计算，overcompute() 给出计算量相对整幅执行的倍数。
+ * runUnfused() 按相同的图逐个整幅执行，作为参考结果，用 norm(NORM_INF) 比较。
+ *
+ * 需要整幅图像统计量的运算（THRESH_OTSU、THRESH_TRIANGLE）和改变图像尺寸的颜色转换不能分块。
+ *
+ * 用法：
+ *   samples::TileGraph g;
+ *   int src = g.input();
+ *   int hsv = g.cvtColor( src, COLOR_BGR2HSV );
+ *   int mask = g.inRange( g.gaussianBlur( hsv, Size(5, 5), 0 ), lower, upper );
+ *   g.blend( src, g.input(), g.dilate( g.erode( mask, Mat() ), Mat() ) );
+ *   g.run( { frame, background }, dst );
+ */
+
+#ifndef SAMPLES_TILE_GRAPH_HPP
+#define SAMPLES_TILE_GRAPH_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "compositor.hpp"
+#include "tiled_filter.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace samples {
+
+/**
+ * @brief Directed acyclic graph of image operations, run tile by tile or one operation at a time
+ *
+ * Nodes are identified by the index returned when they are added; a node only reads nodes added
+ * before it. The output is the last node added unless setOutput() says otherwise.
+ */
+class TileGraph
+{
+public:
+    /// out = f(in); isolated is cv::BORDER_ISOLATED when in is a tile buffer, to be or-ed into the border type
+    typedef std::function<void( const std::vector<cv::Mat>& in, cv::Mat& out, int isolated )> Op;
+    /// Output type from the input types
+    typedef std::function<int( const std::vector<int>& types )> TypeFn;
+
+    TileGraph() : output_(-1), inputs_(0), tileSize_(), cacheBytes_(256*1024) {}
+
+    /// Fixed tile size; an empty size derives it from the cache budget
+    void setTileSize( cv::Size tileSize ) { tileSize_ = tileSize; }
+    /// Per-core cache budget the intermediates of a tile should fit in, 256 KB by default
+    void setCacheBytes( size_t bytes ) { cacheBytes_ = bytes; }
+
+    void setOutput( int node )
+    {
+        CV_Assert( 0 <= node && node < (int)nodes_.size() );
+        output_ = node;
+    }
+    int output() const { return output_; }
+
+    /// A graph input, the i-th Mat passed to run() for the i-th call
+    int input()
+    {
+        Node n;
+        n.name = "input";
+        n.input = inputs_++;
+        return push( n );
+    }
+
+    /**
+     * @brief Adds an operation
+     * @param halo pixels op reads beyond each side of the pixel it writes; each axis takes the larger of its two sides
+     * @param type output type, the type of the first input when empty
+     */
+    int add( const std::string& name, const std::vector<int>& inputs, const Halo& halo, const Op& op,
+             const TypeFn& type = TypeFn() )
+    {
+        CV_Assert( !inputs.empty() && op );
+        for( size_t i = 0; i < inputs.size(); i++ )
+            CV_Assert( 0 <= inputs[i] && inputs[i] < (int)nodes_.size() );
+        Node n;
+        n.name = name;
+        n.inputs = inputs;
+        // 图像边缘按反射外推时，读到的是核另一侧的像素，两侧各取较大的 halo
+        n.halo = Halo( std::max( halo.left, halo.right ), std::max( halo.top, halo.bottom ),
+                       std::max( halo.left, halo.right ), std::max( halo.top, halo.bottom ) );
+        n.op = op;
+        n.type = type ? type : []( const std::vector<int>& t ) { return t[0]; };
+        return push( n );
+    }
+
+    /// @name The operations of the samples
+    /// @{
+    /// Color conversions that keep the image size
+    int cvtColor( int src, int code )
+    {
+        return add( "cvtColor", std::vector<int>( 1, src ), Halo(),
+                    [=]( const std::vector<cv::Mat>& in, cv::Mat& out, int ) { cv::cvtColor( in[0], out, code ); },
+                    [=]( const std::vector<int>& t )
+                    {
+                        // 在 2x2 的图像上转换一次得到输出类型
+                        cv::Mat probe = cv::Mat::zeros( 2, 2, t[0] ), out;
+                        cv::cvtColor( probe, out, code );
+                        CV_Assert( out.size() == probe.size() );
+                        return out.type();
+                    } );
+    }
+
+    int gaussianBlur( int src, cv::Size ksize, double sigmaX, double sigmaY = 0, int borderType = cv::BORDER_DEFAULT )
+    {
+        return add( "GaussianBlur", std::vector<int>( 1, src ), Halo::fromGaussian( ksize, sigmaX, sigmaY ),
+                    [=]( const std::vector<cv::Mat>& in, cv::Mat& out, int isolated )
+                    { cv::GaussianBlur( in[0], out, ksize, sigmaX, sigmaY, borderType | isolated ); } );
+    }
+
+    /// THRESH_OTSU and THRESH_TRIANGLE need the histogram of the whole image and are not accepted
+    int threshold( int src, double thresh, double maxval, int type )
+    {
+        CV_Assert( (type & ~7) == 0 );
+        return add( "threshold", std::vector<int>( 1, src ), Halo(),
+                    [=]( const std::vector<cv::Mat>& in, cv::Mat& out, int ) { cv::threshold( in[0], out, thresh, maxval, type ); } );
+    }
+
+    int inRange( int src, const cv::Scalar& lowerb, const cv::Scalar& upperb )
+    {
+        return add( "inRange", std::vector<int>( 1, src ), Halo(),
+                    [=]( const std::vector<cv::Mat>& in, cv::Mat& out, int ) { cv::inRange( in[0], lowerb, upperb, out ); },
+                    []( const std::vector<int>& ) { return CV_8UC1; } );
+    }
+
+    int erode( int src, const cv::Mat& element, cv::Point anchor = cv::Point(-1,-1), int iterations = 1,
+               int borderType = cv::BORDER_CONSTANT, const cv::Scalar& borderValue = cv::morphologyDefaultBorderValue() )
+    {
+        cv::Mat k = element.empty() ? cv::getStructuringElement( cv::MORPH_RECT, cv::Size(3,3) ) : element;
+        return add( "erode", std::vector<int>( 1, src ), Halo::fromKernel( k.size(), anchor, iterations ),
+                    [=]( const std::vector<cv::Mat>& in, cv::Mat& out, int isolated )
+                    { cv::erode( in[0], out, k, anchor, iterations, borderType | isolated, borderValue ); } );
+    }
+
+    int dilate( int src, const cv::Mat& element, cv::Point anchor = cv::Point(-1,-1), int iterations = 1,
+                int borderType = cv::BORDER_CONSTANT, const cv::Scalar& borderValue = cv::morphologyDefaultBorderValue() )
+    {
+        cv::Mat k = element.empty() ? cv::getStructuringElement( cv::MORPH_RECT, cv::Size(3,3) ) : element;
+        return add( "dilate", std::vector<int>( 1, src ), Halo::fromKernel( k.size(), anchor, iterations ),
+                    [=]( const std::vector<cv::Mat>& in, cv::Mat& out, int isolated )
+                    { cv::dilate( in[0], out, k, anchor, iterations, borderType | isolated, borderValue ); } );
+    }
+
+    int addWeighted( int src1, double alpha, int src2, double beta, double gamma, int dtype = -1 )
+    {
+        std::vector<int> inputs( 1, src1 );
+        inputs.push_back( src2 );
+        return add( "addWeighted", inputs, Halo(),
+                    [=]( const std::vector<cv::Mat>& in, cv::Mat& out, int )
+                    { cv::addWeighted( in[0], alpha, in[1], beta, gamma, out, dtype ); },
+                    [=]( const std::vector<int>& t )
+                    { return dtype < 0 ? t[0] : CV_MAKETYPE( CV_MAT_DEPTH(dtype), CV_MAT_CN(t[0]) ); } );
+    }
+
+    /// src1 where mask is 0, src2 where it is 255, weighted by mask/255 in between (8-bit images, composeMasked)
+    int blend( int src1, int src2, int mask )
+    {
+        std::vector<int> inputs( 1, src1 );
+        inputs.push_back( src2 );
+        inputs.push_back( mask );
+        return add( "blend", inputs, Halo(),
+                    []( const std::vector<cv::Mat>& in, cv::Mat& out, int )
+                    {
+                        static thread_local cv::Mat inverse;  //255 - mask，每个线程复用
+                        cv::bitwise_not( in[2], inverse );
+                        std::vector<cv::Mat> srcs( in.begin(), in.begin() + 2 ), alphas( 1, inverse );
+                        alphas.push_back( in[2] );
+                        composeMasked( srcs, alphas, out );
+                    } );
+    }
+    /// @}
+
+    /// Output type of every node for the given input types
+    std::vector<int> types( const std::vector<int>& inputTypes ) const
+    {
+        CV_Assert( (int)inputTypes.size() == inputs_ );
+        std::vector<int> t( nodes_.size() ), in;
+        for( size_t n = 0; n < nodes_.size(); n++ )
+        {
+            const Node& node = nodes_[n];
+            if( node.input >= 0 )
+            {
+                t[n] = inputTypes[node.input];
+                continue;
+            }
+            in.clear();
+            for( size_t j = 0; j < node.inputs.size(); j++ )
+                in.push_back( t[node.inputs[j]] );
+            t[n] = node.type( in );
+        }
+        return t;
+    }
+
+    /**
+     * @brief Tiles covering an output of the given size
+     * The working set of a tile is the region of every node it computes, each grown by the halos
+     * downstream of it; the tile side is the largest multiple of 16 that keeps it within the cache budget.
+     */
+    std::vector<cv::Rect> tiles( cv::Size size, const std::vector<int>& inputTypes ) const
+    {
+        cv::Size ts = tileSize_;
+        if( ts.empty() )
+        {
+            const std::vector<int> t = types( inputTypes );
+            const std::vector<Halo> reach = extents();
+            int side = 1024;
+            for( ; side > 32; side -= 16 )
+            {
+                double bytes = 0;
+                for( size_t n = 0; n < nodes_.size(); n++ )
+                    if( reach[n].maxSide() >= 0 )
+                        bytes += (double)(side + reach[n].left + reach[n].right)*
+                                 (side + reach[n].top + reach[n].bottom)*CV_ELEM_SIZE(t[n]);
+                if( bytes <= (double)cacheBytes_ )
+                    break;
+            }
+            ts = cv::Size( side, side );
+        }
+
+        std::vector<cv::Rect> rects;
+        for( int y = 0; y < size.height; y += ts.height )
+            for( int x = 0; x < size.width; x += ts.width )
+                rects.push_back( cv::Rect( x, y, std::min(ts.width, size.width - x),
+                                           std::min(ts.height, size.height - y) ) );
+        return rects;
+    }
+
+    /// Pixels computed by the operations when run tile by tile, relative to running them one at a time
+    double overcompute( cv::Size size, const std::vector<int>& inputTypes ) const
+    {
+        const std::vector<cv::Rect> rects = tiles( size, inputTypes );
+        const std::vector<Halo> reach = extents();
+        std::vector<cv::Rect> need, area;
+        double tiled = 0, whole = 0;
+        for( size_t i = 0; i < rects.size(); i++ )
+        {
+            regions( rects[i], size, need, area );
+            for( size_t n = 0; n < nodes_.size(); n++ )
+                if( nodes_[n].input < 0 && !need[n].empty() )
+                    tiled += area[n].area();
+        }
+        for( size_t n = 0; n < nodes_.size(); n++ )
+            if( nodes_[n].input < 0 && reach[n].maxSide() >= 0 )
+                whole += (double)size.area();
+        return whole > 0 ? tiled/whole : 1.0;
+    }
+
+    /**
+     * @brief Runs the graph tile by tile on the OpenCV thread pool
+     * All inputs have the same size; dst is (re)allocated only when its size or type differs.
+     */
+    void run( const std::vector<cv::Mat>& inputs, cv::Mat& dst ) const
+    {
+        const cv::Size size = checkInputs( inputs );
+        std::vector<int> inputTypes;
+        for( size_t i = 0; i < inputs.size(); i++ )
+            inputTypes.push_back( inputs[i].type() );
+        const std::vector<int> t = types( inputTypes );
+        const int out = output_;
+
+        // 输出与某个输入是同一块内存时，后面的块会读到前面已经写过的像素，先复制一份输入
+        std::vector<cv::Mat> in( inputs );
+        for( size_t i = 0; i < in.size(); i++ )
+            if( in[i].data == dst.data )
+                in[i] = in[i].clone();
+        dst.create( size, t[out] );
+        cv::Mat result = dst;
+        if( nodes_[out].input >= 0 )
+        {
+            in[nodes_[out].input].copyTo( result );
+            return;
+        }
+
+        const std::vector<cv::Rect> rects = tiles( size, inputTypes );
+        const std::vector<Halo> reach = extents();
+        const cv::Size ts = rects[0].size();
+        // 每段至少包含几块，线程的缓冲区在段内复用
+        const double stripes = std::min( (double)rects.size(), 4.0*cv::getNumThreads() );
+        cv::parallel_for_( cv::Range(0, (int)rects.size()), [&]( const cv::Range& range )
+        {
+            SAMPLES_TRACE_SCOPE( "TileGraph tiles" );
+            std::vector<cv::Mat> scratch( nodes_.size() ), view( nodes_.size() ), args;
+            std::vector<cv::Rect> need, area;
+            for( int i = range.start; i < range.end; i++ )
+            {
+                const cv::Rect& tile = rects[i];
+                regions( tile, size, need, area );
+                for( int n = 0; n <= out; n++ )
+                {
+                    if( need[n].empty() )
+                        continue;
+                    const Node& node = nodes_[n];
+                    if( node.input >= 0 )
+                    {
+                        view[n] = in[node.input]( area[n] );
+                        continue;
+                    }
+
+                    args.resize( node.inputs.size() );
+                    for( size_t j = 0; j < node.inputs.size(); j++ )
+                    {
+                        const int s = node.inputs[j];
+                        args[j] = view[s]( area[n] - area[s].tl() );
+                    }
+
+                    // 输出节点没有 halo 时直接写进 dst，其余写进按最大区域分配一次的缓冲区
+                    cv::Mat o;
+                    if( n == out && area[n] == tile )
+                        o = result( tile );
+                    else
+                    {
+                        if( scratch[n].empty() )
+                            scratch[n].create( ts.height + reach[n].top + reach[n].bottom,
+                                               ts.width + reach[n].left + reach[n].right, t[n] );
+                        o = scratch[n]( cv::Rect( cv::Point(), area[n].size() ) );
+                    }
+                    node.op( args, o, cv::BORDER_ISOLATED );
+                    CV_Assert( o.size() == area[n].size() && o.type() == t[n] );
+                    view[n] = o;
+                }
+                if( area[out] != tile )
+                {
+                    cv::Mat d = result( tile );
+                    view[out]( cv::Rect( tile.tl() - area[out].tl(), tile.size() ) ).copyTo( d );
+                }
+            }
+        }, stripes );
+    }
+
+    void run( const cv::Mat& src, cv::Mat& dst ) const
+    {
+        run( std::vector<cv::Mat>( 1, src ), dst );
+    }
+
+    /// Reference: every operation on the whole image, each writing a full-size intermediate
+    void runUnfused( const std::vector<cv::Mat>& inputs, cv::Mat& dst ) const
+    {
+        checkInputs( inputs );
+        std::vector<cv::Mat> full( output_ + 1 ), args;
+        for( int n = 0; n <= output_; n++ )
+        {
+            const Node& node = nodes_[n];
+            if( node.input >= 0 )
+            {
+                full[n] = inputs[node.input];
+                continue;
+            }
+            SAMPLES_TRACE_SCOPE( "TileGraph unfused op" );
+            args.clear();
+            for( size_t j = 0; j < node.inputs.size(); j++ )
+                args.push_back( full[node.inputs[j]] );
+            node.op( args, full[n], 0 );
+        }
+        full[output_].copyTo( dst );
+    }
+
+    void runUnfused( const cv::Mat& src, cv::Mat& dst ) const
+    {
+        runUnfused( std::vector<cv::Mat>( 1, src ), dst );
+    }
+
+    /// One line per node: index, operation, inputs and halo
+    void print( std::ostream& out ) const
+    {
+        for( size_t n = 0; n < nodes_.size(); n++ )
+        {
+            const Node& node = nodes_[n];
+            out << "  " << n << ": " << node.name;
+            if( node.input >= 0 )
+                out << " " << node.input;
+            for( size_t j = 0; j < node.inputs.size(); j++ )
+                out << (j ? ", " : " <- ") << node.inputs[j];
+            if( node.halo.maxSide() > 0 )
+                out << "  halo " << node.halo.left << "," << node.halo.top << ","
+                    << node.halo.right << "," << node.halo.bottom;
+            out << ((int)n == output_ ? "  (output)" : "") << std::endl;
+        }
+    }
+
+private:
+    struct Node
+    {
+        Node() : input(-1) {}
+
+        std::string name;
+        std::vector<int> inputs;
+        Halo halo;
+        Op op;        ///< empty for graph inputs
+        TypeFn type;
+        int input;    ///< index of the Mat passed to run() for graph inputs, -1 for operations
+    };
+
+    int push( const Node& n )
+    {
+        nodes_.push_back( n );
+        output_ = (int)nodes_.size() - 1;
+        return output_;
+    }
+
+    cv::Size checkInputs( const std::vector<cv::Mat>& inputs ) const
+    {
+        CV_Assert( output_ >= 0 && (int)inputs.size() == inputs_ && !inputs.empty() );
+        for( size_t i = 0; i < inputs.size(); i++ )
+            CV_Assert( !inputs[i].empty() && inputs[i].size() == inputs[0].size() );
+        return inputs[0].size();
+    }
+
+    static cv::Rect grow( const cv::Rect& r, const Halo& h )
+    {
+        return cv::Rect( r.x - h.left, r.y - h.top, r.width + h.left + h.right, r.height + h.top + h.bottom );
+    }
+
+    /**
+     * @brief Pixels each node computes for one output tile
+     * need[n] is the part of node n read downstream (empty when the output does not depend on it),
+     * area[n] the part it computes: need[n] grown by its own halo and clipped to the image.
+     */
+    void regions( const cv::Rect& tile, cv::Size size, std::vector<cv::Rect>& need, std::vector<cv::Rect>& area ) const
+    {
+        const cv::Rect whole( 0, 0, size.width, size.height );
+        need.assign( nodes_.size(), cv::Rect() );
+        area.assign( nodes_.size(), cv::Rect() );
+        need[output_] = tile;
+        for( int n = output_; n >= 0; n-- )
+        {
+            if( need[n].empty() )
+                continue;
+            const Node& node = nodes_[n];
+            area[n] = node.input >= 0 ? need[n] : grow( need[n], node.halo ) & whole;
+            for( size_t j = 0; j < node.inputs.size(); j++ )
+                need[node.inputs[j]] |= area[n];
+        }
+    }
+
+    /// Margin around a tile that the area of each node can extend to; maxSide() is -1 for nodes the output does not use
+    std::vector<Halo> extents() const
+    {
+        std::vector<Halo> reach( nodes_.size(), Halo( -1, -1, -1, -1 ) );
+        reach[output_] = Halo();
+        for( int n = output_; n >= 0; n-- )
+        {
+            const Node& node = nodes_[n];
+            if( reach[n].maxSide() < 0 )
+                continue;
+            const Halo r = node.input >= 0 ? reach[n] : reach[n] + node.halo;
+            reach[n] = r;
+            for( size_t j = 0; j < node.inputs.size(); j++ )
+            {
+                Halo& s = reach[node.inputs[j]];
+                s = Halo( std::max( s.left, r.left ), std::max( s.top, r.top ),
+                          std::max( s.right, r.right ), std::max( s.bottom, r.bottom ) );
+            }
+        }
+        return reach;
+    }
+
+    std::vector<Node> nodes_;
+    int output_, inputs_;
+    cv::Size tileSize_;
+    size_t cacheBytes_;
+};
+
+} // namespace samples
+
+#endif // SAMPLES_TILE_GRAPH_HPP
@@ -0,0 +1,235 @@
+/**
+ * @file tiled_filter.hpp
+ * @brief Cache-blocked, multi-threaded execution of neighbourhood filters
+ * @author OpenCV team
+ */
+
+/**
+ * 分块（tile）执行滤波
+ * Smoothing.cpp、Morphology_1.cpp 中的滤波都是整帧执行，8K 图像时中间行缓冲超出 L2 缓存。
+ * 这里把图像切成 L2 大小的块，每块带上滤波需要的边缘(halo)，在 OpenCV 的线程池上并行执行，
+ * 结果直接写进 dst 中对应的 ROI。
+ *
+ * 关键：对子矩阵(ROI)调用 OpenCV 的滤波函数时，只要 borderType 不带 BORDER_ISOLATED，
+ * 函数会从父图像读取 ROI 外的真实像素，只在整幅图像的边界处按 borderType 外推，
+ * 所以分块结果与整帧结果逐位一致。
+ * 例外是 iterations > 1 的腐蚀、膨胀：第二次起在 dst 上原地迭代，会读到其他线程正在写的相邻块，
+ * 这时改为对带 halo 的输入单独计算到缓冲区，再复制中心部分（PADDED）。
+ */
+
+#ifndef SAMPLES_TILED_FILTER_HPP
+#define SAMPLES_TILED_FILTER_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace samples {
+
+/**
+ * @brief Pixels a filter reads beyond each side of the pixel it writes
+ * 滤波每输出一个像素，在四个方向上需要读取的额外像素数
+ */
+struct Halo
+{
+    int left, top, right, bottom;
+
+    Halo( int l = 0, int t = 0, int r = 0, int b = 0 ) : left(l), top(t), right(r), bottom(b) {}
+
+    /// Halo of a kernel of size ksize with the given anchor, applied iterations times
+    static Halo fromKernel( cv::Size ksize, cv::Point anchor = cv::Point(-1,-1), int iterations = 1 )
+    {
+        if( anchor.x < 0 ) anchor.x = ksize.width/2;
+        if( anchor.y < 0 ) anchor.y = ksize.height/2;
+        return Halo( anchor.x*iterations, anchor.y*iterations,
+                     (ksize.width - anchor.x - 1)*iterations, (ksize.height - anchor.y - 1)*iterations );
+    }
+
+    /// Halo of GaussianBlur; an empty ksize is derived from sigma as GaussianBlur does (larger, floating-point rule)
+    static Halo fromGaussian( cv::Size ksize, double sigmaX, double sigmaY = 0 )
+    {
+        if( ksize.width <= 0 ) ksize.width = cvRound( sigmaX*8 + 1 ) | 1;
+        if( ksize.height <= 0 ) ksize.height = cvRound( (sigmaY > 0 ? sigmaY : sigmaX)*8 + 1 ) | 1;
+        return fromKernel( ksize );
+    }
+
+    /// Halo of a filter that runs after this one
+    Halo operator+( const Halo& h ) const
+    {
+        return Halo( left + h.left, top + h.top, right + h.right, bottom + h.bottom );
+    }
+
+    int maxSide() const { return std::max( std::max(left, right), std::max(top, bottom) ); }
+};
+
+/**
+ * @brief Runs a filter tile by tile on the OpenCV thread pool, writing into the destination in place
+ *
+ * Two ways to run a tile:
+ *  - ROI_BORDER: the filter is called on src(tile) and dst(tile) directly. Valid for OpenCV filters
+ *    called without BORDER_ISOLATED, which read the pixels around a ROI from its parent image.
+ *  - PADDED: the filter is called on src(tile + halo) into a scratch buffer whose centre is copied to
+ *    dst(tile). Needed for filters that treat their input as isolated, e.g. medianBlur, and for
+ *    erode/dilate with iterations > 1, whose later passes run in place on dst and would read the
+ *    neighbouring tiles other threads are writing.
+ * BORDER_WRAP needs the opposite side of the image, so such filters run full-frame.
+ */
+class TiledFilter
+{
+public:
+    typedef std::function<void(const cv::Mat& src, cv::Mat& dst)> Func;
+
+    enum Mode { ROI_BORDER, PADDED };
+
+    TiledFilter( const Func& func, const Halo& halo, int borderType = cv::BORDER_DEFAULT, Mode mode = ROI_BORDER )
+        : func_(func), halo_(halo), borderType_(borderType), mode_(mode),
+          tileSize_(), cacheBytes_(256*1024) {}
+
+    /// Fixed tile size; an empty size derives it from the cache budget
+    void setTileSize( cv::Size tileSize ) { tileSize_ = tileSize; }
+    /// Per-core cache budget used to size the tiles, 256 KB by default
+    void setCacheBytes( size_t bytes ) { cacheBytes_ = bytes; }
+    const Halo& halo() const { return halo_; }
+
+    /**
+     * @brief Tiles covering an image of the given size
+     * The working set of a tile is its source with halo, its destination and the filter's
+     * intermediate rows (assumed 4 bytes per channel, as for the int/float row buffers of OpenCV).
+     */
+    std::vector<cv::Rect> tiles( cv::Size size, int type ) const
+    {
+        cv::Size ts = tileSize_;
+        if( ts.empty() )
+        {
+            size_t bytesPerPixel = CV_ELEM_SIZE(type)*2 + CV_MAT_CN(type)*4;
+            int side = (int)std::sqrt( (double)cacheBytes_/bytesPerPixel );
+            side = std::max( side - 2*halo_.maxSide(), 4*halo_.maxSide() );
+            side = std::max( (int)cv::alignSize( side, 16 ), 32 );
+            ts = cv::Size( side, side );
+        }
+
+        std::vector<cv::Rect> rects;
+        for( int y = 0; y < size.height; y += ts.height )
+            for( int x = 0; x < size.width; x += ts.width )
+                rects.push_back( cv::Rect( x, y, std::min(ts.width, size.width - x),
+                                           std::min(ts.height, size.height - y) ) );
+        return rects;
+    }
+
+    /**
+     * @brief Applies the filter; dst is (re)allocated only when its size or type differs
+     * @param dtype destination depth, -1 for the source depth
+     */
+    void apply( const cv::Mat& src, cv::Mat& dst, int dtype = -1 ) const
+    {
+        CV_Assert( !src.empty() );
+        int type = dtype < 0 ? src.type() : CV_MAKETYPE( CV_MAT_DEPTH(dtype), src.channels() );
+
+        // 原地调用时，后面的块会读到前面已经写过的像素，先复制一份输入
+        cv::Mat input = src.data == dst.data ? src.clone() : src;
+        dst.create( src.size(), type );
+
+        std::vector<cv::Rect> rects = tiles( src.size(), type );
+        if( (borderType_ & ~cv::BORDER_ISOLATED) == cv::BORDER_WRAP || rects.size() <= 1 )
+        {
+            cv::Mat out = dst;
+            func_( input, out );
+            return;
+        }
+
+        const Func& func = func_;
+        const Halo& h = halo_;
+        const Mode mode = mode_;
+        const cv::Rect whole( 0, 0, src.cols, src.rows );
+        cv::parallel_for_( cv::Range(0, (int)rects.size()), [&]( const cv::Range& range )
+        {
+            SAMPLES_TRACE_SCOPE( "TiledFilter tiles" );
+            cv::Mat scratch;  //PADDED 模式下每个线程复用的输出缓冲
+            for( int i = range.start; i < range.end; i++ )
+            {
+                const cv::Rect& r = rects[i];
+                cv::Mat out = dst(r);
+                if( mode == ROI_BORDER )
+                {
+                    func( input(r), out );
+                    continue;
+                }
+                cv::Rect outer = cv::Rect( r.x - h.left, r.y - h.top,
+                                           r.width + h.left + h.right, r.height + h.top + h.bottom ) & whole;
+                func( input(outer), scratch );
+                scratch( cv::Rect( r.x - outer.x, r.y - outer.y, r.width, r.height ) ).copyTo( out );
+            }
+        }, (double)rects.size() );
+    }
+
+    /// @name Tiled versions of the filters used in Smoothing.cpp and Morphology_1.cpp
+    /// @{
+    static TiledFilter blur( cv::Size ksize, int borderType = cv::BORDER_DEFAULT )
+    {
+        return TiledFilter( [=]( const cv::Mat& s, cv::Mat& d ) { cv::blur( s, d, ksize, cv::Point(-1,-1), borderType ); },
+                            Halo::fromKernel( ksize ), borderType );
+    }
+
+    static TiledFilter gaussianBlur( cv::Size ksize, double sigmaX, double sigmaY = 0,
+                                     int borderType = cv::BORDER_DEFAULT )
+    {
+        // ksize 为 Size() 时按 GaussianBlur 的规则由 sigma 推出核大小（取浮点图像的较大值）
+        return TiledFilter( [=]( const cv::Mat& s, cv::Mat& d ) { cv::GaussianBlur( s, d, ksize, sigmaX, sigmaY, borderType ); },
+                            Halo::fromGaussian( ksize, sigmaX, sigmaY ), borderType );
+    }
+
+    static TiledFilter medianBlur( int ksize )
+    {
+        // medianBlur 内部以 BORDER_REPLICATE|BORDER_ISOLATED 扩边，不读父图像，只能用 PADDED
+        return TiledFilter( [=]( const cv::Mat& s, cv::Mat& d ) { cv::medianBlur( s, d, ksize ); },
+                            Halo::fromKernel( cv::Size(ksize, ksize) ), cv::BORDER_REPLICATE, PADDED );
+    }
+
+    static TiledFilter bilateralFilter( int d, double sigmaColor, double sigmaSpace,
+                                        int borderType = cv::BORDER_DEFAULT )
+    {
+        int radius = d <= 0 ? cvRound( sigmaSpace*1.5 ) : d/2;
+        return TiledFilter( [=]( const cv::Mat& s, cv::Mat& dst ) { cv::bilateralFilter( s, dst, d, sigmaColor, sigmaSpace, borderType ); },
+                            Halo( radius, radius, radius, radius ), borderType );
+    }
+
+    static TiledFilter erode( const cv::Mat& element, cv::Point anchor = cv::Point(-1,-1), int iterations = 1,
+                              int borderType = cv::BORDER_CONSTANT,
+                              const cv::Scalar& borderValue = cv::morphologyDefaultBorderValue() )
+    {
+        // 多次迭代时后几次在输出上原地进行，只能用 PADDED，每块的输出是线程自己的缓冲区
+        cv::Mat k = element.empty() ? cv::getStructuringElement( cv::MORPH_RECT, cv::Size(3,3) ) : element;
+        return TiledFilter( [=]( const cv::Mat& s, cv::Mat& d ) { cv::erode( s, d, k, anchor, iterations, borderType, borderValue ); },
+                            Halo::fromKernel( k.size(), anchor, iterations ), borderType,
+                            iterations > 1 ? PADDED : ROI_BORDER );
+    }
+
+    static TiledFilter dilate( const cv::Mat& element, cv::Point anchor = cv::Point(-1,-1), int iterations = 1,
+                               int borderType = cv::BORDER_CONSTANT,
+                               const cv::Scalar& borderValue = cv::morphologyDefaultBorderValue() )
+    {
+        cv::Mat k = element.empty() ? cv::getStructuringElement( cv::MORPH_RECT, cv::Size(3,3) ) : element;
+        return TiledFilter( [=]( const cv::Mat& s, cv::Mat& d ) { cv::dilate( s, d, k, anchor, iterations, borderType, borderValue ); },
+                            Halo::fromKernel( k.size(), anchor, iterations ), borderType,
+                            iterations > 1 ? PADDED : ROI_BORDER );
+    }
+    /// @}
+
+private:
+    Func func_;
+    Halo halo_;
+    int borderType_;
+    Mode mode_;
+    cv::Size tileSize_;
+    size_t cacheBytes_;
+};
+
+} // namespace samples
+
+#endif // SAMPLES_TILED_FILTER_HPP
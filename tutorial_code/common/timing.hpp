@@ -0,0 +1,41 @@
+/**
+ * @file timing.hpp
+ * @brief Averaged wall-clock timing of a callable for the benchmark samples
+ * @author OpenCV team
+ */
+
+/**
+ * 基准测试计时
+ * 各个对比示例都要把同一段代码运行若干次、取平均耗时，这里是它们共用的计时函数：
+ *  - timeMs( "stage", runs, fn ) 返回 fn() 运行 runs 次的平均毫秒数
+ *  - 每次调用在时间线跟踪（trace.hpp）中记为一个名为 stage 的区间，名字必须是字符串常量
+ *  - 这些调用中的 Mat 分配记到 stage 阶段（allocation_tracker.hpp），测量结束后恢复原来的阶段
+ */
+
+#ifndef SAMPLES_TIMING_HPP
+#define SAMPLES_TIMING_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "allocation_tracker.hpp"
+#include "trace.hpp"
+
+namespace samples {
+
+/// Average milliseconds of fn() over runs calls, each traced as stage and allocation-tagged with it
+template<typename Fn>
+static double timeMs( const char* stage, int runs, Fn fn )
+{
+    AllocationStage tag( stage );
+    double t = (double)cv::getTickCount();
+    for( int i = 0; i < runs; i++ )
+    {
+        SAMPLES_TRACE_SCOPE( stage );
+        fn();
+    }
+    return 1000*((double)cv::getTickCount() - t)/cv::getTickFrequency()/runs;
+}
+
+} // namespace samples
+
+#endif // SAMPLES_TIMING_HPP
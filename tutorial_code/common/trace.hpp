@@ -0,0 +1,205 @@
+/**
+ * @file trace.hpp
+ * @brief Scoped trace zones with per-thread lock-free buffers and Chrome trace (JSON) export
+ * @author OpenCV team
+ */
+
+/**
+ * 时间线跟踪
+ * getTickCount 只能得到一段代码的总耗时，看不出多线程之间的并行度和等待。
+ * 这里把每个阶段记录成一个区间（开始时间、持续时间、线程），导出为 Chrome/Perfetto 的 JSON 跟踪格式，
+ * 在 chrome://tracing 或 ui.perfetto.dev 中打开，所有线程在同一条时间线上：
+ *  - SAMPLES_TRACE_SCOPE( "name" ) 在当前作用域结束时记录一个区间，名字必须是字符串常量
+ *  - 每个线程写自己的缓冲区：分块的数组，写满一块再接一块，不加锁，也不与其他线程共享写
+ *  - 线程第一次记录时加锁注册一次；导出时读取各缓冲区已发布的事件数，记录可以同时进行
+ *  - 程序退出时写到 $SAMPLES_TRACE_FILE，未设置时为 samples_trace.json；SAMPLES_TRACE_EXPORT( path ) 随时导出
+ * 编译时定义 SAMPLES_TRACE=1 才启用；默认这些宏展开为空，不包含任何跟踪代码，也没有运行开销。
+ */
+
+#ifndef SAMPLES_TRACE_HPP
+#define SAMPLES_TRACE_HPP
+
+#ifndef SAMPLES_TRACE
+#define SAMPLES_TRACE 0
+#endif
+
+#if SAMPLES_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace samples {
+
+/**
+ * @brief Process-wide collector of trace events, one append-only buffer per thread
+ */
+class Tracer
+{
+public:
+    /// One complete ("X") event
+    struct Event
+    {
+        const char* name;
+        long long startNs, durationNs;
+    };
+
+    /// Never destroyed: threads may still record while the exit handler exports
+    static Tracer& instance()
+    {
+        static Tracer* tracer = create();
+        return *tracer;
+    }
+
+    long long nowNs() const
+    {
+        return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - origin_ ).count();
+    }
+
+    /// Lock-free except for the first event of each thread
+    void record( const char* name, long long startNs, long long endNs )
+    {
+        buffer()->push( name, startNs, endNs - startNs );
+    }
+
+    /// Writes every event published so far in the Chrome trace event format; threads are numbered in order of their first event
+    bool exportTo( const std::string& path ) const
+    {
+        std::ofstream f( path.c_str() );
+        if( !f )
+            return false;
+        f << std::fixed << std::setprecision( 3 ) << "{\"traceEvents\":[";
+        bool first = true;
+        std::lock_guard<std::mutex> lock( mutex_ );
+        for( size_t t = 0; t < buffers_.size(); t++ )
+        {
+            f << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+              << ",\"args\":{\"name\":\"thread " << t << "\"}}";
+            first = false;
+            for( const Chunk* c = &buffers_[t]->head; c; c = c->next.load( std::memory_order_acquire ) )
+            {
+                const int n = c->count.load( std::memory_order_acquire );
+                for( int i = 0; i < n; i++ )
+                {
+                    const Event& e = c->events[i];
+                    f << ",\n{\"name\":\"" << escape( e.name ) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t
+                      << ",\"ts\":" << e.startNs*1e-3 << ",\"dur\":" << e.durationNs*1e-3 << "}";
+                }
+            }
+        }
+        f << "\n]}" << std::endl;
+        return (bool)f;
+    }
+
+private:
+    enum { CHUNK = 4096 };
+
+    /// Fixed block of events; count and next are published with release stores for the exporter
+    struct Chunk
+    {
+        Chunk() : count(0), next(0) {}
+        Event events[CHUNK];
+        std::atomic<int> count;
+        std::atomic<Chunk*> next;
+    };
+
+    /// Events of one thread, written by that thread only
+    struct Buffer
+    {
+        Buffer() : tail(&head) {}
+        void push( const char* name, long long start, long long duration )
+        {
+            int n = tail->count.load( std::memory_order_relaxed );
+            if( n == CHUNK )
+            {
+                Chunk* c = new Chunk;
+                tail->next.store( c, std::memory_order_release );
+                tail = c;
+                n = 0;
+            }
+            Event& e = tail->events[n];
+            e.name = name;
+            e.startNs = start;
+            e.durationNs = duration;
+            tail->count.store( n + 1, std::memory_order_release );
+        }
+        Chunk head;
+        Chunk* tail;
+    };
+
+    Tracer() : origin_( std::chrono::steady_clock::now() ) {}
+
+    static Tracer* create()
+    {
+        Tracer* tracer = new Tracer;
+        std::atexit( exportAtExit );
+        return tracer;
+    }
+
+    static void exportAtExit()
+    {
+        const char* path = std::getenv( "SAMPLES_TRACE_FILE" );
+        instance().exportTo( path ? path : "samples_trace.json" );
+    }
+
+    static std::string escape( const char* s )
+    {
+        std::string r;
+        for( ; *s; s++ )
+        {
+            if( *s == '"' || *s == '\\' )
+                r += '\\';
+            r += *s;
+        }
+        return r;
+    }
+
+    /// Buffer of the calling thread, registered on first use
+    Buffer* buffer()
+    {
+        static thread_local Buffer* cached = 0;
+        if( cached )
+            return cached;
+        std::lock_guard<std::mutex> lock( mutex_ );
+        buffers_.push_back( new Buffer );
+        cached = buffers_.back();
+        return cached;
+    }
+
+    const std::chrono::steady_clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::vector<Buffer*> buffers_;  ///< never freed, events stay readable after their thread exits
+};
+
+/// Records the lifetime of the scope as one event
+class TraceScope
+{
+public:
+    explicit TraceScope( const char* name ) : name_(name), start_( Tracer::instance().nowNs() ) {}
+    ~TraceScope() { Tracer::instance().record( name_, start_, Tracer::instance().nowNs() ); }
+private:
+    const char* name_;
+    long long start_;
+};
+
+} // namespace samples
+
+#define SAMPLES_TRACE_CAT_( a, b ) a##b
+#define SAMPLES_TRACE_CAT( a, b ) SAMPLES_TRACE_CAT_( a, b )
+#define SAMPLES_TRACE_SCOPE( name ) ::samples::TraceScope SAMPLES_TRACE_CAT( samples_trace_scope_, __LINE__ )( name )
+#define SAMPLES_TRACE_EXPORT( path ) ::samples::Tracer::instance().exportTo( path )
+
+#else
+
+#define SAMPLES_TRACE_SCOPE( name ) ((void)0)
+#define SAMPLES_TRACE_EXPORT( path ) ((void)0)
+
+#endif // SAMPLES_TRACE
+
+#endif // SAMPLES_TRACE_HPP
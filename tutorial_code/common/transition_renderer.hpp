@@ -0,0 +1,311 @@
+/**
+ * @file transition_renderer.hpp
+ * @brief Streaming crossfade between two frame sources with frames rendered in parallel and written in order
+ * @author OpenCV team
+ */
+
+/**
+ * 流式转场渲染
+ * AddingImages.cpp 只对两幅固定的图做一次混合。生成两段视频之间的转场时，每一帧的 alpha 按时间表变化：
+ *   dst(i) = (1 - alpha(i))*A(i) + alpha(i)*B(i)
+ * 帧与帧之间互不依赖，所以按帧并行：
+ *  - 读取线程（调用 run() 的线程）从两个来源读帧，放进空闲的槽位，交给工作线程
+ *  - 工作线程各自混合一整帧（定点数 FixedBlend），同时有多帧在处理中
+ *  - 写出线程按帧号顺序把完成的帧交给输出，先完成的帧在槽位里等待
+ * 槽位的数量固定，槽位中的 Mat（两帧输入和输出）反复复用，运行中不再分配图像内存；
+ * 槽位用完时读取线程等待，内存占用有上限。
+ */
+
+#ifndef SAMPLES_TRANSITION_RENDERER_HPP
+#define SAMPLES_TRANSITION_RENDERER_HPP
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "fixed_blend.hpp"
+#include "frame_source.hpp"
+#include "frame_sink.hpp"
+#include "trace.hpp"
+#include "allocation_tracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace samples {
+
+/**
+ * @brief Weight of the second source for each frame of a transition
+ */
+class AlphaSchedule
+{
+public:
+    enum Curve
+    {
+        LINEAR,      ///< constant speed
+        SMOOTHSTEP,  ///< 3t^2 - 2t^3, eases in and out
+        COSINE       ///< (1 - cos(pi t))/2
+    };
+
+    /// frames of transition, preceded by hold frames of the first source only
+    explicit AlphaSchedule( long long frames = 60, Curve curve = LINEAR, long long hold = 0 )
+        : frames_( std::max( frames, 1LL ) ), hold_( std::max( hold, 0LL ) ), curve_(curve) {}
+
+    /// Frames to render: the hold and the transition
+    long long length() const { return hold_ + frames_; }
+
+    double alpha( long long i ) const
+    {
+        if( i < hold_ )
+            return 0;
+        double t = frames_ > 1 ? std::min( (double)(i - hold_)/(frames_ - 1), 1.0 ) : 1.0;
+        switch( curve_ )
+        {
+        case SMOOTHSTEP: return t*t*(3 - 2*t);
+        case COSINE:     return 0.5*(1 - std::cos( CV_PI*t ));
+        default:         return t;
+        }
+    }
+
+    /// "linear", "smooth" or "cosine"; unknown names give LINEAR
+    static Curve curve( const cv::String& name )
+    {
+        if( name == "smooth" || name == "smoothstep" ) return SMOOTHSTEP;
+        if( name == "cosine" ) return COSINE;
+        return LINEAR;
+    }
+
+private:
+    long long frames_, hold_;
+    Curve curve_;
+};
+
+/**
+ * @brief Renders a transition with several frames in flight on a pool of worker threads
+ */
+class TransitionRenderer
+{
+public:
+    /// @param threads worker threads; @param inFlight frames being read, blended or waiting to be written
+    explicit TransitionRenderer( int threads = cv::getNumThreads(), int inFlight = 0 )
+        : threads_( std::max( threads, 1 ) ), inFlight_( inFlight > 0 ? inFlight : 2*std::max( threads, 1 ) + 2 ),
+          frames_(0), seconds_(0) {}
+
+    /**
+     * @brief Renders schedule.length() frames, or fewer if a source or the sink stops
+     * Frames of b are resized to the size of a. Returns the number of frames written.
+     * Frames are checked on the calling thread before they reach a worker: if a frame is not 8-bit, or
+     * a and b have channel counts that cannot be converted into each other, the frames already queued
+     * are finished and a cv::Exception is thrown here.
+     */
+    long long run( FrameSource& a, FrameSource& b, const AlphaSchedule& schedule, FrameSink& sink )
+    {
+        State s( inFlight_ );
+        const cv::int64 start = cv::getTickCount();
+
+        std::vector<std::thread> workers;
+        for( int i = 0; i < threads_; i++ )
+            workers.push_back( std::thread( [&s]{ work( s ); } ) );
+        std::thread writer( [&s, &sink]{ write( s, sink ); } );
+
+        // 读取：按帧号顺序读两个来源，放进空闲槽位
+        AllocationStage stage( "crossfade read" );
+        bool unsupported = false;
+        long long i = 0;
+        for( ; i < schedule.length(); i++ )
+        {
+            int k;
+            {
+                std::unique_lock<std::mutex> lock( s.mutex );
+                s.freed.wait( lock, [&s]{ return !s.free.empty() || s.failed; } );
+                if( s.failed )
+                    break;
+                k = s.free.front();
+                s.free.pop_front();
+            }
+            Slot& slot = s.slots[k];
+            bool got;
+            {
+                SAMPLES_TRACE_SCOPE( "crossfade read" );
+                got = a.read( slot.a ) && b.read( slot.b );
+            }
+            // 在读取线程上检查，工作线程上的异常没有人接住，进程会直接终止
+            if( got && !blendable( slot.a, slot.b ) )
+            {
+                unsupported = true;
+                got = false;
+            }
+            if( !got )
+            {
+                std::lock_guard<std::mutex> lock( s.mutex );
+                s.free.push_back( k );
+                break;
+            }
+            slot.index = i;
+            slot.alpha = schedule.alpha( i );
+            {
+                std::lock_guard<std::mutex> lock( s.mutex );
+                s.jobs.push_back( k );
+            }
+            s.queued.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock( s.mutex );
+            s.total = i;
+        }
+        s.queued.notify_all();
+        s.done.notify_all();
+        for( size_t t = 0; t < workers.size(); t++ )
+            workers[t].join();
+        writer.join();
+
+        frames_ = s.written;
+        seconds_ = (double)(cv::getTickCount() - start)/cv::getTickFrequency();
+        if( unsupported )
+            CV_Error( cv::Error::StsUnsupportedFormat, "crossfade frames must be 8-bit with matching or 1/3 channels" );
+        return frames_;
+    }
+
+    long long frames() const { return frames_; }
+    double seconds() const { return seconds_; }
+    /// Frames written per second over the whole run, reading and writing included
+    double fps() const { return seconds_ > 0 ? frames_/seconds_ : 0; }
+
+private:
+    /// Reused buffers of one frame in flight
+    struct Slot
+    {
+        Slot() : index(-1), alpha(0), ready(false) {}
+        cv::Mat a, b, resized, out;
+        long long index;
+        double alpha;
+        bool ready;  ///< blended, waiting for the writer
+    };
+
+    struct State
+    {
+        explicit State( int n ) : slots( n ), total(-1), written(0), failed(false)
+        {
+            for( int i = 0; i < n; i++ )
+                free.push_back( i );
+        }
+        std::vector<Slot> slots;
+        std::deque<int> free, jobs;
+        long long total;    ///< frames read, known once reading stops, -1 before
+        long long written;
+        bool failed;        ///< the sink refused a frame
+        std::mutex mutex;
+        std::condition_variable freed, queued, done;
+    };
+
+    /// Worker: blends whole frames, one slot at a time
+    static void work( State& s )
+    {
+        AllocationStage stage( "crossfade blend" );
+        for( ;; )
+        {
+            int k;
+            {
+                std::unique_lock<std::mutex> lock( s.mutex );
+                s.queued.wait( lock, [&s]{ return !s.jobs.empty() || s.total >= 0; } );
+                if( s.jobs.empty() )
+                    return;
+                k = s.jobs.front();
+                s.jobs.pop_front();
+            }
+            blend( s.slots[k] );
+            {
+                std::lock_guard<std::mutex> lock( s.mutex );
+                s.slots[k].ready = true;
+            }
+            s.done.notify_one();
+        }
+    }
+
+    /// Frames blend() accepts: 8-bit, with equal channels or gray and BGR
+    static bool blendable( const cv::Mat& a, const cv::Mat& b )
+    {
+        if( a.empty() || b.empty() || a.depth() != CV_8U || b.depth() != CV_8U )
+            return false;
+        const int ca = a.channels(), cb = b.channels();
+        return ca == cb || ((ca == 1 || ca == 3) && (cb == 1 || cb == 3));
+    }
+
+    /// (1 - alpha)*a + alpha*b, single-threaded: the parallelism is across frames
+    /// The frames were checked by blendable() on the reading thread; nothing here may throw.
+    static void blend( Slot& slot )
+    {
+        SAMPLES_TRACE_SCOPE( "crossfade blend" );
+        const cv::Mat* b = &slot.b;
+        if( slot.b.size() != slot.a.size() || slot.b.type() != slot.a.type() )
+        {
+            cv::resize( slot.b, slot.resized, slot.a.size() );
+            if( slot.resized.channels() != slot.a.channels() )
+                cv::cvtColor( slot.resized, slot.resized, slot.a.channels() == 1 ? cv::COLOR_BGR2GRAY : cv::COLOR_GRAY2BGR );
+            b = &slot.resized;
+        }
+        slot.out.create( slot.a.size(), slot.a.type() );
+        FixedBlend blender( 1 - slot.alpha, slot.alpha, 0 );
+        const int len = slot.a.cols*slot.a.channels();
+        for( int y = 0; y < slot.a.rows; y++ )
+            blender.apply( slot.a.ptr<uchar>(y), b->ptr<uchar>(y), slot.out.ptr<uchar>(y), len );
+    }
+
+    /// Writer: hands frames to the sink strictly in index order
+    static void write( State& s, FrameSink& sink )
+    {
+        AllocationStage stage( "crossfade write" );
+        for( long long next = 0;; next++ )
+        {
+            int k = -1;
+            {
+                std::unique_lock<std::mutex> lock( s.mutex );
+                s.done.wait( lock, [&]
+                {
+                    if( s.total >= 0 && next >= s.total )
+                        return true;
+                    for( size_t j = 0; j < s.slots.size(); j++ )
+                        if( s.slots[j].ready && s.slots[j].index == next )
+                        {
+                            k = (int)j;
+                            return true;
+                        }
+                    return false;
+                } );
+                if( k < 0 )
+                    return;
+            }
+            bool ok;
+            {
+                SAMPLES_TRACE_SCOPE( "crossfade write" );
+                ok = sink.write( s.slots[k].out );
+            }
+            {
+                std::lock_guard<std::mutex> lock( s.mutex );
+                s.slots[k].ready = false;
+                s.free.push_back( k );
+                if( ok )
+                    s.written++;
+                else
+                    s.failed = true;
+            }
+            s.freed.notify_one();
+            if( !ok )
+                return;
+        }
+    }
+
+    int threads_, inFlight_;
+    long long frames_;
+    double seconds_;
+};
+
+} // namespace samples
+
+#endif // SAMPLES_TRANSITION_RENDERER_HPP
@@ -13,6 +13,13 @@
 #include "opencv2/imgcodecs.hpp"  // Image file reading and writing ,图片加载和写出操作相关
 #include "opencv2/highgui.hpp"    // High-level GUI， GUI图形界面相关
 #include <iostream>
+#include <iomanip>
+
+#include "../common/fixed_blend.hpp" //定点数线性混合
+#include "../common/frame_sink.hpp"  //无窗口模式的结果输出
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp"       //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
 
 //命名空间
 using namespace cv;
@@ -28,15 +35,19 @@ using namespace std;
  * 1、图像、公式系数参数的声明和初始化，输入参数
  * 2、加载图片，检查图片是否加载成功
  * 3、调用addWeighted()函数
- * 4、显示线性混合结果
+ * 4、比较定点数混合（Q15/Q8 权重，四舍五入/截断）的耗时和与浮点结果的最大偏差
+ * 5、显示线性混合结果，--output 指定输出时不创建窗口，结果写到输出
 */
 
 //主函数
-int main( void )
+int main( int argc, char** argv )
 {
-  
+   CommandLineParser parser( argc, argv,
+     "{alpha  | -1 | blend weight in [0,1], asked on the standard input when negative}"
+     "{output |    | write the blend to null, an image pattern with %, shm:name or a video file instead of showing it}" );
+
   //声明和初始化混合公式 dst = alpha*src1 +  beta*src2 中的两个系数
-   double alpha = 0.5; double beta; double input;
+   double alpha = 0.5; double beta; double input = parser.get<double>( "alpha" );
 
   //图像容器变量
    Mat src1, src2, dst;
@@ -45,25 +56,33 @@ int main( void )
    // 输入系数alpha
    cout << " Simple Linear Blender " << endl;
    cout << "-----------------------" << endl;
-   cout << "* Enter alpha [0.0-1.0]: ";
-   cin >> input;
+   if( input < 0 )
+   {
+     cout << "* Enter alpha [0.0-1.0]: ";
+     cin >> input;
+   }
 
    // We use the alpha provided by the user if it is between 0 and 1
    // 系数限定在0-1之间
    if( input >= 0 && input <= 1 )
      { alpha = input; }
 
+   //统计 Mat 的分配，按阶段汇总，退出时打印
+   samples::AllocationTracker::install();
+   samples::AllocationStage stage( "load" );
+
    //![load]
    /// Read images ( both have to be of the same size and type )
    //  加载两副待混合的原图
-   src1 = imread( "../data/LinuxLogo.jpg" );
-   src2 = imread( "../data/WindowsLogo.jpg" );
+   src1 = samples::imreadCached( "../data/LinuxLogo.jpg" );
+   src2 = samples::imreadCached( "../data/WindowsLogo.jpg" );
    //![load]
 
   //检查图片是否成功加载
    if( src1.empty() ) { cout << "Error loading src1" << endl; return -1; }
    if( src2.empty() ) { cout << "Error loading src2" << endl; return -1; }
 
+   stage.enter( "blend" );
    //![blend_images]
    // 由alpha计算beta, 两者关系限定为  beta = ( 1.0 - alpha )
    beta = ( 1.0 - alpha );
@@ -71,10 +90,67 @@ int main( void )
    addWeighted( src1, alpha, src2, beta, 0.0, dst);
    //![blend_images]
 
+   stage.enter( "fixed point" );
+   //![fixed_point]
+   /// Fixed-point blends: time per call and largest difference from addWeighted
+   //  定点数混合：每次调用的耗时，以及与 addWeighted 浮点结果的最大偏差
+   const int runs = 100;
+   double t = (double)getTickCount();
+   for( int i = 0; i < runs; i++ )
+   {
+     SAMPLES_TRACE_SCOPE( "addWeighted" );
+     addWeighted( src1, alpha, src2, beta, 0.0, dst );
+   }
+   cout << fixed << setprecision( 3 ) << "  float addWeighted      "
+        << 1000*((double)getTickCount() - t)/getTickFrequency()/runs << " ms" << endl;
+
+   const samples::BlendPrecision precisions[] = { samples::BLEND_Q15, samples::BLEND_Q8 };
+   const samples::BlendRounding roundings[] = { samples::BLEND_ROUND_NEAREST, samples::BLEND_TRUNCATE };
+   const char* names[] = { "Q15 round", "Q15 truncate", "Q8 round", "Q8 truncate" };
+   Mat fixed_dst;
+   for( int p = 0; p < 2; p++ )
+     for( int r = 0; r < 2; r++ )
+     {
+       //权重只量化一次，之后每帧只做整数乘加
+       samples::FixedBlend blend( alpha, beta, 0.0, precisions[p], roundings[r] );
+       t = (double)getTickCount();
+       for( int i = 0; i < runs; i++ )
+       {
+         SAMPLES_TRACE_SCOPE( "FixedBlend" );
+         blend.apply( src1, src2, fixed_dst );
+       }
+       double ms = 1000*((double)getTickCount() - t)/getTickFrequency()/runs;
+       cout << "  " << setw( 12 ) << left << names[2*p + r] << right << setw( 11 ) << ms << " ms"
+            << "  max deviation " << norm( dst, fixed_dst, NORM_INF ) << endl;
+     }
+
+   //只有 alpha 变化时：预先求 src1 - src2，之后 dst = src2 + alpha*(src1 - src2)
+   samples::DifferenceBlend difference( src1, src2 );
+   t = (double)getTickCount();
+   for( int i = 0; i < runs; i++ )
+   {
+     SAMPLES_TRACE_SCOPE( "DifferenceBlend" );
+     difference.apply( alpha, fixed_dst );
+   }
+   cout << "  " << setw( 12 ) << left << "difference" << right << setw( 11 )
+        << 1000*((double)getTickCount() - t)/getTickFrequency()/runs << " ms"
+        << "  max deviation " << norm( dst, fixed_dst, NORM_INF ) << endl;
+   //![fixed_point]
+
+   stage.enter( "display" );
    //![display]
-   //显示混合结果
-   imshow( "Linear Blend", dst );
-   waitKey(0);
+   //显示混合结果；无窗口模式写到输出
+   if( parser.has( "output" ) )
+   {
+     Ptr<samples::FrameSink> sink = samples::FrameSink::create( parser.get<String>( "output" ) );
+     sink->write( dst );
+     sink->stats().print( cout, "output", "write" );
+   }
+   else
+   {
+     imshow( "Linear Blend", dst );
+     waitKey(0);
+   }
    //![display]
 
    return 0;
@@ -86,4 +162,5 @@ int main( void )
  * 混合公式两个系数取值限定在[0,1], 两者关系为beta = ( 1.0 - alpha )
  * gamma参数不取零混合公式就变为 dst = alpha*src1 +  beta*src2 + gamma
  * 调用示例addWeighted( src1, alpha, src2, beta, 0.0, dst);
+ * 8 位图像混合可以用定点数：权重量化为 Q15 或 Q8 整数，16 位整数 SIMD 乘加，右移前加 0.5 即四舍五入
 */
\ No newline at end of file
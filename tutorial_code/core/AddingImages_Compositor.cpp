@@ -0,0 +1,151 @@
+/**
+ * @file AddingImages_Compositor.cpp
+ * @brief Single-pass N-way blending compared with chained addWeighted for N = 2..16
+ * @author OpenCV team
+ */
+
+/**
+ * N 幅图像混合的基准测试
+ * dst = (src0 + src1 + ... + src(N-1))/N：
+ *  - 链式 addWeighted：先混合前两幅，再依次把中间结果与下一幅混合，共 N-1 次整帧读写
+ *  - samples::compose：所有输入一次遍历，32 位累加，最后一次舍入
+ * 以及逐像素 alpha 掩码的混合与链式 multiply/add 的比较。
+ * 打印耗时和与浮点累加结果的最大偏差，链式做法每一步舍入一次，偏差随 N 增大。
+ */
+
+//头文件
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/imgcodecs.hpp"
+
+#include "../common/compositor.hpp"
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/timing.hpp" //基准测试计时
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
+//命名空间
+using namespace std;
+using namespace cv;
+using samples::timeMs;
+
+/// Float accumulation of sum(weights[i]*srcs[i]), the reference both methods are measured against
+/// 浮点累加的参考结果
+static void reference( const vector<Mat>& srcs, const vector<double>& weights, Mat& dst )
+{
+    Mat acc = Mat::zeros( srcs[0].size(), CV_MAKETYPE( CV_64F, srcs[0].channels() ) ), f;
+    for( size_t i = 0; i < srcs.size(); i++ )
+    {
+        srcs[i].convertTo( f, CV_64F );
+        scaleAdd( f, weights[i], acc, acc );
+    }
+    acc.convertTo( dst, CV_8U );
+}
+
+/**
+ * @function main
+ */
+int main( int argc, char** argv )
+{
+    CommandLineParser parser( argc, argv,
+        "{@input1 | ../data/LinuxLogo.jpg   | first image}"
+        "{@input2 | ../data/WindowsLogo.jpg | second image}"
+        "{width   | 1920 | width the images are resized to}"
+        "{height  | 1080 | height the images are resized to}"
+        "{runs    | 10   | runs averaged per measurement}" );
+
+    //统计 Mat 的分配，按阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+    samples::AllocationStage stage( "setup" );
+
+    Mat img1 = samples::imreadCached( parser.get<String>( "@input1" ) );
+    Mat img2 = samples::imreadCached( parser.get<String>( "@input2" ) );
+    if( img1.empty() || img2.empty() )
+    {
+        cout << "Usage: " << argv[0] << " <image1> <image2>" << endl;
+        return -1;
+    }
+    const Size size( parser.get<int>( "width" ), parser.get<int>( "height" ) );
+    const int runs = std::max( parser.get<int>( "runs" ), 1 );
+
+    /// 16 sources: the two images, their flips, then noise
+    /// 16 幅输入：两幅图、它们的翻转，其余为随机噪声
+    vector<Mat> all( 16 ), alphas( 16 );
+    resize( img1, all[0], size );
+    resize( img2, all[1], size );
+    for( int i = 2; i < 16; i++ )
+    {
+        if( i < 8 )
+            flip( all[i % 2], all[i], i/2 - 2 );
+        else
+        {
+            all[i].create( size, CV_8UC3 );
+            randu( all[i], Scalar::all( 0 ), Scalar::all( 256 ) );
+        }
+        alphas[i].create( size, CV_8UC1 );
+    }
+    alphas[0].create( size, CV_8UC1 );
+    alphas[1].create( size, CV_8UC1 );
+
+    //! [benchmark]
+    cout << fixed << setprecision( 2 );
+    cout << "  N   chained  compose   dev(chained)  dev(compose)   masked chained   masked compose" << endl;
+    bool all_ok = true;
+    Mat chained, composed, ref, f, acc, alpha3;
+    for( int n = 2; n <= 16; n++ )
+    {
+        vector<Mat> srcs( all.begin(), all.begin() + n );
+        vector<double> weights( n, 1.0/n );
+
+        /// Chained addWeighted: running blend of the first i images with weight i/(i+1)
+        /// 链式 addWeighted：前 i 幅的混合结果与第 i+1 幅按 i:1 混合
+        double tChained = timeMs( "chained addWeighted", runs, [&]
+        {
+            addWeighted( srcs[0], 0.5, srcs[1], 0.5, 0.0, chained );
+            for( int i = 2; i < n; i++ )
+                addWeighted( chained, (double)i/(i + 1), srcs[i], 1.0/(i + 1), 0.0, chained );
+        } );
+        double tCompose = timeMs( "compose", runs, [&]{ samples::compose( srcs, weights, composed ); } );
+        reference( srcs, weights, ref );
+        double devChained = norm( ref, chained, NORM_INF ), devCompose = norm( ref, composed, NORM_INF );
+        all_ok = all_ok && devCompose <= 1;
+
+        /// Per-pixel alpha: random masks summing to at most 255
+        /// 逐像素 alpha：随机掩码，和不超过 255
+        vector<Mat> masks( alphas.begin(), alphas.begin() + n );
+        for( int i = 0; i < n; i++ )
+            randu( masks[i], Scalar::all( 0 ), Scalar::all( 255/n + 1 ) );
+        double tMaskChained = timeMs( "chained masked blend", runs, [&]
+        {
+            acc = Mat::zeros( size, CV_32FC3 );
+            for( int i = 0; i < n; i++ )
+            {
+                cvtColor( masks[i], alpha3, COLOR_GRAY2BGR );
+                multiply( srcs[i], alpha3, f, 1.0/255, CV_32F );
+                add( acc, f, acc );
+            }
+            acc.convertTo( chained, CV_8U );
+        } );
+        double tMaskCompose = timeMs( "composeMasked", runs, [&]{ samples::composeMasked( srcs, masks, composed ); } );
+        double devMasked = norm( chained, composed, NORM_INF );
+        all_ok = all_ok && devMasked <= 1;
+
+        cout << setw( 3 ) << n << setw( 10 ) << tChained << setw( 9 ) << tCompose
+             << setw( 15 ) << devChained << setw( 14 ) << devCompose
+             << setw( 17 ) << tMaskChained << setw( 17 ) << tMaskCompose << " ms"
+             << (devCompose <= 1 && devMasked <= 1 ? "" : "  [MISMATCH]") << endl;
+    }
+    cout << (all_ok ? "compose within 1 of the float reference" : "Results differ") << endl;
+    //! [benchmark]
+    return all_ok ? 0 : 1;
+}
+
+/**
+ * 要点总结
+ * 链式 addWeighted 混合 N 幅图要 N-1 次整帧读写，每一步都舍入
+ * 一次遍历：每个像素块的 N 个输入在寄存器里累加，最后一次舍入、饱和存储
+ * 两幅图的像素交错成 16 位对，一条 v_dotprod 同时乘加两幅图
+ * 逐像素 alpha 的乘积 a*src 不超过 255*255，16 位乘法即精确
+ */
@@ -0,0 +1,97 @@
+/**
+ * @file AddingImages_Crossfade.cpp
+ * @brief Streaming crossfade between two clips, rendered on a thread pool and written in order
+ * @author OpenCV team
+ */
+
+/**
+ * 流式转场
+ * AddingImages.cpp 的线性混合用在视频上：两个帧来源 A、B，第 i 帧输出
+ *   dst(i) = (1 - alpha(i))*A(i) + alpha(i)*B(i)
+ * alpha 按时间表从 0 变到 1（匀速、缓入缓出或余弦），前面可以先保持若干帧纯 A。
+ */
+
+/**
+ * 程序流程
+ * 1、由命令行创建两个帧来源（视频、图像序列、单幅图像、合成画面）和输出（视频、图像序列、丢弃）
+ * 2、按 alpha 时间表渲染转场：多帧同时在线程池中混合，按帧号顺序写出
+ * 3、打印渲染帧率和两个来源、输出各自的统计；退出时打印读取、混合、写出各阶段的 Mat 分配
+ */
+
+//头文件
+#include <iostream>
+#include "opencv2/core/utility.hpp"
+#include "opencv2/imgcodecs.hpp"
+
+#include "../common/frame_source.hpp"      //帧来源
+#include "../common/frame_sink.hpp"        //帧输出
+#include "../common/transition_renderer.hpp" //转场渲染
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
+//命名空间
+using namespace std;
+using namespace cv;
+
+/// A single image is played as a still clip, anything else goes to FrameSource::create
+/// 单幅图像当作静止画面循环播放，其余交给 FrameSource::create
+static Ptr<samples::FrameSource> openSource( const String& spec )
+{
+    bool pattern = spec.find( '%' ) != String::npos || spec.find( '*' ) != String::npos;
+    if( !pattern && spec.compare( 0, 9, "synthetic" ) != 0 && !imread( spec ).empty() )
+        return makePtr<samples::ImageSequenceSource>( spec, true );
+    return samples::FrameSource::create( spec, true );
+}
+
+/**
+ * @function main
+ */
+int main( int argc, char** argv )
+{
+    CommandLineParser parser( argc, argv,
+        "{a        | synthetic:1280x720     | first clip: video, image, pattern with % or *, camera:N or synthetic:WxH}"
+        "{b        | ../data/LinuxLogo.jpg  | second clip, resized to the size of the first}"
+        "{frames   | 120    | frames of the transition}"
+        "{hold     | 0      | frames of the first clip before the transition starts}"
+        "{curve    | linear | alpha schedule: linear, smooth or cosine}"
+        "{output   |        | video file, image pattern such as out/%05d.png, or empty to discard}"
+        "{fps      | 30     | frame rate of the output video}"
+        "{threads  | -1     | worker threads, -1 for getNumThreads()}"
+        "{inflight | 0      | frames in flight, 0 for 2*threads + 2}"
+        "{help h   |        | print this help}" );
+    if( parser.has( "help" ) )
+    {
+        parser.printMessage();
+        return 0;
+    }
+
+    //统计 Mat 的分配，渲染器的读取、混合、写出线程各记一个阶段，退出时打印
+    samples::AllocationTracker::install();
+
+    Ptr<samples::FrameSource> a = openSource( parser.get<String>( "a" ) );
+    Ptr<samples::FrameSource> b = openSource( parser.get<String>( "b" ) );
+    Ptr<samples::FrameSink> sink = samples::FrameSink::create( parser.get<String>( "output" ), parser.get<double>( "fps" ) );
+
+    //! [render]
+    samples::AlphaSchedule schedule( parser.get<int>( "frames" ),
+                                     samples::AlphaSchedule::curve( parser.get<String>( "curve" ) ),
+                                     parser.get<int>( "hold" ) );
+    int threads = parser.get<int>( "threads" );
+    samples::TransitionRenderer renderer( threads > 0 ? threads : getNumThreads(), parser.get<int>( "inflight" ) );
+    long long written = renderer.run( *a, *b, schedule, *sink );
+    //! [render]
+
+    cout << "rendered " << written << " of " << schedule.length() << " frames in " << renderer.seconds()
+         << " s: " << renderer.fps() << " frames/s" << endl;
+    a->stats().print( cout, "clip a" );
+    b->stats().print( cout, "clip b" );
+    sink->stats().print( cout, "output", "write" );
+    return written == schedule.length() ? 0 : 1;
+}
+
+/**
+ * 要点总结
+ * 转场的每一帧只依赖两个输入帧和 alpha，帧与帧之间可以并行
+ * 多帧同时在线程池中处理，写出线程按帧号排序，先完成的帧等待前面的帧
+ * 槽位数量固定、其中的 Mat 复用，内存占用有上限，运行中不再分配（分配统计的次数不随帧数增长）
+ * alpha 时间表：匀速、缓入缓出 3t^2-2t^3、余弦
+ */
@@ -8,6 +8,11 @@
 
 #include <iostream>
 
+#include "../common/frame_sink.hpp" //无窗口模式的结果输出
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp"       //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
 /**
  * 程序流程
  * 1、加载图像，格式为灰度图
@@ -19,7 +24,8 @@
  * 7、将幅度映射到对数域
  * 8、以图像中心为原点划分象限，每个象限创建一个ROI
  * 9、对角象限互换
- * 10、显示结果
+ * 10、显示结果，--output 指定输出时不创建窗口，频谱转为 8 位后写到输出
+ * 退出时按上面的阶段打印 Mat 分配的次数、字节数和存活峰值
  */
 
 //命名空间
@@ -33,7 +39,7 @@ static void help(void)
         <<  "This program demonstrated the use of the discrete Fourier transform (DFT). " << endl   //离散傅里叶变换示例
         <<  "The dft of an image is taken and it's power spectrum is displayed."          << endl   //离散傅里叶变换后显示功率谱
         <<  "Usage:"                                                                      << endl
-        <<  "./discrete_fourier_transform [image_name -- default ../data/lena.jpg]"       << endl;  //默认加载图片路径
+        <<  "./discrete_fourier_transform [image_name -- default ../data/lena.jpg] [--output=<sink>]" << endl;  //默认加载图片路径
 }
 
 int main(int argc, char ** argv)
@@ -41,16 +47,24 @@ int main(int argc, char ** argv)
     help();
 
     //获取图像路径（文件名），命令行输入否则默认
-    const char* filename = argc >=2 ? argv[1] : "../data/lena.jpg";
+    CommandLineParser parser(argc, argv,
+        "{@input | ../data/lena.jpg | input image}"
+        "{output |  | write the spectrum to null, an image pattern with %, shm:name or a video file instead of showing it}");
+    const String filename = parser.get<String>("@input");
+
+    //统计 Mat 的分配，按阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+    samples::AllocationStage stage("load");
 
     //加载图像，方式为加载灰度图
-    Mat I = imread(filename, IMREAD_GRAYSCALE);
+    Mat I = samples::imreadCached(filename, IMREAD_GRAYSCALE);
     //检查是否成功加载
     if( I.empty()){
         cout << "Error opening image" << endl;
         return -1;
     }
 
+    stage.enter("expand");
 //! [expand]
     Mat padded;                            
     //expand input image to optimal size， 将输入图像扩展到最佳大小
@@ -58,9 +72,13 @@ int main(int argc, char ** argv)
     int n = getOptimalDFTSize( I.cols ); 
 
     // on the border add zero values，在边框上添加零值，使用copyMakeBorder函数
-    copyMakeBorder(I, padded, 0, m - I.rows, 0, n - I.cols, BORDER_CONSTANT, Scalar::all(0));
+    {
+        SAMPLES_TRACE_SCOPE( "expand" );
+        copyMakeBorder(I, padded, 0, m - I.rows, 0, n - I.cols, BORDER_CONSTANT, Scalar::all(0));
+    }
 //! [expand]
 
+    stage.enter("complex");
 //! [complex_and_real] 实部和虚部
     Mat planes[] = {Mat_<float>(padded), Mat::zeros(padded.size(), CV_32F)}; //Mat 数组储存图像的实部和虚部
     Mat complexI; 
@@ -68,25 +86,38 @@ int main(int argc, char ** argv)
 
 //! [complex_and_real]
 
+    stage.enter("dft");
 //! [dft]
     //离散傅里叶变换
-    dft(complexI, complexI);            // this way the result may fit in the source matrix，这种方式的结果可能适合在源矩阵
+    {
+        SAMPLES_TRACE_SCOPE( "dft" );
+        dft(complexI, complexI);        // this way the result may fit in the source matrix，这种方式的结果可能适合在源矩阵
+    }
 
 //! [dft]
 
     // compute the magnitude and switch to logarithmic scale，计算幅度并映射到对数刻度
     //公式 => log(1 + sqrt(Re(DFT(I))^2 + Im(DFT(I))^2)) 
+    stage.enter("magnitude");
 //! [magnitude] 幅度
-    split(complexI, planes);                   // planes[0] = Re(DFT(I), planes[1] = Im(DFT(I)),分离实部和虚部
-    magnitude(planes[0], planes[1], planes[0]);// planes[0] = magnitude，计算幅度且存放到planes[0]
+    {
+        SAMPLES_TRACE_SCOPE( "magnitude" );
+        split(complexI, planes);                   // planes[0] = Re(DFT(I), planes[1] = Im(DFT(I)),分离实部和虚部
+        magnitude(planes[0], planes[1], planes[0]);// planes[0] = magnitude，计算幅度且存放到planes[0]
+    }
     Mat magI = planes[0]; //幅度 
 //! [magnitude]
 
+    stage.enter("log");
 //! [log]
-    magI += Scalar::all(1);                    // switch to logarithmic scale，映射到对数刻度
-    log(magI, magI);
+    {
+        SAMPLES_TRACE_SCOPE( "log" );
+        magI += Scalar::all(1);                // switch to logarithmic scale，映射到对数刻度
+        log(magI, magI);
+    }
 //! [log]
 
+    stage.enter("rearrange");
 //! [crop_rearrange]裁剪重新排列
     // crop the spectrum, if it has an odd number of rows or columns， 裁剪频谱, 如果它有奇数行或列数
     magI = magI(Rect(0, 0, magI.cols & -2, magI.rows & -2));
@@ -102,22 +133,41 @@ int main(int argc, char ** argv)
     Mat q2(magI, Rect(0, cy, cx, cy));  // Bottom-Left，左下，第三象限
     Mat q3(magI, Rect(cx, cy, cx, cy)); // Bottom-Right， 右下，第四象限
 
-    Mat tmp;                           // swap quadrants (Top-Left with Bottom-Right)，交换左上和右下象限
-    q0.copyTo(tmp);
-    q3.copyTo(q0);
-    tmp.copyTo(q3);
+    {
+        SAMPLES_TRACE_SCOPE( "rearrange" );
+        Mat tmp;                       // swap quadrants (Top-Left with Bottom-Right)，交换左上和右下象限
+        q0.copyTo(tmp);
+        q3.copyTo(q0);
+        tmp.copyTo(q3);
 
-    q1.copyTo(tmp);                    // swap quadrant (Top-Right with Bottom-Left)，交换右上和左下象限
-    q2.copyTo(q1);
-    tmp.copyTo(q2);
+        q1.copyTo(tmp);                // swap quadrant (Top-Right with Bottom-Left)，交换右上和左下象限
+        q2.copyTo(q1);
+        tmp.copyTo(q2);
+    }
 //! [crop_rearrange]
 
+    stage.enter("normalize");
 //! [normalize]
     //归一化，像素值都映射到[0,1]之间
-    normalize(magI, magI, 0, 1, NORM_MINMAX); // Transform the matrix with float values into a
-                                            // viewable image form (float between values 0 and 1).
+    {
+        SAMPLES_TRACE_SCOPE( "normalize" );
+        normalize(magI, magI, 0, 1, NORM_MINMAX); // Transform the matrix with float values into a
+                                                // viewable image form (float between values 0 and 1).
+    }
 //! [normalize]
 
+    stage.enter("output");
+    //无窗口模式：频谱放大到 [0,255] 的 8 位图像后写到输出
+    if (parser.has("output"))
+    {
+        Mat spectrum;
+        magI.convertTo(spectrum, CV_8U, 255);
+        Ptr<samples::FrameSink> sink = samples::FrameSink::create(parser.get<String>("output"));
+        sink->write(spectrum);
+        sink->stats().print(cout, "output", "write");
+        return 0;
+    }
+
     //显示结果
     imshow("Input Image"       , I   );    // Show the result
     imshow("spectrum magnitude", magI);
@@ -139,4 +189,6 @@ int main(int argc, char ** argv)
  * magnitude()计算幅度
  * log()对数函数
  * normalize()归一化函数
- * /
\ No newline at end of file
+ * 结果写到可替换的输出，无窗口环境下也能运行
+ * 扩展、复数平面、分离实部虚部各分配整幅的缓冲，按阶段统计可以看出哪些可以复用
+ */
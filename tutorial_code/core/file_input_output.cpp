@@ -6,6 +6,8 @@
 #include <iostream>
 #include <string>
 
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
 //命名空间
 using namespace cv;
 using namespace std;
@@ -90,8 +92,12 @@ int main(int ac, char** av)
         return 1;
     }
 
+    //统计 Mat 的分配，按写、读两个阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+
     string filename = av[1];
     { //write
+        samples::AllocationStage stage("write");
         //写数据，输出数据到文件
         //创建数据
         Mat R = Mat_<uchar>::eye(3, 3),
@@ -125,6 +131,7 @@ int main(int ac, char** av)
     }
 
     {//read
+        samples::AllocationStage stage("read");
         //从文件读取数据到对象
 
         cout << endl << "Reading: " << endl;
@@ -9,6 +9,11 @@
 #include <iostream>
 #include <sstream>
 
+#include "../common/point_ops.hpp"   //点运算查找表
+#include "../common/image_cache.hpp" //解码图像缓存
+#include "../common/trace.hpp"       //时间线跟踪
+#include "../common/allocation_tracker.hpp" //Mat 分配统计
+
 //命名空间
 using namespace std;
 using namespace cv;
@@ -44,12 +49,16 @@ int main( int argc, char* argv[])
         return -1;
     }
 
+    //统计 Mat 的分配，按阶段汇总，退出时打印
+    samples::AllocationTracker::install();
+    samples::AllocationStage stage("load");
+
     //输入图像到I
     Mat I, J;
     if( argc == 4 && !strcmp(argv[3],"G") )
-        I = imread(argv[1], IMREAD_GRAYSCALE);
+        I = samples::imreadCached(argv[1], IMREAD_GRAYSCALE);
     else
-        I = imread(argv[1], IMREAD_COLOR);
+        I = samples::imreadCached(argv[1], IMREAD_COLOR);
 
     if (I.empty())
     {
@@ -77,6 +86,7 @@ int main( int argc, char* argv[])
     const int times = 100;
     double t;
 
+    stage.enter("scan C operator []");
     t = (double)getTickCount(); //记录开始时间点
 
     for (int i = 0; i < times; ++i)
@@ -93,6 +103,7 @@ int main( int argc, char* argv[])
     cout << "Time of reducing with the C operator [] (averaged for "
          << times << " runs): " << t << " milliseconds."<< endl;
 
+    stage.enter("scan iterator");
     t = (double)getTickCount(); //记录开始时间点
 
     for (int i = 0; i < times; ++i)
@@ -109,6 +120,7 @@ int main( int argc, char* argv[])
         << times << " runs): " << t << " milliseconds."<< endl;
 
     //记录开始时间点
+    stage.enter("scan at");
     t = (double)getTickCount();
 
     for (int i = 0; i < times; ++i)
@@ -132,25 +144,55 @@ int main( int argc, char* argv[])
         p[i] = table[i];
     //! [table-init]
 
+    stage.enter("LUT");
     t = (double)getTickCount();
 
     for (int i = 0; i < times; ++i)
+    {
+        SAMPLES_TRACE_SCOPE( "LUT" );
         //! [table-use]
         //LUT函数操作 dst(I)←lut(src(I) + d)
         LUT(I, lookUpTable, J);
         //! [table-use]
+    }
 
     t = 1000*((double)getTickCount() - t)/getTickFrequency();
     t /= times;
     //输出处理时间
     cout << "Time of reducing with the LUT function (averaged for "
         << times << " runs): " << t << " milliseconds."<< endl;
-    return 0;
+
+    //! [point-ops]
+    /// The same reduction as a compiled point operation, written into a persistent output
+    /// 同样的缩减用点运算查找表完成，输出 K 在多次运行间复用
+    samples::PointOps ops;
+    ops.reduce(divideWith);
+    Mat K;
+
+    stage.enter("PointOps");
+    t = (double)getTickCount();
+
+    for (int i = 0; i < times; ++i)
+    {
+        SAMPLES_TRACE_SCOPE( "PointOps" );
+        ops.apply(I, K);
+    }
+
+    t = 1000*((double)getTickCount() - t)/getTickFrequency();
+    t /= times;
+    //输出处理时间，并检查与 LUT 结果一致，不一致时返回非零
+    const bool identical = norm(J, K, NORM_INF) == 0;
+    cout << "Time of reducing with samples::PointOps (averaged for "
+        << times << " runs): " << t << " milliseconds."
+        << (identical ? "" : " [MISMATCH]") << endl;
+    //! [point-ops]
+    return identical ? 0 : 1;
 }
 
 //! [scan-c]
 Mat& ScanImageAndReduceC(Mat& I, const uchar* const table)
 {
+    SAMPLES_TRACE_SCOPE( "scan C operator []" );
     // accept only char type matrices
     CV_Assert(I.depth() == CV_8U);
 
@@ -182,6 +224,7 @@ Mat& ScanImageAndReduceC(Mat& I, const uchar* const table)
 //! [scan-iterator]
 Mat& ScanImageAndReduceIterator(Mat& I, const uchar* const table)
 {
+    SAMPLES_TRACE_SCOPE( "scan iterator" );
     // accept only char type matrices
     CV_Assert(I.depth() == CV_8U);
 
@@ -215,6 +258,7 @@ Mat& ScanImageAndReduceIterator(Mat& I, const uchar* const table)
 //! [scan-random]
 Mat& ScanImageAndReduceRandomAccess(Mat& I, const uchar* const table)
 {
+    SAMPLES_TRACE_SCOPE( "scan at" );
     // accept only char type matrices
     CV_Assert(I.depth() == CV_8U);
 
@@ -258,4 +302,5 @@ Mat& ScanImageAndReduceRandomAccess(Mat& I, const uchar* const table)
  * 色彩空间的减少table[i] = (uchar)(divideWith * (i/divideWith));
  * LUT函数操作 dst(I)←lut(src(I) + d)
  * 计算处理耗时的方式
+ * 按阶段统计 Mat 分配：每次 clone 都是一次整幅分配，LUT 和 PointOps 的输出在多次运行间复用
  */
\ No newline at end of file